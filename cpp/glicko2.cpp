@@ -25,9 +25,18 @@
 
 
 #include "glicko2.h"
+#include "glicko2_trace.h"
 
+#include <atomic>
 #include <vector>
-#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#ifdef GLICKO2_POOL
+#include <mutex>
+#include <utility>
+#endif
 
 
 
@@ -39,53 +48,471 @@ class Glicko2_impl
 		Glicko2_impl();
 		Glicko2_impl(const Glicko2_impl& rhs);
 
+#ifdef GLICKO2_HAVE_PMR
+		// constructors allocating result storage from a memory resource
+		explicit Glicko2_impl(std::pmr::memory_resource* resource);
+		Glicko2_impl(const Glicko2_impl& rhs, std::pmr::memory_resource* resource);
+
+		// create from a memory resource, or with operator new if it is 0
+		static Glicko2_impl* Create(std::pmr::memory_resource* resource, const Glicko2_impl* rhs);
+#endif
+
+		// destroy an object from Create() or new
+		static void Destroy(Glicko2_impl* impl);
+
 		// copy assignment
 		Glicko2_impl& operator=(const Glicko2_impl& rhs);
 
 		// destructor
 		virtual ~Glicko2_impl();
 
-		// system constants
-		static const double dvolatility;
+#ifdef GLICKO2_HAVE_PMR
+		// resource this object and its results were allocated from, or 0
+		std::pmr::memory_resource* resource;
+
+		// result storage: a std::pmr::vector on the rating's resource, or a
+		// std::vector for a rating without one, so that either kind of caller
+		// built buffer can be adopted without a copy
+		class result_vector
+		{
+			public:
+
+				result_vector() : pooled(std::pmr::get_default_resource()), has_resource(false), use_pooled(false) {}
+				explicit result_vector(std::pmr::memory_resource* resource) : pooled(resource), has_resource(true), use_pooled(true) {}
+				result_vector(const result_vector& rhs) : heap(rhs.begin(),rhs.end()), pooled(std::pmr::get_default_resource()), has_resource(false), use_pooled(false) {}
+				result_vector(const result_vector& rhs, std::pmr::memory_resource* resource) : pooled(rhs.begin(),rhs.end(),resource), has_resource(true), use_pooled(true) {}
+
+				result_vector& operator=(const result_vector& rhs)
+				{
+					if ( this != &rhs )
+					{
+						if ( use_pooled )
+						{
+							pooled.assign(rhs.begin(),rhs.end());
+						}
+						else
+						{
+							heap.assign(rhs.begin(),rhs.end());
+						}
+					}
+					return *this;
+				}
+
+				std::size_t   size() const                     { return use_pooled ? pooled.size() : heap.size(); }
+				bool          empty() const                    { return size() == 0; }
+				const double* begin() const                    { return use_pooled ? pooled.data() : heap.data(); }
+				const double* end() const                      { return begin() + size(); }
+				double&       operator[](std::size_t i)        { return use_pooled ? pooled[i] : heap[i]; }
+				const double& operator[](std::size_t i) const  { return use_pooled ? pooled[i] : heap[i]; }
+				void          clear()                          { use_pooled ? pooled.clear() : heap.clear(); }
+				void          resize(std::size_t count)        { use_pooled ? pooled.resize(count) : heap.resize(count); }
+				void          push_back(double value)          { use_pooled ? pooled.push_back(value) : heap.push_back(value); }
+
+				// whether a caller's buffer can be swapped in
+				bool CanAdopt(const std::vector<double>&) const            { return !has_resource; }
+				bool CanAdopt(const std::pmr::vector<double>& other) const { return other.get_allocator() == pooled.get_allocator(); }
+
+				// swap in a caller's buffer, which becomes the storage in use
+				void swap(std::vector<double>& other)      { pooled.clear(); heap.swap(other); use_pooled = false; }
+				void swap(std::pmr::vector<double>& other) { heap.clear(); pooled.swap(other); use_pooled = true; }
+
+			private:
+
+				std::vector<double>      heap;
+				std::pmr::vector<double> pooled;
+				bool                     has_resource;
+				bool                     use_pooled;
+		};
+#else
+		typedef std::vector<double> result_vector;
+#endif
 
 		// rating data
-		double rating;
-		double deviation;
-		double volatility;
+		Glicko2_rating state;
+
+		// result data (each opponent's Glicko-2 rating and deviation, and results,
+		// 0.0, 0.5, or 1.0)
+		result_vector opponent_ratings;
+		result_vector opponent_deviations;
+		result_vector results;
+
+		// time of the last UpdateInstant(), in rating periods
+		double time;
+
+		// largest volatility change Update() may skip solving for, or 0
+		double freeze;
+
+		// provisional rating cache: sums over the first provisional_count results,
+		// as seen from provisional_base, and the rating they give; filled by the
+		// const provisional queries, which is why those are not thread safe
+		mutable Glicko2_rating provisional;
+		mutable Glicko2_rating provisional_base;
+		mutable double         provisional_variance_sum;
+		mutable double         provisional_delta_sum;
+		mutable std::size_t    provisional_count;
+		mutable bool           provisional_ready;
+
+		// forget the provisional rating sums
+		void ResetProvisional() const;
+
+		// rating if the period ended now, summing only results added since the
+		// last call
+		const Glicko2_rating& GetProvisional() const;
+
+		// take over caller built result buffers if nothing is pending
+		template<class Vector>
+		bool Adopt(Vector& ratings, Vector& deviations, Vector& scores);
+
+		// Glicko2_math::Update(), with each step traced under
+		// GLICKO2_TRACE_OBJECTS, skipping the volatility solve when it would
+		// change the volatility by less than freeze
+		static void Update(Glicko2_rating& player, const double* opponent_ratings, const double* opponent_deviations, const double* results, unsigned int count, double freeze);
+
+#ifdef GLICKO2_POOL
+		// pooled allocation
+		static void* operator new(std::size_t size);
+		static void  operator delete(void* memory, std::size_t size);
+#endif
+};
 
-		// result data (copy of each opponent and results, 0.0, 0.5, or 1.0)
-		std::vector<Glicko2> opponents;
-		std::vector<double>  results;
 
-		// utility functions
-		double g(const double& deviation);
-		double E(const double& rating, const double& rating_opponent, const double& deviation_opponent);
-};
 
+#ifdef GLICKO2_POOL
+namespace
+{
+	// Pool of Glicko2_impl sized blocks.  Each thread allocates from and frees to
+	// its own free list without locking; blocks move between threads' lists via
+	// a shared stack of fixed size batches, and new blocks are carved from slabs
+	// one batch at a time.  Slabs are never returned to the heap.
+	class ImplPool
+	{
+		public:
+
+			static const std::size_t batch_size = 256;
+
+			struct Node
+			{
+				Node* next;
+			};
+
+			static void* Allocate();
+			static void  Free(void* memory);
+
+		private:
+
+			// shared batches of free nodes, with their lengths
+			struct Shared
+			{
+				std::mutex                                  lock;
+				std::vector< std::pair<Node*,std::size_t> > batches;
+			};
+
+			// returns the calling thread's list to the shared stack at thread exit
+			struct Flusher
+			{
+				~Flusher();
+			};
+
+			static Shared& GetShared();
+			static void    PushBatch(Node* head, std::size_t count);
+			static Node*   PopBatch(std::size_t& count);
+
+			static thread_local Node*        local_head;
+			static thread_local std::size_t  local_count;
+			static thread_local bool         local_closed;
+			static thread_local Flusher      flusher;
+	};
 
+	thread_local ImplPool::Node*   ImplPool::local_head   = 0;
+	thread_local std::size_t       ImplPool::local_count  = 0;
+	thread_local bool              ImplPool::local_closed = false;
+	thread_local ImplPool::Flusher ImplPool::flusher;
 
-const double Glicko2_impl::dvolatility = 0.3; // should be [0.3,1.2]
+	const std::size_t block_size = (sizeof(Glicko2_impl) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+
+
+	ImplPool::Shared& ImplPool::GetShared()
+	{
+		// never destroyed, so ratings with static storage may still be freed
+		static Shared* shared = new Shared;
+		return *shared;
+	}
+
+
+
+	void ImplPool::PushBatch(Node* head, std::size_t count)
+	{
+		Shared& shared = GetShared();
+		std::lock_guard<std::mutex> guard(shared.lock);
+		shared.batches.push_back(std::make_pair(head,count));
+	}
+
+
+
+	ImplPool::Node* ImplPool::PopBatch(std::size_t& count)
+	{
+		Shared& shared = GetShared();
+		{
+			std::lock_guard<std::mutex> guard(shared.lock);
+			if ( !shared.batches.empty() )
+			{
+				Node* head = shared.batches.back().first;
+				count      = shared.batches.back().second;
+				shared.batches.pop_back();
+				return head;
+			}
+		}
+
+		// carve a new slab into a batch
+		char* slab = static_cast<char*>(::operator new(batch_size * block_size));
+		Node* head = 0;
+		for ( std::size_t i=batch_size;i>0;i-- )
+		{
+			Node* node = reinterpret_cast<Node*>(slab + (i-1) * block_size);
+			node->next = head;
+			head       = node;
+		}
+		count = batch_size;
+		return head;
+	}
+
+
+
+	void* ImplPool::Allocate()
+	{
+		if ( local_closed )
+		{
+			// thread is exiting; take one block from a batch and give the rest back
+			std::size_t count = 0;
+			Node*       head  = PopBatch(count);
+			if ( count > 1 )
+			{
+				PushBatch(head->next,count-1);
+			}
+			return head;
+		}
+
+		// touching the flusher registers its destructor for this thread
+		(void)&flusher;
+
+		if ( local_head == 0 )
+		{
+			local_head = PopBatch(local_count);
+		}
+
+		Node* node  = local_head;
+		local_head  = node->next;
+		local_count--;
+		return node;
+	}
+
+
+
+	void ImplPool::Free(void* memory)
+	{
+		Node* node = static_cast<Node*>(memory);
+
+		if ( local_closed )
+		{
+			node->next = 0;
+			PushBatch(node,1);
+			return;
+		}
+
+		node->next = local_head;
+		local_head = node;
+		local_count++;
+
+		// hand a full batch back once this thread holds two
+		if ( local_count >= 2 * batch_size )
+		{
+			Node* tail = local_head;
+			for ( std::size_t i=1;i<batch_size;i++ )
+			{
+				tail = tail->next;
+			}
+
+			Node* batch = local_head;
+			local_head  = tail->next;
+			tail->next  = 0;
+			local_count -= batch_size;
+			PushBatch(batch,batch_size);
+		}
+	}
+
+
+
+	ImplPool::Flusher::~Flusher()
+	{
+		if ( local_head != 0 )
+		{
+			PushBatch(local_head,local_count);
+		}
+
+		local_head   = 0;
+		local_count  = 0;
+		local_closed = true;
+	}
+}
+
+
+
+void* Glicko2_impl::operator new(std::size_t size)
+{
+	if ( size > block_size )
+	{
+		return ::operator new(size);
+	}
+	return ImplPool::Allocate();
+}
+
+
+
+void Glicko2_impl::operator delete(void* memory, std::size_t size)
+{
+	if ( memory == 0 )
+	{
+		return;
+	}
+
+	if ( size > block_size )
+	{
+		::operator delete(memory);
+		return;
+	}
+	ImplPool::Free(memory);
+}
+#endif
 
 
 
 Glicko2_impl::Glicko2_impl() :
-	rating(0.0),
-	deviation(0.0),
-	volatility(0.0),
-	opponents(),
-	results()
+#ifdef GLICKO2_HAVE_PMR
+	resource(0),
+#endif
+	state(),
+	opponent_ratings(),
+	opponent_deviations(),
+	results(),
+	time(0.0),
+	freeze(0.0)
 {
+	ResetProvisional();
 }
 
 
 
 Glicko2_impl::Glicko2_impl(const Glicko2_impl& rhs) :
-	rating(rhs.rating),
-	deviation(rhs.deviation),
-	volatility(rhs.volatility),
-	opponents(rhs.opponents),
-	results(rhs.results)
+#ifdef GLICKO2_HAVE_PMR
+	resource(0),
+#endif
+	state(rhs.state),
+	opponent_ratings(rhs.opponent_ratings),
+	opponent_deviations(rhs.opponent_deviations),
+	results(rhs.results),
+	time(rhs.time),
+	freeze(rhs.freeze)
+{
+	ResetProvisional();
+}
+
+
+
+#ifdef GLICKO2_HAVE_PMR
+Glicko2_impl::Glicko2_impl(std::pmr::memory_resource* resource) :
+	resource(resource),
+	state(),
+	opponent_ratings(resource),
+	opponent_deviations(resource),
+	results(resource),
+	time(0.0),
+	freeze(0.0)
+{
+	ResetProvisional();
+}
+
+
+
+Glicko2_impl::Glicko2_impl(const Glicko2_impl& rhs, std::pmr::memory_resource* resource) :
+	resource(resource),
+	state(rhs.state),
+	opponent_ratings(rhs.opponent_ratings,resource),
+	opponent_deviations(rhs.opponent_deviations,resource),
+	results(rhs.results,resource),
+	time(rhs.time),
+	freeze(rhs.freeze)
+{
+	ResetProvisional();
+}
+
+
+
+Glicko2_impl* Glicko2_impl::Create(std::pmr::memory_resource* resource, const Glicko2_impl* rhs)
+{
+	if ( resource == 0 )
+	{
+		return rhs ? new Glicko2_impl(*rhs) : new Glicko2_impl;
+	}
+
+	void* memory = resource->allocate(sizeof(Glicko2_impl),alignof(Glicko2_impl));
+	try
+	{
+		return rhs ? ::new (memory) Glicko2_impl(*rhs,resource) : ::new (memory) Glicko2_impl(resource);
+	}
+	catch ( ... )
+	{
+		resource->deallocate(memory,sizeof(Glicko2_impl),alignof(Glicko2_impl));
+		throw;
+	}
+}
+#endif
+
+
+
+void Glicko2_impl::Destroy(Glicko2_impl* impl)
+{
+#ifdef GLICKO2_HAVE_PMR
+	if ( impl != 0 && impl->resource != 0 )
+	{
+		std::pmr::memory_resource* resource = impl->resource;
+		impl->~Glicko2_impl();
+		resource->deallocate(impl,sizeof(Glicko2_impl),alignof(Glicko2_impl));
+		return;
+	}
+#endif
+	delete impl;
+}
+
+
+
+template<class Vector>
+bool Glicko2_impl::Adopt(Vector& ratings, Vector& deviations, Vector& scores)
 {
+	if ( !results.empty() || ratings.size() != deviations.size() || ratings.size() != scores.size() )
+	{
+		return false;
+	}
+
+#ifdef GLICKO2_HAVE_PMR
+	// std::vector buffers only replace heap storage, and std::pmr::vector
+	// buffers only storage on the same resource
+	if ( !results.CanAdopt(ratings) || !results.CanAdopt(deviations) || !results.CanAdopt(scores) )
+	{
+		return false;
+	}
+#endif
+
+	for ( unsigned int i=0;i<ratings.size();i++ )
+	{
+		ratings[i]    = Glicko2_math::ToGlicko2Rating(ratings[i]);
+		deviations[i] = Glicko2_math::ToGlicko2Deviation(deviations[i]);
+	}
+
+	opponent_ratings.swap(ratings);
+	opponent_deviations.swap(deviations);
+	results.swap(scores);
+	return true;
 }
 
 
@@ -97,11 +524,13 @@ Glicko2_impl& Glicko2_impl::operator=(const Glicko2_impl& rhs)
 		return *this;
 	}
 
-	rating     = rhs.rating;
-	deviation  = rhs.deviation;
-	volatility = rhs.volatility;
-	opponents  = rhs.opponents;
-	results    = rhs.results;
+	state               = rhs.state;
+	opponent_ratings    = rhs.opponent_ratings;
+	opponent_deviations = rhs.opponent_deviations;
+	results             = rhs.results;
+	time                = rhs.time;
+	freeze              = rhs.freeze;
+	ResetProvisional();
 
 	return *this;
 }
@@ -114,17 +543,89 @@ Glicko2_impl::~Glicko2_impl()
 
 
 
-double Glicko2_impl::g(const double& deviation)
+void Glicko2_impl::ResetProvisional() const
+{
+	provisional              = state;
+	provisional_base         = state;
+	provisional_variance_sum = 0.0;
+	provisional_delta_sum    = 0.0;
+	provisional_count        = 0;
+	provisional_ready        = false;
+}
+
+
+
+const Glicko2_rating& Glicko2_impl::GetProvisional() const
+{
+	// the sums depend on this player's rating; start over if it was set
+	if ( provisional_base.rating != state.rating || provisional_base.deviation != state.deviation || provisional_base.volatility != state.volatility )
+	{
+		ResetProvisional();
+	}
+
+	if ( provisional_ready && provisional_count == results.size() )
+	{
+		return provisional;
+	}
+
+	// a period's results never change once added, so only new ones are summed
+	if ( provisional_count < results.size() )
+	{
+		unsigned int first = (unsigned int)provisional_count;
+		Glicko2_math::Accumulate(state.rating,&opponent_ratings[first],&opponent_deviations[first],&results[first],(unsigned int)results.size() - first,provisional_variance_sum,provisional_delta_sum);
+		provisional_count = results.size();
+	}
+
+	provisional       = provisional_count > 0 ? Glicko2_math::Provisional(state,provisional_variance_sum,provisional_delta_sum) : state;
+	provisional_ready = true;
+	return provisional;
+}
+
+
+
+namespace
 {
-#define PI_SQUARED (9.86960440108935861883)
-	return 1.0 / (sqrt(1.0 + 3.0 * deviation * deviation / PI_SQUARED));
+	// how often updates with a volatility freeze skipped or ran the solve
+	std::atomic<std::uint64_t> frozen_count(0);
+	std::atomic<std::uint64_t> solved_count(0);
 }
 
 
 
-double Glicko2_impl::E(const double& rating, const double& rating_opponent, const double& deviation_opponent)
+void Glicko2_impl::Update(Glicko2_rating& player, const double* opponent_ratings, const double* opponent_deviations, const double* results, unsigned int count, double freeze)
 {
-	return 1.0 / (1.0 + exp(-g(deviation_opponent)*(rating - rating_opponent)));
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	double variance_sum = 0.0;
+	double delta_sum    = 0.0;
+	{
+		GLICKO2_TRACE_OBJECT_SCOPE(SUMS);
+		Glicko2_math::Accumulate(player.rating,opponent_ratings,opponent_deviations,results,count,variance_sum,delta_sum);
+	}
+
+	double new_volatility = 0.0;
+	{
+		GLICKO2_TRACE_OBJECT_SCOPE(SOLVER);
+		double variance = 1.0 / variance_sum;
+		if ( freeze > 0.0 )
+		{
+			bool frozen;
+			new_volatility = Glicko2_math::SolveVolatility(player.deviation,player.volatility,variance,variance*delta_sum,freeze,frozen);
+			(frozen ? frozen_count : solved_count).fetch_add(1,std::memory_order_relaxed);
+		}
+		else
+		{
+			new_volatility = Glicko2_math::SolveVolatility(player.deviation,player.volatility,variance,variance*delta_sum);
+		}
+	}
+
+	{
+		GLICKO2_TRACE_OBJECT_SCOPE(FINALIZE);
+		Glicko2_math::Finalize(player,new_volatility,variance_sum,delta_sum);
+	}
 }
 
 
@@ -164,6 +665,57 @@ Glicko2::Glicko2(double rating, double deviation, double volatility) :
 
 
 
+Glicko2::Glicko2(const Glicko2_rating& state) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_impl;
+
+	SetState(state);
+}
+
+
+
+#ifdef GLICKO2_HAVE_PMR
+Glicko2::Glicko2(std::allocator_arg_t, const allocator_type& alloc) :
+	pimpl(0)
+{
+	pimpl = Glicko2_impl::Create(alloc.resource(),0);
+
+	SetRating(1500.0);
+	SetDeviation(350.0);
+	SetVolatility(0.06);
+}
+
+
+
+Glicko2::Glicko2(std::allocator_arg_t, const allocator_type& alloc, const Glicko2& rhs) :
+	pimpl(0)
+{
+	pimpl = Glicko2_impl::Create(alloc.resource(),rhs.pimpl);
+}
+
+
+
+Glicko2::Glicko2(std::allocator_arg_t, const allocator_type& alloc, double rating, double deviation, double volatility) :
+	pimpl(0)
+{
+	pimpl = Glicko2_impl::Create(alloc.resource(),0);
+
+	SetRating(rating);
+	SetDeviation(deviation);
+	SetVolatility(volatility);
+}
+
+
+
+Glicko2::allocator_type Glicko2::get_allocator() const
+{
+	return allocator_type(pimpl->resource ? pimpl->resource : std::pmr::get_default_resource());
+}
+#endif
+
+
+
 Glicko2& Glicko2::operator=(const Glicko2& rhs)
 {
 	if ( this == &rhs )
@@ -180,72 +732,131 @@ Glicko2& Glicko2::operator=(const Glicko2& rhs)
 
 Glicko2::~Glicko2()
 {
-	delete pimpl;
+	Glicko2_impl::Destroy(pimpl);
 }
 
 
 
 bool Glicko2::operator< (const Glicko2& rhs)
 {
-	return pimpl->rating < rhs.pimpl->rating;
+	return pimpl->state.rating < rhs.pimpl->state.rating;
 }
 
 
 
 double Glicko2::GetRating() const
 {
-	return pimpl->rating * 173.7178 + 1500.0;
+	return Glicko2_math::ToGlickoRating(pimpl->state.rating);
 }
 
 
 
 double Glicko2::GetDeviation() const
 {
-	return pimpl->deviation * 173.7178;
+	return Glicko2_math::ToGlickoDeviation(pimpl->state.deviation);
 }
 
 
 
 double Glicko2::GetVolatility() const
 {
-	return pimpl->volatility;
+	return pimpl->state.volatility;
 }
 
 
 
 void Glicko2::SetRating(double rating)
 {
-	pimpl->rating = (rating - 1500.0) / 173.7178;
+	pimpl->state.rating = Glicko2_math::ToGlicko2Rating(rating);
 }
 
 
 
 void Glicko2::SetDeviation(double deviation)
 {
-	pimpl->deviation = deviation / 173.7178;
+	pimpl->state.deviation = Glicko2_math::ToGlicko2Deviation(deviation);
 }
 
 
 
 void Glicko2::SetVolatility(double volatility)
 {
-	pimpl->volatility = volatility;
+	pimpl->state.volatility = volatility;
 }
 
 
 
+const Glicko2_rating& Glicko2::GetState() const
+{
+	return pimpl->state;
+}
+
+
+
+void Glicko2::SetState(const Glicko2_rating& state)
+{
+	pimpl->state = state;
+}
+
+
+
+
+double Glicko2::GetTime() const
+{
+	return pimpl->time;
+}
+
+
+
+void Glicko2::SetTime(double time)
+{
+	pimpl->time = time;
+}
+
+
 
 void Glicko2::ClearResults()
 {
-	pimpl->opponents.clear();
+	pimpl->opponent_ratings.clear();
+	pimpl->opponent_deviations.clear();
 	pimpl->results.clear();
+	pimpl->ResetProvisional();
+}
+
+
+
+double Glicko2::GetProvisionalRating() const
+{
+	return Glicko2_math::ToGlickoRating(pimpl->GetProvisional().rating);
+}
+
+
+
+double Glicko2::GetProvisionalDeviation() const
+{
+	return Glicko2_math::ToGlickoDeviation(pimpl->GetProvisional().deviation);
+}
+
+
+
+double Glicko2::GetProvisionalVolatility() const
+{
+	return pimpl->GetProvisional().volatility;
+}
+
+
+
+const Glicko2_rating& Glicko2::GetProvisionalState() const
+{
+	return pimpl->GetProvisional();
 }
 
 
 
 void Glicko2::AddResult(const Glicko2& opponent, RESULT result)
 {
-	pimpl->opponents.push_back(opponent);
+	pimpl->opponent_ratings.push_back(opponent.pimpl->state.rating);
+	pimpl->opponent_deviations.push_back(opponent.pimpl->state.deviation);
 
 	switch ( result )
 	{
@@ -286,66 +897,521 @@ void Glicko2::AddDraw(const Glicko2& opponent)
 
 
 
+namespace
+{
+	// append caller owned result buffers by copying, then empty them
+	template<class Vector>
+	void AppendAndClear(Glicko2& player, Vector& ratings, Vector& deviations, Vector& scores)
+	{
+		unsigned int count = (unsigned int)ratings.size();
+		count = deviations.size() < count ? (unsigned int)deviations.size() : count;
+		count = scores.size()     < count ? (unsigned int)scores.size()     : count;
+		if ( count > 0 )
+		{
+			player.AddResults(&ratings[0],&deviations[0],&scores[0],count);
+		}
+
+		ratings.clear();
+		deviations.clear();
+		scores.clear();
+	}
+}
+
+
+
+void Glicko2::AddResults(const double* ratings, const double* deviations, const double* scores, unsigned int count)
+{
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	std::size_t size = pimpl->results.size();
+	pimpl->opponent_ratings.resize(size + count);
+	pimpl->opponent_deviations.resize(size + count);
+	pimpl->results.resize(size + count);
+
+	double* r = &pimpl->opponent_ratings[0] + size;
+	double* d = &pimpl->opponent_deviations[0] + size;
+	double* s = &pimpl->results[0] + size;
+	for ( unsigned int i=0;i<count;i++ )
+	{
+		r[i] = Glicko2_math::ToGlicko2Rating(ratings[i]);
+		d[i] = Glicko2_math::ToGlicko2Deviation(deviations[i]);
+		s[i] = scores[i];
+	}
+}
+
+
+
+void Glicko2::AddResults(const Glicko2* players, const unsigned int* indices, const double* scores, unsigned int count)
+{
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	std::size_t size = pimpl->results.size();
+	pimpl->opponent_ratings.resize(size + count);
+	pimpl->opponent_deviations.resize(size + count);
+	pimpl->results.resize(size + count);
+
+	double* r = &pimpl->opponent_ratings[0] + size;
+	double* d = &pimpl->opponent_deviations[0] + size;
+	double* s = &pimpl->results[0] + size;
+	for ( unsigned int i=0;i<count;i++ )
+	{
+		const Glicko2_impl* opponent = players[indices[i]].pimpl;
+		r[i] = opponent->state.rating;
+		d[i] = opponent->state.deviation;
+		s[i] = scores[i];
+	}
+}
+
+
+
+void Glicko2::AddResults(std::vector<double>&& ratings, std::vector<double>&& deviations, std::vector<double>&& scores)
+{
+	// nothing pending, so take the caller's buffers and convert them in place
+	if ( pimpl->Adopt(ratings,deviations,scores) )
+	{
+		return;
+	}
+
+	AppendAndClear(*this,ratings,deviations,scores);
+}
+
+
+
+#ifdef GLICKO2_HAVE_PMR
+void Glicko2::AddResults(std::pmr::vector<double>&& ratings, std::pmr::vector<double>&& deviations, std::pmr::vector<double>&& scores)
+{
+	// nothing pending, so take the caller's buffers and convert them in place
+	if ( pimpl->Adopt(ratings,deviations,scores) )
+	{
+		return;
+	}
+
+	AppendAndClear(*this,ratings,deviations,scores);
+}
+#endif
+
+
+
 void Glicko2::Update()
 {
 	// bail if no opponents set
-	if ( pimpl->opponents.size() == 0 )
+	if ( pimpl->results.empty() )
 	{
 		return;
 	}
 
-	// compute variance
-	double variance = 0.0;
-	for ( unsigned int i=0;i<pimpl->opponents.size();i++ )
+	Glicko2_impl::Update(pimpl->state,&pimpl->opponent_ratings[0],&pimpl->opponent_deviations[0],&pimpl->results[0],(unsigned int)pimpl->results.size(),pimpl->freeze);
+
+	// wipe our result lists
+	ClearResults();
+}
+
+
+
+void Glicko2::SetVolatilityFreeze(double freeze)
+{
+	pimpl->freeze = freeze > 0.0 ? freeze : 0.0;
+}
+
+
+
+double Glicko2::GetVolatilityFreeze() const
+{
+	return pimpl->freeze;
+}
+
+
+
+std::uint64_t Glicko2::GetFrozenCount()
+{
+	return frozen_count.load(std::memory_order_relaxed);
+}
+
+
+
+std::uint64_t Glicko2::GetSolvedCount()
+{
+	return solved_count.load(std::memory_order_relaxed);
+}
+
+
+
+void Glicko2::UpdateInstant(Glicko2& opponent, RESULT result, double time)
+{
+	double score = Glicko2_math::Score(result == WIN,result == DRAW);
+
+	// both players are rated against the other's state before the contest
+	Glicko2_rating player_before   = pimpl->state;
+	Glicko2_rating opponent_before = opponent.pimpl->state;
+
+	double elapsed          = time > pimpl->time ? time - pimpl->time : 0.0;
+	double opponent_elapsed = time > opponent.pimpl->time ? time - opponent.pimpl->time : 0.0;
+
+	Glicko2_math::UpdateInstant(pimpl->state,opponent_before.rating,opponent_before.deviation,score,elapsed);
+	Glicko2_math::UpdateInstant(opponent.pimpl->state,player_before.rating,player_before.deviation,1.0 - score,opponent_elapsed);
+
+	pimpl->time          = time > pimpl->time ? time : pimpl->time;
+	opponent.pimpl->time = time > opponent.pimpl->time ? time : opponent.pimpl->time;
+}
+
+
+
+
+
+
+Glicko2_arena::Glicko2_arena(void* buffer, std::size_t size) :
+	buffer(static_cast<char*>(buffer)),
+	size(size),
+	used(0)
+{
+}
+
+
+
+void* Glicko2_arena::Allocate(std::size_t bytes)
+{
+	// align to a double
+	std::uintptr_t address = reinterpret_cast<std::uintptr_t>(buffer + used);
+	std::size_t    padding = (sizeof(double) - address % sizeof(double)) % sizeof(double);
+
+	if ( bytes > size - used || padding > size - used - bytes )
 	{
-		double g_i = pimpl->g(pimpl->opponents[i].pimpl->deviation);
-		double E_i = pimpl->E(pimpl->rating,pimpl->opponents[i].pimpl->rating,pimpl->opponents[i].pimpl->deviation);
-		variance  += g_i * g_i * E_i * (1.0 - E_i);
+		return 0;
 	}
-	variance = 1.0 / variance;
 
-	// compute delta
-	double delta = 0.0;
-	for ( unsigned int i=0;i<pimpl->opponents.size();i++ )
+	void* memory = buffer + used + padding;
+	used += padding + bytes;
+	return memory;
+}
+
+
+
+void Glicko2_arena::Reset()
+{
+	used = 0;
+}
+
+
+
+std::size_t Glicko2_arena::GetUsed() const
+{
+	return used;
+}
+
+
+
+
+
+
+Glicko2_fixed::Glicko2_fixed() :
+	state(),
+	count(0),
+	capacity(GLICKO2_FIXED_CAPACITY),
+	ratings(inline_ratings),
+	deviations(inline_deviations),
+	results(inline_results),
+	spilled_to_heap(false),
+	arena(0),
+	freeze(0.0)
+{
+	SetRating(1500.0);
+	SetDeviation(350.0);
+	SetVolatility(0.06);
+}
+
+
+
+Glicko2_fixed::Glicko2_fixed(const Glicko2_fixed& rhs) :
+	state(rhs.state),
+	count(0),
+	capacity(GLICKO2_FIXED_CAPACITY),
+	ratings(inline_ratings),
+	deviations(inline_deviations),
+	results(inline_results),
+	spilled_to_heap(false),
+	arena(rhs.arena),
+	freeze(rhs.freeze)
+{
+	Reserve(rhs.count);
+
+	count = rhs.count;
+	memcpy(ratings,   rhs.ratings,   count*sizeof(double));
+	memcpy(deviations,rhs.deviations,count*sizeof(double));
+	memcpy(results,   rhs.results,   count*sizeof(double));
+}
+
+
+
+Glicko2_fixed::Glicko2_fixed(double rating, double deviation, double volatility) :
+	state(),
+	count(0),
+	capacity(GLICKO2_FIXED_CAPACITY),
+	ratings(inline_ratings),
+	deviations(inline_deviations),
+	results(inline_results),
+	spilled_to_heap(false),
+	arena(0),
+	freeze(0.0)
+{
+	SetRating(rating);
+	SetDeviation(deviation);
+	SetVolatility(volatility);
+}
+
+
+
+Glicko2_fixed& Glicko2_fixed::operator=(const Glicko2_fixed& rhs)
+{
+	if ( this == &rhs )
 	{
-		delta += pimpl->g(pimpl->opponents[i].pimpl->deviation) * (pimpl->results[i] - pimpl->E(pimpl->rating,pimpl->opponents[i].pimpl->rating,pimpl->opponents[i].pimpl->deviation));
+		return *this;
 	}
-	delta *= variance;
 
-	// determine new volatility
-	double new_volatility = 0.0;
-	double a              = log(pimpl->volatility*pimpl->volatility);
-	double x              = 0.0;
-	double x_new          = a;
-	while ( abs(x - x_new) > 0.0000001 )
+	state  = rhs.state;
+	freeze = rhs.freeze;
+
+	ClearResults();
+	arena = rhs.arena;
+	Reserve(rhs.count);
+
+	count = rhs.count;
+	memcpy(ratings,   rhs.ratings,   count*sizeof(double));
+	memcpy(deviations,rhs.deviations,count*sizeof(double));
+	memcpy(results,   rhs.results,   count*sizeof(double));
+
+	return *this;
+}
+
+
+
+Glicko2_fixed::~Glicko2_fixed()
+{
+	ReleaseSpill();
+}
+
+
+
+double Glicko2_fixed::GetRating() const
+{
+	return Glicko2_math::ToGlickoRating(state.rating);
+}
+
+
+
+double Glicko2_fixed::GetDeviation() const
+{
+	return Glicko2_math::ToGlickoDeviation(state.deviation);
+}
+
+
+
+double Glicko2_fixed::GetVolatility() const
+{
+	return state.volatility;
+}
+
+
+
+void Glicko2_fixed::SetRating(double rating)
+{
+	state.rating = Glicko2_math::ToGlicko2Rating(rating);
+}
+
+
+
+void Glicko2_fixed::SetDeviation(double deviation)
+{
+	state.deviation = Glicko2_math::ToGlicko2Deviation(deviation);
+}
+
+
+
+void Glicko2_fixed::SetVolatility(double volatility)
+{
+	state.volatility = volatility;
+}
+
+
+
+const Glicko2_rating& Glicko2_fixed::GetState() const
+{
+	return state;
+}
+
+
+
+void Glicko2_fixed::SetState(const Glicko2_rating& state)
+{
+	this->state = state;
+}
+
+
+
+void Glicko2_fixed::SetArena(Glicko2_arena* arena)
+{
+	this->arena = arena;
+}
+
+
+
+unsigned int Glicko2_fixed::GetResultCount() const
+{
+	return count;
+}
+
+
+
+void Glicko2_fixed::ClearResults()
+{
+	count = 0;
+
+	// arena storage may be reset by its owner at any point after this
+	if ( ratings != inline_ratings && !spilled_to_heap )
+	{
+		ReleaseSpill();
+	}
+}
+
+
+
+void Glicko2_fixed::AddResult(const Glicko2_fixed& opponent, Glicko2::RESULT result)
+{
+	if ( count == capacity )
+	{
+		Reserve(count + 1);
+	}
+
+	ratings[count]    = opponent.state.rating;
+	deviations[count] = opponent.state.deviation;
+
+	switch ( result )
 	{
-		       x     = x_new;
-		double d     = pimpl->deviation*pimpl->deviation + variance + exp(x);
-		double h1    = -(x - a)/(Glicko2_impl::dvolatility*Glicko2_impl::dvolatility) - 0.5*exp(x)/d + 0.5*exp(x)*(delta/d)*(delta/d);
-		double h2    = -1.0/(Glicko2_impl::dvolatility*Glicko2_impl::dvolatility) - 0.5*exp(x)*(pimpl->deviation*pimpl->deviation+variance)/(d*d) + 0.5*(delta*delta)*exp(x)*((pimpl->deviation*pimpl->deviation) + variance - exp(x))/(d*d*d);
-		       x_new = x - h1/h2;
+		case Glicko2::WIN:
+			results[count] = 1.0;
+			break;
+
+		case Glicko2::LOSS:
+			results[count] = 0.0;
+			break;
+
+		case Glicko2::DRAW:
+			results[count] = 0.5;
+			break;
 	}
-	new_volatility = exp(x_new / 2.0);
 
-	// update the rating deviation to the new pre-rating period value
-	double pre_deviation = sqrt( pimpl->deviation*pimpl->deviation + new_volatility*new_volatility );
+	count++;
+}
+
+
+
+void Glicko2_fixed::AddWin(const Glicko2_fixed& opponent)
+{
+	AddResult(opponent,Glicko2::WIN);
+}
+
+
+
+void Glicko2_fixed::AddLoss(const Glicko2_fixed& opponent)
+{
+	AddResult(opponent,Glicko2::LOSS);
+}
+
+
+
+void Glicko2_fixed::AddDraw(const Glicko2_fixed& opponent)
+{
+	AddResult(opponent,Glicko2::DRAW);
+}
+
+
+
+void Glicko2_fixed::SetVolatilityFreeze(double freeze)
+{
+	this->freeze = freeze > 0.0 ? freeze : 0.0;
+}
+
+
+
+double Glicko2_fixed::GetVolatilityFreeze() const
+{
+	return freeze;
+}
+
+
 
-	// update the rating and deviation
-	double new_deviation = 1.0 / (sqrt( 1.0/(pre_deviation*pre_deviation) + 1.0 / variance));
-	double new_rating    = 0.0;
-	for ( unsigned int i=0;i<pimpl->opponents.size();i++ )
+void Glicko2_fixed::Update()
+{
+	// bail if no opponents set
+	if ( count == 0 )
 	{
-		new_rating += pimpl->g(pimpl->opponents[i].pimpl->deviation) * (pimpl->results[i] - pimpl->E(pimpl->rating,pimpl->opponents[i].pimpl->rating,pimpl->opponents[i].pimpl->deviation));
+		return;
 	}
-	new_rating  = new_rating * new_deviation * new_deviation;
-	new_rating += pimpl->rating;
 
-	// copy new values
-	pimpl->rating     = new_rating;
-	pimpl->deviation  = new_deviation;
-	pimpl->volatility = new_volatility;
+	Glicko2_impl::Update(state,ratings,deviations,results,count,freeze);
 
 	// wipe our result lists
 	ClearResults();
 }
 
+
+
+void Glicko2_fixed::Reserve(unsigned int wanted)
+{
+	if ( wanted <= capacity )
+	{
+		return;
+	}
+
+	unsigned int new_capacity = capacity * 2;
+	while ( new_capacity < wanted )
+	{
+		new_capacity *= 2;
+	}
+
+	// one block holds all three arrays; prefer the arena over the heap
+	double* block   = 0;
+	bool    to_heap = false;
+	if ( arena != 0 )
+	{
+		block = static_cast<double*>(arena->Allocate(3*new_capacity*sizeof(double)));
+	}
+	if ( block == 0 )
+	{
+		block   = new double[3*new_capacity];
+		to_heap = true;
+	}
+
+	memcpy(block,                 ratings,   count*sizeof(double));
+	memcpy(block+new_capacity,    deviations,count*sizeof(double));
+	memcpy(block+2*new_capacity,  results,   count*sizeof(double));
+
+	ReleaseSpill();
+
+	capacity        = new_capacity;
+	ratings         = block;
+	deviations      = block + new_capacity;
+	results         = block + 2*new_capacity;
+	spilled_to_heap = to_heap;
+}
+
+
+
+void Glicko2_fixed::ReleaseSpill()
+{
+	if ( spilled_to_heap )
+	{
+		delete [] ratings;
+	}
+
+	capacity        = GLICKO2_FIXED_CAPACITY;
+	ratings         = inline_ratings;
+	deviations      = inline_deviations;
+	results         = inline_results;
+	spilled_to_heap = false;
+}
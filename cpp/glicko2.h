@@ -29,6 +29,31 @@
 
 
 
+#include "glicko2_math.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+
+/**
+ * Defined to 1 when std::pmr is available, enabling the polymorphic allocator
+ * support in Glicko2.
+ */
+#if !defined(GLICKO2_HAVE_PMR) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#define GLICKO2_HAVE_PMR 1
+#endif
+#endif
+
+#ifdef GLICKO2_HAVE_PMR
+#include <memory>
+#include <memory_resource>
+#endif
+
+
+
 class Glicko2_impl;
 
 
@@ -44,6 +69,15 @@ class Glicko2_impl;
  * improvement on the ELO system.
  * 
  * The Glicko-2 system is specified on http://www.glicko.com/
+ * 
+ * Building glicko2.cpp with GLICKO2_POOL defined allocates the private
+ * implementation from per-thread free lists of fixed size blocks rather than
+ * the global heap, which suits programs creating and copying many ratings.
+ * 
+ * With GLICKO2_HAVE_PMR, a rating may instead be given a memory resource, from
+ * which it allocates both its private implementation and its result storage.
+ * Glicko2 is allocator aware, so containers such as std::pmr::vector<Glicko2>
+ * pass their resource on to every rating they hold.
  */
 class Glicko2
 {
@@ -96,6 +130,53 @@ class Glicko2
 		 */
 		Glicko2(double rating, double deviation, double volatility);
 
+		/**
+		 * Constructor with a Glicko-2 scale rating state specified.
+		 *
+		 * @param state Initial rating state.
+		 */
+		explicit Glicko2(const Glicko2_rating& state);
+
+#ifdef GLICKO2_HAVE_PMR
+		/**
+		 * Allocator type, for containers doing uses-allocator construction.
+		 */
+		typedef std::pmr::polymorphic_allocator<Glicko2> allocator_type;
+
+		/**
+		 * Default constructor allocating from a memory resource.
+		 *
+		 * @param alloc  Allocator whose resource is used for all storage.
+		 */
+		Glicko2(std::allocator_arg_t, const allocator_type& alloc);
+
+		/**
+		 * Copy constructor allocating from a memory resource.
+		 *
+		 * @param alloc  Allocator whose resource is used for all storage.
+		 * @param rhs    Object to copy.
+		 */
+		Glicko2(std::allocator_arg_t, const allocator_type& alloc, const Glicko2& rhs);
+
+		/**
+		 * Constructor with rating, rating deviation, and volatility specified,
+		 * allocating from a memory resource.
+		 *
+		 * @param alloc      Allocator whose resource is used for all storage.
+		 * @param rating     Initial rating.
+		 * @param deviation  Initial rating deviation.
+		 * @param volatility Initial volatility.
+		 */
+		Glicko2(std::allocator_arg_t, const allocator_type& alloc, double rating, double deviation, double volatility);
+
+		/**
+		 * Get the allocator this rating's storage comes from.
+		 *
+		 * @return Allocator; uses the default resource if none was given.
+		 */
+		allocator_type get_allocator() const;
+#endif
+
 
 
 		/**
@@ -176,6 +257,21 @@ class Glicko2
 		void SetVolatility(double volatility);
 
 
+		/**
+		 * Get the complete rating state, on the Glicko-2 scale.
+		 *
+		 * @return Rating state.
+		 */
+		const Glicko2_rating& GetState() const;
+
+		/**
+		 * Set the complete rating state, on the Glicko-2 scale.
+		 *
+		 * @param state Rating state.
+		 */
+		void SetState(const Glicko2_rating& state);
+
+
 
 		/**
 		 * Clear all results previously added via AddResult(), AddWin(), AddLoss(),
@@ -186,6 +282,46 @@ class Glicko2
 
 
 
+		/**
+		 * Get the rating this player would have if Update() were called now.  The
+		 * results are not consumed.  Each result is summed once, when first
+		 * queried, so repeated queries between results cost nothing and a query
+		 * after each new result costs one result plus the volatility solve.
+		 * Unlike the other const getters, the provisional queries update that
+		 * cache, so they are not thread safe: two threads must not query the
+		 * same rating at once, even with no other changes to it.
+		 *
+		 * @return Provisional Glicko rating.
+		 */
+		double GetProvisionalRating() const;
+
+		/**
+		 * Get the rating deviation this player would have if Update() were called
+		 * now.  See GetProvisionalRating().
+		 *
+		 * @return Provisional Glicko rating deviation.
+		 */
+		double GetProvisionalDeviation() const;
+
+		/**
+		 * Get the volatility this player would have if Update() were called now.
+		 * See GetProvisionalRating().
+		 *
+		 * @return Provisional rating volatility.
+		 */
+		double GetProvisionalVolatility() const;
+
+		/**
+		 * Get the complete rating state this player would have if Update() were
+		 * called now, on the Glicko-2 scale.  See GetProvisionalRating().
+		 *
+		 * @return Provisional rating state, valid until the next call changing
+		 *         this rating.
+		 */
+		const Glicko2_rating& GetProvisionalState() const;
+
+
+
 		/**
 		 * Add a result to this rating.  Note that no calculation is performed until
 		 * Update() is called.
@@ -223,11 +359,135 @@ class Glicko2
 
 
 
+		/**
+		 * Add many results to this rating in one pass.  Note that no calculation is
+		 * performed until Update() is called.
+		 *
+		 * @param ratings    Glicko rating of each opponent.
+		 * @param deviations Glicko rating deviation of each opponent.
+		 * @param scores     Score of each contest from the point of view of this
+		 *                   player; 1.0 for a win, 0.0 for a loss, 0.5 for a draw.
+		 * @param count      Number of results.
+		 */
+		void AddResults(const double* ratings, const double* deviations, const double* scores, unsigned int count);
+
+		/**
+		 * Add many results against players held in an array.  Note that no
+		 * calculation is performed until Update() is called.
+		 *
+		 * @param players Array of players.
+		 * @param indices Index into players of each opponent.
+		 * @param scores  Score of each contest from the point of view of this
+		 *                player; 1.0 for a win, 0.0 for a loss, 0.5 for a draw.
+		 * @param count   Number of results.
+		 */
+		void AddResults(const Glicko2* players, const unsigned int* indices, const double* scores, unsigned int count);
+
+		/**
+		 * Add many results held in caller built buffers, taking ownership of them.
+		 * When no results are pending the buffers become this rating's result
+		 * storage without being copied, unless the rating has a memory resource,
+		 * in which case they are copied into it.  Note that no calculation is
+		 * performed until Update() is called.
+		 *
+		 * @param ratings    Glicko rating of each opponent.
+		 * @param deviations Glicko rating deviation of each opponent.
+		 * @param scores     Score of each contest from the point of view of this
+		 *                   player; 1.0 for a win, 0.0 for a loss, 0.5 for a draw.
+		 *                   All three buffers should be the same size; any excess
+		 *                   entries are ignored.  All three are left empty.
+		 */
+		void AddResults(std::vector<double>&& ratings, std::vector<double>&& deviations, std::vector<double>&& scores);
+
+#ifdef GLICKO2_HAVE_PMR
+		/**
+		 * As AddResults() taking std::vector buffers, but for std::pmr::vector
+		 * buffers.  These are adopted without a copy when they use this rating's
+		 * memory resource, or the default resource for a rating without one;
+		 * otherwise the results are copied.
+		 *
+		 * @param ratings    Glicko rating of each opponent.
+		 * @param deviations Glicko rating deviation of each opponent.
+		 * @param scores     Score of each contest from the point of view of this
+		 *                   player; 1.0 for a win, 0.0 for a loss, 0.5 for a draw.
+		 *                   All three are left empty.
+		 */
+		void AddResults(std::pmr::vector<double>&& ratings, std::pmr::vector<double>&& deviations, std::pmr::vector<double>&& scores);
+#endif
+
+
+
 		/**
 		 * Update rating based on current results list, and clear results.
 		 */
 		void Update();
 
+		/**
+		 * Set this rating's volatility freeze, which copies of it keep.  When
+		 * non-zero, Update() skips the volatility iteration, keeping the
+		 * volatility as it is, whenever Glicko2_math::IsVolatilityFrozen() shows
+		 * the iteration would change it by less than this; otherwise it solves
+		 * as usual.  Established players, with a low deviation and a long
+		 * history, nearly always skip it.  Instant updates always solve.
+		 *
+		 * @param freeze Largest change in volatility that may be ignored; 0, the
+		 *               default, always solves.
+		 */
+		void SetVolatilityFreeze(double freeze);
+
+		/**
+		 * @return Volatility freeze, as set by SetVolatilityFreeze().
+		 */
+		double GetVolatilityFreeze() const;
+
+		/**
+		 * @return Number of updates of any Glicko2 or Glicko2_fixed with a
+		 *         volatility freeze that skipped the volatility iteration, since
+		 *         the program started.
+		 */
+		static std::uint64_t GetFrozenCount();
+
+		/**
+		 * @return Number of updates of any Glicko2 or Glicko2_fixed with a
+		 *         volatility freeze that ran the volatility iteration, since the
+		 *         program started.
+		 */
+		static std::uint64_t GetSolvedCount();
+
+
+
+		/**
+		 * Apply a contest to both players at once, instead of adding results and
+		 * waiting for Update().  Each player is updated as if a rating period
+		 * holding just this contest had run since its last instant update, so the
+		 * rating deviation grows with the time elapsed, fractions of a period
+		 * included.  Costs one volatility solve per player and never allocates.
+		 * Pending results are unaffected, but are rated from the new state.
+		 *
+		 * @param opponent Other player in contest, also updated.
+		 * @param result   WIN, LOSS, or DRAW; from the point of view of this player.
+		 * @param time     Time of the contest, in rating periods, on a clock of the
+		 *                 caller's choosing.  Time never runs backwards for a
+		 *                 player: an earlier time counts as no time elapsed.
+		 */
+		void UpdateInstant(Glicko2& opponent, RESULT result, double time);
+
+		/**
+		 * Get the time of this player's last instant update, as passed to
+		 * UpdateInstant(); 0 until the first.
+		 *
+		 * @return Time, in rating periods.
+		 */
+		double GetTime() const;
+
+		/**
+		 * Set the time of this player's last instant update, typically to when
+		 * the player joined, so the first contest does not count time before it.
+		 *
+		 * @param time Time, in rating periods.
+		 */
+		void SetTime(double time);
+
 
 
 	private:
@@ -241,5 +501,281 @@ class Glicko2
 
 
 
+/**
+ * Number of results a Glicko2_fixed holds without spilling.  Define before
+ * including this header (and when building glicko2.cpp) to change it.
+ */
+#ifndef GLICKO2_FIXED_CAPACITY
+#define GLICKO2_FIXED_CAPACITY 16
+#endif
+
+
+
+/**
+ * Bump allocator over caller supplied memory.
+ *
+ * Allocations are never freed individually; the owner calls Reset() once
+ * everything allocated from the arena is no longer in use, typically at the
+ * end of a server tick.
+ */
+class Glicko2_arena
+{
+	public:
+
+		/**
+		 * Constructor.
+		 *
+		 * @param buffer Memory to allocate from, owned by the caller.
+		 * @param size   Size of buffer in bytes.
+		 */
+		Glicko2_arena(void* buffer, std::size_t size);
+
+		/**
+		 * Allocate memory aligned for a double.
+		 *
+		 * @param size Number of bytes wanted.
+		 *
+		 * @return The memory, or 0 if the arena is exhausted.
+		 */
+		void* Allocate(std::size_t size);
+
+		/**
+		 * Release everything allocated so far.
+		 */
+		void Reset();
+
+		/**
+		 * @return Number of bytes currently allocated.
+		 */
+		std::size_t GetUsed() const;
+
+	private:
+
+		Glicko2_arena(const Glicko2_arena&);
+		Glicko2_arena& operator=(const Glicko2_arena&);
+
+		char*       buffer;
+		std::size_t size;
+		std::size_t used;
+};
+
+
+
+/**
+ * Allocation free Glicko-2 rating calculator.
+ *
+ * Behaves like Glicko2, but keeps its rating and up to GLICKO2_FIXED_CAPACITY
+ * results inside the object, and only copies an opponent's rating and
+ * deviation when a result is added.  Construction, AddResult(), and Update()
+ * never touch the heap unless a rating period has more results than fit
+ * inline.  Beyond that the results spill into the arena given to SetArena(),
+ * or onto the heap if there is no arena or it is exhausted.
+ */
+class Glicko2_fixed
+{
+	public:
+
+		/**
+		 * Default constructor.  Initializes to a rating of 1500, a rating deviation
+		 * of 350, and a volatility of 0.06.
+		 */
+		Glicko2_fixed();
+
+		/**
+		 * Copy constructor.  Results spilled into an arena are copied into the
+		 * same arena.
+		 *
+		 * @param rhs    Object to copy.
+		 */
+		Glicko2_fixed(const Glicko2_fixed& rhs);
+
+		/**
+		 * Constructor with rating, rating deviation, and volatility specified.
+		 *
+		 * @param rating     Initial rating.
+		 * @param deviation  Initial rating deviation.
+		 * @param volatility Initial volatility.
+		 */
+		Glicko2_fixed(double rating, double deviation, double volatility);
+
+		/**
+		 * Copy assignment operator.
+		 *
+		 * @param rhs    Object to copy.
+		 *
+		 * @return Reference to self after copy assignment.
+		 */
+		Glicko2_fixed& operator=(const Glicko2_fixed& rhs);
+
+		/**
+		 * Destructor.
+		 */
+		~Glicko2_fixed();
+
+
+
+		/**
+		 * Get the current Glicko rating.
+		 *
+		 * @return
+		 */
+		double GetRating() const;
+
+		/**
+		 * Get the current Glicko rating deviation.
+		 *
+		 * @return
+		 */
+		double GetDeviation() const;
+
+		/**
+		 * Get the current rating volatility.
+		 *
+		 * @return
+		 */
+		double GetVolatility() const;
+
+		/**
+		 * Set Glicko rating.
+		 *
+		 * @param rating Rating.
+		 */
+		void SetRating(double rating);
+
+		/**
+		 * Set Glicko rating deviation.
+		 *
+		 * @param deviation Rating deviation.
+		 */
+		void SetDeviation(double deviation);
+
+		/**
+		 * Set rating volatility.
+		 *
+		 * @param volatility Rating volatility.
+		 */
+		void SetVolatility(double volatility);
+
+		/**
+		 * Get the complete rating state, on the Glicko-2 scale.
+		 *
+		 * @return Rating state.
+		 */
+		const Glicko2_rating& GetState() const;
+
+		/**
+		 * Set the complete rating state, on the Glicko-2 scale.
+		 *
+		 * @param state Rating state.
+		 */
+		void SetState(const Glicko2_rating& state);
+
+
+
+		/**
+		 * Set the arena results spill into once the inline capacity is used up.
+		 *
+		 * @param arena Arena, or 0 to spill onto the heap.  Must outlive any
+		 *              results spilled into it.
+		 */
+		void SetArena(Glicko2_arena* arena);
+
+		/**
+		 * @return Number of results added since the last update.
+		 */
+		unsigned int GetResultCount() const;
+
+
+
+		/**
+		 * Clear all results previously added.  Spilled heap storage is kept for
+		 * reuse; arena storage is let go, so the arena may be reset once every
+		 * object using it has been updated or cleared.
+		 */
+		void ClearResults();
+
+		/**
+		 * Add a result to this rating.  Note that no calculation is performed until
+		 * Update() is called.
+		 *
+		 * @param opponent Other player in contest.
+		 * @param result   WIN, LOSS, or DRAW; from the point of view of this player.
+		 */
+		void AddResult(const Glicko2_fixed& opponent, Glicko2::RESULT result);
+
+		/**
+		 * Add a win result to this rating.
+		 *
+		 * @param opponent Other (losing) player in contest.
+		 */
+		void AddWin(const Glicko2_fixed& opponent);
+
+		/**
+		 * Add a loss result to this rating.
+		 *
+		 * @param opponent Other (winning) player in contest.
+		 */
+		void AddLoss(const Glicko2_fixed& opponent);
+
+		/**
+		 * Add a draw result to this rating.
+		 *
+		 * @param opponent Other (drawing) player in contest.
+		 */
+		void AddDraw(const Glicko2_fixed& opponent);
+
+		/**
+		 * Update rating based on current results list, and clear results.
+		 */
+		void Update();
+
+		/**
+		 * Set this rating's volatility freeze; see
+		 * Glicko2::SetVolatilityFreeze().  Updates are counted in
+		 * Glicko2::GetFrozenCount() and Glicko2::GetSolvedCount().
+		 *
+		 * @param freeze Largest change in volatility that may be ignored; 0, the
+		 *               default, always solves.
+		 */
+		void SetVolatilityFreeze(double freeze);
+
+		/**
+		 * @return Volatility freeze, as set by SetVolatilityFreeze().
+		 */
+		double GetVolatilityFreeze() const;
+
+
+
+	private:
+
+		// make room for at least the given number of results
+		void Reserve(unsigned int wanted);
+
+		// release spilled storage owned by this object
+		void ReleaseSpill();
+
+		// rating data
+		Glicko2_rating state;
+
+		// results, in inline or spilled storage
+		unsigned int count;
+		unsigned int capacity;
+		double*      ratings;
+		double*      deviations;
+		double*      results;
+		bool         spilled_to_heap;
+
+		Glicko2_arena* arena;
+
+		// largest volatility change Update() may skip solving for, or 0
+		double freeze;
+
+		double inline_ratings[GLICKO2_FIXED_CAPACITY];
+		double inline_deviations[GLICKO2_FIXED_CAPACITY];
+		double inline_results[GLICKO2_FIXED_CAPACITY];
+};
+
+
+
 #endif // __glicko2_h__
 
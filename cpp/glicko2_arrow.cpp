@@ -0,0 +1,866 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_arrow.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+
+namespace
+{
+	const char          file_magic[8]    = { 'A','R','R','O','W','1',0,0 };
+	const std::uint32_t continuation     = 0xFFFFFFFFu;
+	const std::int16_t  metadata_v5      = 4;
+	const unsigned char header_schema    = 1;
+	const unsigned char header_batch     = 3;
+	const unsigned char type_int         = 2;
+	const unsigned char type_float       = 3;
+	const std::int16_t  precision_double = 2;
+
+	// record batch buffers start on this boundary, as Arrow advises
+	const std::size_t body_alignment = 64;
+
+	// sizes of the FieldNode, Buffer and Block structs
+	const std::size_t node_size   = 16;
+	const std::size_t buffer_size = 16;
+	const std::size_t block_size  = 24;
+
+
+
+	std::size_t Align(std::size_t size, std::size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+
+
+	std::size_t Width(Glicko2_arrow_writer::TYPE type)
+	{
+		return type == Glicko2_arrow_writer::UINT32 ? 4 : 8;
+	}
+
+
+
+	struct Column
+	{
+		std::string                name;
+		Glicko2_arrow_writer::TYPE type;
+	};
+
+	// where a record batch is in the file
+	struct Block
+	{
+		std::int64_t offset;
+		std::int32_t metadata;
+		std::int64_t body;
+	};
+
+
+
+	// a flatbuffer, built front to back: every table follows its vtable, and the
+	// tables, vectors and strings it refers to follow it, their offsets patched
+	// in once they are placed.  Positions rather than pointers are passed
+	// around, since the buffer moves as it grows.
+	class Builder
+	{
+		public:
+
+			std::vector<unsigned char> bytes;
+
+			// room for the offset to the root table
+			Builder() : bytes(4,0) {}
+
+			template <typename T>
+			void Put(std::size_t at, T value)
+			{
+				std::memcpy(&bytes[at],&value,sizeof(T));
+			}
+
+			// point the offset at a position to an object placed after it
+			void Point(std::size_t at, std::size_t target)
+			{
+				Put<std::uint32_t>(at,(std::uint32_t)(target - at));
+			}
+
+			// a table with a field of each size given, or none where the size is
+			// 0; fields receives the position of each, and the table's is returned
+			std::size_t Table(const unsigned int* sizes, unsigned int count, std::size_t* fields)
+			{
+				// widest fields first, so that none needs padding
+				std::vector<std::uint16_t> offsets(count,0);
+				std::size_t                inline_size = 4;
+				for ( unsigned int size=8;size>0;size/=2 )
+				{
+					for ( unsigned int i=0;i<count;i++ )
+					{
+						if ( sizes[i] == size )
+						{
+							inline_size = Align(inline_size,size);
+							offsets[i]  = (std::uint16_t)inline_size;
+							inline_size += size;
+						}
+					}
+				}
+
+				std::size_t vtable_size = 4 + 2 * count;
+				while ( (bytes.size() + vtable_size) % 8 != 0 )
+				{
+					bytes.push_back(0);
+				}
+
+				std::size_t vtable = bytes.size();
+				std::size_t table  = vtable + vtable_size;
+				bytes.resize(table + inline_size,0);
+
+				Put<std::uint16_t>(vtable,(std::uint16_t)vtable_size);
+				Put<std::uint16_t>(vtable + 2,(std::uint16_t)inline_size);
+				for ( unsigned int i=0;i<count;i++ )
+				{
+					Put<std::uint16_t>(vtable + 4 + 2 * i,offsets[i]);
+					fields[i] = offsets[i] ? table + offsets[i] : 0;
+				}
+				Put<std::int32_t>(table,(std::int32_t)vtable_size);
+				return table;
+			}
+
+			// a vector of count elements, zeroed; its elements follow the length
+			// at the position returned
+			std::size_t Vector(std::size_t count, std::size_t size, std::size_t alignment)
+			{
+				while ( bytes.size() % 4 != 0 || (bytes.size() + 4) % alignment != 0 )
+				{
+					bytes.push_back(0);
+				}
+
+				std::size_t at = bytes.size();
+				bytes.resize(at + 4 + count * size,0);
+				Put<std::uint32_t>(at,(std::uint32_t)count);
+				return at;
+			}
+
+			std::size_t String(const std::string& text)
+			{
+				std::size_t at = Vector(text.size(),1,4);
+				if ( !text.empty() )
+				{
+					std::memcpy(&bytes[at + 4],text.data(),text.size());
+				}
+				bytes.push_back(0);
+				return at;
+			}
+	};
+
+
+
+	// Schema { endianness, fields }
+	std::size_t PutSchema(Builder& b, const std::vector<Column>& columns)
+	{
+		const unsigned int schema_sizes[] = { 2, 4 };
+		std::size_t        schema_fields[2];
+		std::size_t        schema = b.Table(schema_sizes,2,schema_fields);
+
+		std::size_t list = b.Vector(columns.size(),4,4);
+		b.Point(schema_fields[1],list);
+
+		for ( unsigned int c=0;c<columns.size();c++ )
+		{
+			// Field { name, nullable, type_type, type, dictionary, children }
+			const unsigned int field_sizes[] = { 4, 1, 1, 4, 0, 4 };
+			std::size_t        at[6];
+			std::size_t        field = b.Table(field_sizes,6,at);
+			b.Point(list + 4 + 4 * c,field);
+
+			std::size_t name = b.String(columns[c].name);
+			b.Point(at[0],name);
+
+			std::size_t type = 0;
+			if ( columns[c].type == Glicko2_arrow_writer::DOUBLE )
+			{
+				// FloatingPoint { precision }
+				const unsigned int type_sizes[] = { 2 };
+				std::size_t        type_fields[1];
+				type = b.Table(type_sizes,1,type_fields);
+				b.Put<std::int16_t>(type_fields[0],precision_double);
+				b.Put<unsigned char>(at[2],type_float);
+			}
+			else
+			{
+				// Int { bitWidth, is_signed }
+				const unsigned int type_sizes[] = { 4, 1 };
+				std::size_t        type_fields[2];
+				type = b.Table(type_sizes,2,type_fields);
+				b.Put<std::int32_t>(type_fields[0],(std::int32_t)(8 * Width(columns[c].type)));
+				b.Put<unsigned char>(type_fields[1],columns[c].type == Glicko2_arrow_writer::INT64 ? 1 : 0);
+				b.Put<unsigned char>(at[2],type_int);
+			}
+			b.Point(at[3],type);
+
+			std::size_t children = b.Vector(0,4,4);
+			b.Point(at[5],children);
+		}
+
+		return schema;
+	}
+
+
+
+	// Message { version, header_type, header, bodyLength }, the root; returns
+	// the position of the header's offset
+	std::size_t PutMessage(Builder& b, unsigned char header_type, std::int64_t body_length)
+	{
+		const unsigned int sizes[] = { 2, 1, 4, 8 };
+		std::size_t        at[4];
+		std::size_t        message = b.Table(sizes,4,at);
+		b.Point(0,message);
+		b.Put<std::int16_t>(at[0],metadata_v5);
+		b.Put<unsigned char>(at[1],header_type);
+		b.Put<std::int64_t>(at[3],body_length);
+		return at[2];
+	}
+
+
+
+	// bounds checked reads of a flatbuffer; any read out of bounds clears ok
+	// and returns zero, so a malformed buffer can be walked and checked after
+	class Flat
+	{
+		public:
+
+			const unsigned char* data;
+			std::size_t          size;
+			bool                 ok;
+
+			Flat(const unsigned char* data, std::size_t size) : data(data), size(size), ok(true) {}
+
+			template <typename T>
+			T Get(std::size_t at)
+			{
+				T value = T();
+				if ( at > size || size - at < sizeof(T) )
+				{
+					ok = false;
+					return value;
+				}
+				std::memcpy(&value,data + at,sizeof(T));
+				return value;
+			}
+
+			// what an offset at a position points to
+			std::size_t Follow(std::size_t at)
+			{
+				return at + Get<std::uint32_t>(at);
+			}
+
+			std::size_t Root()
+			{
+				return Follow(0);
+			}
+
+			// position of a table's field, or 0 if it is absent
+			std::size_t Field(std::size_t table, unsigned int field)
+			{
+				std::int64_t vtable = (std::int64_t)table - Get<std::int32_t>(table);
+				if ( vtable < 0 || (std::size_t)vtable >= size )
+				{
+					ok = false;
+					return 0;
+				}
+
+				std::size_t vtable_size = Get<std::uint16_t>((std::size_t)vtable);
+				if ( 4 + 2 * field + 2 > vtable_size )
+				{
+					return 0;
+				}
+				std::size_t offset = Get<std::uint16_t>((std::size_t)vtable + 4 + 2 * field);
+				return offset ? table + offset : 0;
+			}
+
+			template <typename T>
+			T Scalar(std::size_t table, unsigned int field, T fallback)
+			{
+				std::size_t at = Field(table,field);
+				return at ? Get<T>(at) : fallback;
+			}
+
+			// what a table's field points to, or 0 if it is absent
+			std::size_t Ref(std::size_t table, unsigned int field)
+			{
+				std::size_t at = Field(table,field);
+				return at ? Follow(at) : 0;
+			}
+
+			// number of elements of a vector, checked to fit
+			std::size_t Length(std::size_t vector, std::size_t element_size)
+			{
+				std::size_t length = vector ? Get<std::uint32_t>(vector) : 0;
+				if ( length > 0 && (size - vector - 4) / element_size < length )
+				{
+					ok = false;
+					return 0;
+				}
+				return length;
+			}
+
+			std::string String(std::size_t at)
+			{
+				std::size_t length = at ? Length(at,1) : 0;
+				return ok && length > 0 ? std::string(reinterpret_cast<const char*>(data + at + 4),length) : std::string();
+			}
+	};
+
+
+
+	bool ReadSchema(Flat& f, std::size_t schema, std::vector<Column>& columns)
+	{
+		if ( schema == 0 )
+		{
+			return false;
+		}
+
+		std::size_t fields = f.Ref(schema,1);
+		std::size_t count  = f.Length(fields,4);
+		columns.resize(count);
+		for ( std::size_t c=0;f.ok && c<count;c++ )
+		{
+			std::size_t field = f.Follow(fields + 4 + 4 * c);
+			columns[c].name = f.String(f.Ref(field,0));
+
+			// plain numbers only: no dictionaries and no nested types
+			unsigned char type_type = f.Scalar<unsigned char>(field,2,0);
+			std::size_t   type      = f.Ref(field,3);
+			if ( type == 0 || f.Field(field,4) != 0 || f.Length(f.Ref(field,5),4) != 0 )
+			{
+				return false;
+			}
+
+			if ( type_type == type_float && f.Scalar<std::int16_t>(type,0,0) == precision_double )
+			{
+				columns[c].type = Glicko2_arrow_writer::DOUBLE;
+			}
+			else if ( type_type == type_int )
+			{
+				std::int32_t bits      = f.Scalar<std::int32_t>(type,0,0);
+				bool         is_signed = f.Scalar<unsigned char>(type,1,0) != 0;
+				if ( bits == 32 && !is_signed )
+				{
+					columns[c].type = Glicko2_arrow_writer::UINT32;
+				}
+				else if ( bits == 64 )
+				{
+					columns[c].type = is_signed ? Glicko2_arrow_writer::INT64 : Glicko2_arrow_writer::UINT64;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return f.ok;
+	}
+}
+
+
+
+class Glicko2_arrow_writer_impl
+{
+	public:
+
+		std::vector<Column> columns;
+		std::vector<Block>  blocks;
+		std::FILE*          file;
+		std::int64_t        offset;
+		bool                ok;
+
+		Glicko2_arrow_writer_impl() : file(0), offset(0), ok(false) {}
+
+		void Write(const void* data, std::size_t size)
+		{
+			ok     = ok && (size == 0 || std::fwrite(data,1,size,file) == size);
+			offset += (std::int64_t)size;
+		}
+
+		void Pad(std::size_t size)
+		{
+			static const unsigned char zeros[body_alignment] = { 0 };
+			Write(zeros,size);
+		}
+
+		// an encapsulated message: continuation marker, length, and flatbuffer,
+		// padded to 8 bytes; returns its size
+		std::int32_t WriteMessage(Builder& b)
+		{
+			b.bytes.resize(Align(b.bytes.size(),8),0);
+
+			std::int32_t length = (std::int32_t)b.bytes.size();
+			Write(&continuation,4);
+			Write(&length,4);
+			Write(&b.bytes[0],b.bytes.size());
+			return 8 + length;
+		}
+};
+
+
+
+class Glicko2_arrow_reader_impl
+{
+	public:
+
+		std::vector<Column>        columns;
+		std::vector<Block>         blocks;
+		std::FILE*                 file;
+		std::int64_t               file_size;
+
+		// the record batch read, its body in 8 byte words so columns are aligned
+		std::vector<std::uint64_t> body;
+		std::vector<const void*>   pointers;
+		std::size_t                rows;
+
+		Glicko2_arrow_reader_impl() : file(0), file_size(0), rows(0) {}
+
+		bool Read(std::int64_t at, void* data, std::size_t size)
+		{
+			return at >= 0 && std::fseek(file,(long)at,SEEK_SET) == 0 && (size == 0 || std::fread(data,1,size,file) == size);
+		}
+
+		bool ReadFooter();
+};
+
+
+
+bool Glicko2_arrow_reader_impl::ReadFooter()
+{
+	char head[6];
+	char tail[10];
+	if ( std::fseek(file,0,SEEK_END) != 0 || (file_size = std::ftell(file)) < 8 + 10 )
+	{
+		return false;
+	}
+	if ( !Read(0,head,6) || std::memcmp(head,file_magic,6) != 0 || !Read(file_size - 10,tail,10) || std::memcmp(tail + 4,file_magic,6) != 0 )
+	{
+		return false;
+	}
+
+	std::int32_t length = 0;
+	std::memcpy(&length,tail,4);
+	if ( length <= 0 || length > file_size - 8 - 10 )
+	{
+		return false;
+	}
+
+	std::vector<unsigned char> footer((std::size_t)length);
+	if ( !Read(file_size - 10 - length,&footer[0],footer.size()) )
+	{
+		return false;
+	}
+
+	// Footer { version, schema, dictionaries, recordBatches }
+	Flat        f(&footer[0],footer.size());
+	std::size_t root = f.Root();
+	if ( !ReadSchema(f,f.Ref(root,1),columns) || f.Length(f.Ref(root,2),block_size) != 0 )
+	{
+		return false;
+	}
+
+	std::size_t batches = f.Ref(root,3);
+	std::size_t count   = f.Length(batches,block_size);
+	blocks.resize(count);
+	for ( std::size_t i=0;f.ok && i<count;i++ )
+	{
+		std::size_t at = batches + 4 + i * block_size;
+		blocks[i].offset   = f.Get<std::int64_t>(at);
+		blocks[i].metadata = f.Get<std::int32_t>(at + 8);
+		blocks[i].body     = f.Get<std::int64_t>(at + 16);
+
+		const Block& block = blocks[i];
+		if ( block.offset < 8 || block.metadata < 8 || block.body < 0 || block.body > file_size - block.offset - block.metadata )
+		{
+			return false;
+		}
+	}
+	return f.ok;
+}
+
+
+
+
+
+
+Glicko2_arrow_writer::Glicko2_arrow_writer() :
+	pimpl(0)
+{
+	pimpl = new Glicko2_arrow_writer_impl;
+}
+
+
+
+Glicko2_arrow_writer::~Glicko2_arrow_writer()
+{
+	Close();
+	delete pimpl;
+}
+
+
+
+void Glicko2_arrow_writer::AddColumn(const char* name, TYPE type)
+{
+	Column column;
+	column.name = name;
+	column.type = type;
+	pimpl->columns.push_back(column);
+}
+
+
+
+bool Glicko2_arrow_writer::Open(const char* path)
+{
+	Close();
+
+	Glicko2_arrow_writer_impl& w = *pimpl;
+	w.file   = std::fopen(path,"wb");
+	w.ok     = w.file != 0;
+	w.offset = 0;
+	w.blocks.clear();
+	if ( !w.ok )
+	{
+		return false;
+	}
+
+	w.Write(file_magic,sizeof(file_magic));
+
+	Builder     b;
+	std::size_t header = PutMessage(b,header_schema,0);
+	std::size_t schema = PutSchema(b,w.columns);
+	b.Point(header,schema);
+	w.WriteMessage(b);
+
+	return w.ok;
+}
+
+
+
+bool Glicko2_arrow_writer::WriteBatch(std::size_t rows, const void* const* columns)
+{
+	Glicko2_arrow_writer_impl& w = *pimpl;
+	if ( w.file == 0 )
+	{
+		return false;
+	}
+
+	// every column has an empty validity bitmap, there being no nulls, and its
+	// values, each buffer starting on the body alignment
+	std::size_t               count = w.columns.size();
+	std::int64_t              body  = 0;
+	std::vector<std::int64_t> lengths(count);
+	for ( std::size_t c=0;c<count;c++ )
+	{
+		lengths[c] = (std::int64_t)(rows * Width(w.columns[c].type));
+		body      += (std::int64_t)Align((std::size_t)lengths[c],body_alignment);
+	}
+
+	// RecordBatch { length, nodes, buffers, compression }
+	Builder            b;
+	std::size_t        header  = PutMessage(b,header_batch,body);
+	const unsigned int sizes[] = { 8, 4, 4, 0 };
+	std::size_t        at[4];
+	std::size_t        batch   = b.Table(sizes,4,at);
+	b.Point(header,batch);
+	b.Put<std::int64_t>(at[0],(std::int64_t)rows);
+
+	std::size_t nodes = b.Vector(count,node_size,8);
+	b.Point(at[1],nodes);
+	std::size_t buffers = b.Vector(2 * count,buffer_size,8);
+	b.Point(at[2],buffers);
+
+	std::int64_t next = 0;
+	for ( std::size_t c=0;c<count;c++ )
+	{
+		b.Put<std::int64_t>(nodes + 4 + c * node_size,(std::int64_t)rows);
+		b.Put<std::int64_t>(nodes + 4 + c * node_size + 8,0);
+
+		std::size_t buffer = buffers + 4 + 2 * c * buffer_size;
+		b.Put<std::int64_t>(buffer,next);
+		b.Put<std::int64_t>(buffer + 8,0);
+		b.Put<std::int64_t>(buffer + buffer_size,next);
+		b.Put<std::int64_t>(buffer + buffer_size + 8,lengths[c]);
+		next += (std::int64_t)Align((std::size_t)lengths[c],body_alignment);
+	}
+
+	Block block;
+	block.offset   = w.offset;
+	block.metadata = w.WriteMessage(b);
+	block.body     = body;
+	w.blocks.push_back(block);
+
+	// the columns themselves, as they are
+	for ( std::size_t c=0;c<count;c++ )
+	{
+		w.Write(columns[c],(std::size_t)lengths[c]);
+		w.Pad(Align((std::size_t)lengths[c],body_alignment) - (std::size_t)lengths[c]);
+	}
+
+	return w.ok;
+}
+
+
+
+bool Glicko2_arrow_writer::Close()
+{
+	Glicko2_arrow_writer_impl& w = *pimpl;
+	if ( w.file == 0 )
+	{
+		return w.ok;
+	}
+
+	// end of stream marker
+	const std::uint32_t eos[2] = { continuation, 0 };
+	w.Write(eos,sizeof(eos));
+
+	// Footer { version, schema, dictionaries, recordBatches }
+	Builder            b;
+	const unsigned int sizes[] = { 2, 4, 4, 4 };
+	std::size_t        at[4];
+	std::size_t        footer = b.Table(sizes,4,at);
+	b.Point(0,footer);
+	b.Put<std::int16_t>(at[0],metadata_v5);
+
+	std::size_t schema = PutSchema(b,w.columns);
+	b.Point(at[1],schema);
+	std::size_t dictionaries = b.Vector(0,block_size,8);
+	b.Point(at[2],dictionaries);
+	std::size_t batches = b.Vector(w.blocks.size(),block_size,8);
+	b.Point(at[3],batches);
+	for ( std::size_t i=0;i<w.blocks.size();i++ )
+	{
+		std::size_t block = batches + 4 + i * block_size;
+		b.Put<std::int64_t>(block,w.blocks[i].offset);
+		b.Put<std::int32_t>(block + 8,w.blocks[i].metadata);
+		b.Put<std::int64_t>(block + 16,w.blocks[i].body);
+	}
+	b.bytes.resize(Align(b.bytes.size(),8),0);
+
+	std::int32_t length = (std::int32_t)b.bytes.size();
+	w.Write(&b.bytes[0],b.bytes.size());
+	w.Write(&length,4);
+	w.Write(file_magic,6);
+
+	w.ok   = std::fclose(w.file) == 0 && w.ok;
+	w.file = 0;
+	return w.ok;
+}
+
+
+
+
+
+
+Glicko2_arrow_reader::Glicko2_arrow_reader() :
+	pimpl(0)
+{
+	pimpl = new Glicko2_arrow_reader_impl;
+}
+
+
+
+Glicko2_arrow_reader::~Glicko2_arrow_reader()
+{
+	Close();
+	delete pimpl;
+}
+
+
+
+bool Glicko2_arrow_reader::Open(const char* path)
+{
+	Close();
+
+	pimpl->file = std::fopen(path,"rb");
+	if ( pimpl->file == 0 || !pimpl->ReadFooter() )
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+
+
+void Glicko2_arrow_reader::Close()
+{
+	Glicko2_arrow_reader_impl& r = *pimpl;
+	if ( r.file != 0 )
+	{
+		std::fclose(r.file);
+		r.file = 0;
+	}
+	r.columns.clear();
+	r.blocks.clear();
+	r.body.clear();
+	r.pointers.clear();
+	r.rows = 0;
+}
+
+
+
+unsigned int Glicko2_arrow_reader::GetColumnCount() const
+{
+	return (unsigned int)pimpl->columns.size();
+}
+
+
+
+const char* Glicko2_arrow_reader::GetColumnName(unsigned int column) const
+{
+	return pimpl->columns[column].name.c_str();
+}
+
+
+
+Glicko2_arrow_writer::TYPE Glicko2_arrow_reader::GetColumnType(unsigned int column) const
+{
+	return pimpl->columns[column].type;
+}
+
+
+
+unsigned int Glicko2_arrow_reader::FindColumn(const char* name) const
+{
+	for ( unsigned int c=0;c<pimpl->columns.size();c++ )
+	{
+		if ( pimpl->columns[c].name == name )
+		{
+			return c;
+		}
+	}
+	return not_found;
+}
+
+
+
+std::size_t Glicko2_arrow_reader::GetBatchCount() const
+{
+	return pimpl->blocks.size();
+}
+
+
+
+bool Glicko2_arrow_reader::ReadBatch(std::size_t batch)
+{
+	Glicko2_arrow_reader_impl& r = *pimpl;
+	r.pointers.clear();
+	r.rows = 0;
+	if ( r.file == 0 || batch >= r.blocks.size() )
+	{
+		return false;
+	}
+
+	const Block&               block = r.blocks[batch];
+	std::vector<unsigned char> metadata((std::size_t)block.metadata);
+	if ( !r.Read(block.offset,&metadata[0],metadata.size()) )
+	{
+		return false;
+	}
+
+	// the flatbuffer follows its length, and the continuation marker before
+	// that in all but very old files
+	std::uint32_t marker = 0;
+	std::memcpy(&marker,&metadata[0],4);
+	std::size_t start = marker == continuation ? 8 : 4;
+
+	Flat        f(&metadata[start],metadata.size() - start);
+	std::size_t root    = f.Root();
+	std::size_t message = f.Ref(root,2);
+	if ( f.Scalar<unsigned char>(root,1,0) != header_batch || message == 0 || f.Ref(message,3) != 0 )
+	{
+		return false;
+	}
+
+	std::int64_t rows    = f.Scalar<std::int64_t>(message,0,0);
+	std::size_t  count   = r.columns.size();
+	std::size_t  nodes   = f.Ref(message,1);
+	std::size_t  buffers = f.Ref(message,2);
+	if ( rows < 0 || rows > block.body || f.Length(nodes,node_size) != count || f.Length(buffers,buffer_size) != 2 * count )
+	{
+		return false;
+	}
+
+	std::vector<std::int64_t> offsets(count);
+	for ( std::size_t c=0;f.ok && c<count;c++ )
+	{
+		std::size_t  node   = nodes + 4 + c * node_size;
+		std::size_t  buffer = buffers + 4 + (2 * c + 1) * buffer_size;
+		std::int64_t offset = f.Get<std::int64_t>(buffer);
+		std::int64_t length = f.Get<std::int64_t>(buffer + 8);
+
+		// no nulls, and all of the values in the body, aligned
+		std::int64_t needed = rows * (std::int64_t)Width(r.columns[c].type);
+		if ( f.Get<std::int64_t>(node) != rows || f.Get<std::int64_t>(node + 8) != 0 || offset < 0 || offset % 8 != 0 || length < needed || offset > block.body - length )
+		{
+			return false;
+		}
+		offsets[c] = offset;
+	}
+	if ( !f.ok )
+	{
+		return false;
+	}
+
+	r.body.resize(((std::size_t)block.body + 7) / 8);
+	if ( !r.Read(block.offset + block.metadata,r.body.empty() ? 0 : &r.body[0],(std::size_t)block.body) )
+	{
+		return false;
+	}
+
+	const unsigned char* base = r.body.empty() ? 0 : reinterpret_cast<const unsigned char*>(&r.body[0]);
+	for ( std::size_t c=0;c<count;c++ )
+	{
+		r.pointers.push_back(base ? base + offsets[c] : 0);
+	}
+	r.rows = (std::size_t)rows;
+	return true;
+}
+
+
+
+std::size_t Glicko2_arrow_reader::GetRowCount() const
+{
+	return pimpl->rows;
+}
+
+
+
+const void* Glicko2_arrow_reader::GetColumn(unsigned int column) const
+{
+	return pimpl->pointers[column];
+}
@@ -0,0 +1,262 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_arrow_h__
+#define __glicko2_arrow_h__
+
+
+
+#include <cstddef>
+
+
+
+class Glicko2_arrow_writer_impl;
+class Glicko2_arrow_reader_impl;
+
+
+
+/**
+ * Writer of Arrow IPC files (the random access "Feather v2" format) holding
+ * columns of fixed width numbers without nulls.
+ *
+ * A file is a schema followed by any number of record batches, each of which
+ * holds a number of rows of every column.  Columns are written straight from
+ * the caller's arrays, without conversion or copying, so the file can be
+ * loaded as is by anything that reads Arrow: pyarrow, DuckDB, Polars, Spark,
+ * and so on.  Numbers are written in host byte order, which Arrow requires to
+ * be little endian in practice.
+ */
+class Glicko2_arrow_writer
+{
+	public:
+
+
+
+		/**
+		 * Column types.
+		 */
+		enum TYPE
+		{
+			UINT32,
+			UINT64,
+			INT64,
+			DOUBLE
+		};
+
+
+
+		/**
+		 * Constructor.
+		 */
+		Glicko2_arrow_writer();
+
+		/**
+		 * Destructor.  Closes the file.
+		 */
+		~Glicko2_arrow_writer();
+
+
+
+		/**
+		 * Add a column to the schema.  Columns must be added before Open().
+		 *
+		 * @param name Column name.
+		 * @param type Column type.
+		 */
+		void AddColumn(const char* name, TYPE type);
+
+		/**
+		 * Create a file and write the schema to it.
+		 *
+		 * @param path Path of the file.
+		 *
+		 * @return false on a file error.
+		 */
+		bool Open(const char* path);
+
+		/**
+		 * Write a record batch.
+		 *
+		 * @param rows    Number of rows.
+		 * @param columns One array of rows values per column, in the order the
+		 *                columns were added.
+		 *
+		 * @return false on a file error.
+		 */
+		bool WriteBatch(std::size_t rows, const void* const* columns);
+
+		/**
+		 * Write the footer and close the file.
+		 *
+		 * @return false on a file error, now or in an earlier write.
+		 */
+		bool Close();
+
+
+
+	private:
+
+		Glicko2_arrow_writer(const Glicko2_arrow_writer&);
+		Glicko2_arrow_writer& operator=(const Glicko2_arrow_writer&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_arrow_writer_impl* pimpl;
+
+};
+
+
+
+
+
+
+/**
+ * Reader of Arrow IPC files holding columns of fixed width numbers without
+ * nulls, such as those Glicko2_arrow_writer writes.
+ *
+ * Record batches are read one at a time, each straight into a buffer the
+ * columns are then used from in place.
+ */
+class Glicko2_arrow_reader
+{
+	public:
+
+
+
+		/**
+		 * Returned by FindColumn() for columns not in the file.
+		 */
+		static const unsigned int not_found = 0xFFFFFFFFu;
+
+
+
+		/**
+		 * Constructor.
+		 */
+		Glicko2_arrow_reader();
+
+		/**
+		 * Destructor.  Closes the file.
+		 */
+		~Glicko2_arrow_reader();
+
+
+
+		/**
+		 * Open a file and read its schema and list of record batches.
+		 *
+		 * @param path Path of the file.
+		 *
+		 * @return false on a file error, if the file is not an Arrow IPC file, or
+		 *         if it has columns of types other than Glicko2_arrow_writer's.
+		 */
+		bool Open(const char* path);
+
+		/**
+		 * Close the file.
+		 */
+		void Close();
+
+
+
+		/**
+		 * @return Number of columns.
+		 */
+		unsigned int GetColumnCount() const;
+
+		/**
+		 * @param column Column number.
+		 *
+		 * @return Column name.
+		 */
+		const char* GetColumnName(unsigned int column) const;
+
+		/**
+		 * @param column Column number.
+		 *
+		 * @return Column type.
+		 */
+		Glicko2_arrow_writer::TYPE GetColumnType(unsigned int column) const;
+
+		/**
+		 * Find a column by name.
+		 *
+		 * @param name Column name.
+		 *
+		 * @return Column number, or not_found.
+		 */
+		unsigned int FindColumn(const char* name) const;
+
+		/**
+		 * @return Number of record batches.
+		 */
+		std::size_t GetBatchCount() const;
+
+
+
+		/**
+		 * Read a record batch, replacing the one read before.
+		 *
+		 * @param batch Record batch number.
+		 *
+		 * @return false on a file error, or if the batch is malformed, has nulls,
+		 *         or is compressed.
+		 */
+		bool ReadBatch(std::size_t batch);
+
+		/**
+		 * @return Number of rows in the record batch read.
+		 */
+		std::size_t GetRowCount() const;
+
+		/**
+		 * Get a column of the record batch read.  Valid until the next batch is
+		 * read.
+		 *
+		 * @param column Column number.
+		 *
+		 * @return Array of GetRowCount() values of the column's type.
+		 */
+		const void* GetColumn(unsigned int column) const;
+
+
+
+	private:
+
+		Glicko2_arrow_reader(const Glicko2_arrow_reader&);
+		Glicko2_arrow_reader& operator=(const Glicko2_arrow_reader&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_arrow_reader_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_arrow_h__
@@ -0,0 +1,114 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_compact_h__
+#define __glicko2_compact_h__
+
+
+
+#include "glicko2_math.h"
+
+#include <cstdint>
+
+
+
+/**
+ * Compact 16 byte player record.
+ *
+ * Holds a player's Glicko-2 rating state in single precision, plus the rating
+ * period in which the player last played, for callers that keep very large
+ * populations in memory in their own arrays.  Single precision keeps a Glicko
+ * rating to within about 0.001 of its full precision value.  Records are
+ * unpacked to a Glicko2_rating for computation and packed again afterwards.
+ *
+ * This is only a conversion helper; nothing in the library stores ratings in
+ * it.  Glicko2_population keeps its hot tier at full precision and its cold
+ * tier in its own quantized blocks.
+ */
+struct Glicko2_compact
+{
+	/**
+	 * Glicko-2 rating (mu).
+	 */
+	float rating;
+
+	/**
+	 * Glicko-2 rating deviation (phi).
+	 */
+	float deviation;
+
+	/**
+	 * Rating volatility (sigma).
+	 */
+	float volatility;
+
+	/**
+	 * Rating period in which the player last had a result.
+	 */
+	std::uint32_t last_active;
+
+
+
+	/**
+	 * Pack a full precision rating state.
+	 *
+	 * @param state       Rating state.
+	 * @param last_active Rating period in which the player last had a result.
+	 *
+	 * @return Packed record.
+	 */
+	static Glicko2_compact Pack(const Glicko2_rating& state, std::uint32_t last_active)
+	{
+		Glicko2_compact record;
+		record.rating      = (float)state.rating;
+		record.deviation   = (float)state.deviation;
+		record.volatility  = (float)state.volatility;
+		record.last_active = last_active;
+		return record;
+	}
+
+	/**
+	 * Unpack to a full precision rating state.
+	 *
+	 * @return Rating state.
+	 */
+	Glicko2_rating Unpack() const
+	{
+		Glicko2_rating state;
+		state.rating     = rating;
+		state.deviation  = deviation;
+		state.volatility = volatility;
+		return state;
+	}
+};
+
+
+
+static_assert(sizeof(Glicko2_compact) == 16, "Glicko2_compact must stay 16 bytes");
+
+
+
+#endif // __glicko2_compact_h__
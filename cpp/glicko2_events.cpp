@@ -0,0 +1,216 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_events.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+
+
+namespace
+{
+	// an event as words, each read and written atomically, so a consumer
+	// racing the producer reads a torn event at worst, and sees that it did
+	const unsigned int event_words = 7;
+
+
+
+	std::uint64_t Bits(double value)
+	{
+		std::uint64_t bits;
+		std::memcpy(&bits,&value,sizeof(bits));
+		return bits;
+	}
+
+
+
+	double FromBits(std::uint64_t bits)
+	{
+		double value;
+		std::memcpy(&value,&bits,sizeof(value));
+		return value;
+	}
+
+
+
+	// holds event n once sequence is 2n + 2; odd while being written
+	struct Slot
+	{
+		std::atomic<std::uint64_t> sequence;
+		std::atomic<std::uint64_t> words[event_words];
+	};
+
+
+
+	double Movement(const Glicko2_event& event)
+	{
+		return std::fabs(event.after.rating - event.before.rating);
+	}
+}
+
+
+
+class Glicko2_events_impl
+{
+	public:
+
+		std::vector<Slot>          slots;
+		std::uint64_t              mask;
+		std::atomic<std::uint64_t> published;
+
+		Glicko2_events_impl(std::size_t capacity) :
+			slots(capacity),
+			mask(capacity - 1),
+			published(0)
+		{
+			for ( std::size_t i=0;i<capacity;i++ )
+			{
+				slots[i].sequence.store(0,std::memory_order_relaxed);
+			}
+		}
+};
+
+
+
+
+
+
+Glicko2_events::Glicko2_events(std::size_t capacity) :
+	pimpl(0)
+{
+	std::size_t size = 1;
+	while ( size < capacity )
+	{
+		size <<= 1;
+	}
+	pimpl = new Glicko2_events_impl(size);
+}
+
+
+
+Glicko2_events::~Glicko2_events()
+{
+	delete pimpl;
+}
+
+
+
+void Glicko2_events::Publish(const Glicko2_event& event)
+{
+	Glicko2_events_impl& e = *pimpl;
+
+	std::uint64_t n    = e.published.load(std::memory_order_relaxed);
+	Slot&         slot = e.slots[n & e.mask];
+
+	// mark the slot as being written before touching the event in it; each
+	// word is stored with release, so a consumer that loads one sees the mark
+	slot.sequence.store(2 * n + 1,std::memory_order_relaxed);
+
+	slot.words[0].store((std::uint64_t)event.player << 32 | event.period,std::memory_order_release);
+	slot.words[1].store(Bits(event.before.rating),std::memory_order_release);
+	slot.words[2].store(Bits(event.before.deviation),std::memory_order_release);
+	slot.words[3].store(Bits(event.before.volatility),std::memory_order_release);
+	slot.words[4].store(Bits(event.after.rating),std::memory_order_release);
+	slot.words[5].store(Bits(event.after.deviation),std::memory_order_release);
+	slot.words[6].store(Bits(event.after.volatility),std::memory_order_release);
+
+	slot.sequence.store(2 * n + 2,std::memory_order_release);
+	e.published.store(n + 1,std::memory_order_release);
+}
+
+
+
+std::uint64_t Glicko2_events::GetPublished() const
+{
+	return pimpl->published.load(std::memory_order_acquire);
+}
+
+
+
+std::size_t Glicko2_events::Read(std::uint64_t& cursor, Glicko2_event* events, std::size_t count) const
+{
+	const Glicko2_events_impl& e        = *pimpl;
+	std::uint64_t              capacity = e.mask + 1;
+	std::size_t                read     = 0;
+	while ( read < count )
+	{
+		std::uint64_t published = e.published.load(std::memory_order_acquire);
+		if ( cursor >= published )
+		{
+			break;
+		}
+
+		// too far behind: move on to the oldest event held
+		if ( published - cursor > capacity )
+		{
+			cursor = published - capacity;
+		}
+
+		const Slot&   slot  = e.slots[cursor & e.mask];
+		std::uint64_t first = slot.sequence.load(std::memory_order_acquire);
+		if ( first != 2 * cursor + 2 )
+		{
+			// overwritten since published was read; look again
+			continue;
+		}
+
+		std::uint64_t words[event_words];
+		for ( unsigned int w=0;w<event_words;w++ )
+		{
+			words[w] = slot.words[w].load(std::memory_order_acquire);
+		}
+		if ( slot.sequence.load(std::memory_order_relaxed) != first )
+		{
+			continue;
+		}
+
+		Glicko2_event& event = events[read++];
+		event.player            = (unsigned int)(words[0] >> 32);
+		event.period            = (unsigned int)words[0];
+		event.before.rating     = FromBits(words[1]);
+		event.before.deviation  = FromBits(words[2]);
+		event.before.volatility = FromBits(words[3]);
+		event.after.rating      = FromBits(words[4]);
+		event.after.deviation   = FromBits(words[5]);
+		event.after.volatility  = FromBits(words[6]);
+		cursor++;
+	}
+	return read;
+}
+
+
+
+void Glicko2_events::SelectTopMovers(const Glicko2_event* events, std::size_t count, std::size_t top, std::vector<Glicko2_event>& movers)
+{
+	movers.assign(events,events + count);
+	top = top < count ? top : count;
+
+	std::partial_sort(movers.begin(),movers.begin() + top,movers.end(),[](const Glicko2_event& a, const Glicko2_event& b) { return Movement(a) > Movement(b); });
+	movers.resize(top);
+}
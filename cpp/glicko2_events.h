@@ -0,0 +1,161 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_events_h__
+#define __glicko2_events_h__
+
+
+
+#include "glicko2_math.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+
+class Glicko2_events_impl;
+
+
+
+/**
+ * A change to one player's rating state.
+ */
+struct Glicko2_event
+{
+	/**
+	 * Player index.
+	 */
+	unsigned int player;
+
+	/**
+	 * Rating period from which the new state is in effect.
+	 */
+	unsigned int period;
+
+	/**
+	 * State before the change, on the Glicko-2 scale.
+	 */
+	Glicko2_rating before;
+
+	/**
+	 * State after the change, on the Glicko-2 scale.
+	 */
+	Glicko2_rating after;
+};
+
+
+
+/**
+ * Bounded ring of rating change events, written by one thread and read by any
+ * number of others at once, without locks.
+ *
+ * Every event published gets the next sequence number.  Each consumer keeps a
+ * cursor, the sequence number of the next event it wants, and reads from it
+ * at its own pace; events are never removed by reading.  The ring holds the
+ * most recent capacity events, so a consumer that falls further behind than
+ * that loses the oldest events it has not read, and is moved on to the oldest
+ * still held.  Publishing never waits for consumers.
+ *
+ * A Glicko2_population given a ring with SetEvents() publishes an event for
+ * every player Update() or Rollback() changes.
+ */
+class Glicko2_events
+{
+	public:
+
+
+
+		/**
+		 * Constructor.
+		 *
+		 * @param capacity Most events held, rounded up to a power of two.
+		 */
+		Glicko2_events(std::size_t capacity = 65536);
+
+		/**
+		 * Destructor.
+		 */
+		~Glicko2_events();
+
+
+
+		/**
+		 * Publish an event.  Only one thread may publish.
+		 *
+		 * @param event Event.
+		 */
+		void Publish(const Glicko2_event& event);
+
+		/**
+		 * @return Number of events published so far, which is also the cursor
+		 *         of a consumer that wants only events published from now on.
+		 */
+		std::uint64_t GetPublished() const;
+
+		/**
+		 * Read events, from any thread.
+		 *
+		 * @param cursor Sequence number of the first event to read; advanced past
+		 *               the events read, and past any lost.
+		 * @param events Receives the events.
+		 * @param count  Most events to read.
+		 *
+		 * @return Number of events read.
+		 */
+		std::size_t Read(std::uint64_t& cursor, Glicko2_event* events, std::size_t count) const;
+
+
+
+		/**
+		 * Select the events with the largest changes in Glicko rating, up or
+		 * down, such as those of one period, without looking at any other
+		 * player.
+		 *
+		 * @param events Events.
+		 * @param count  Number of events.
+		 * @param top    Number of events to select.
+		 * @param movers Receives the selected events, largest change first.
+		 */
+		static void SelectTopMovers(const Glicko2_event* events, std::size_t count, std::size_t top, std::vector<Glicko2_event>& movers);
+
+
+
+	private:
+
+		Glicko2_events(const Glicko2_events&);
+		Glicko2_events& operator=(const Glicko2_events&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_events_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_events_h__
@@ -0,0 +1,747 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+// 64 bit file offsets on 32 bit systems too
+#if !defined(_WIN32) && !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "glicko2_external.h"
+#include "glicko2_trace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+
+
+
+namespace
+{
+	// first bytes of a player table
+	const char table_magic[8] = { 'G','L','I','C','K','O','2','T' };
+
+	// buffer per file being read or written
+	const std::size_t file_buffer_bytes = 64 * 1024;
+
+
+
+	// a result, keyed by the player whose rating is looked up next: the
+	// opponent, with other the player the result is for
+	struct Result
+	{
+		std::uint64_t key;
+		std::uint64_t other;
+		double        score;
+	};
+
+	// a result with its opponent's rating looked up, keyed by the player it is for
+	struct Rated
+	{
+		std::uint64_t key;
+		double        rating;
+		double        deviation;
+		double        score;
+	};
+
+	template<class T>
+	bool KeyLess(const T& a, const T& b)
+	{
+		return a.key < b.key;
+	}
+
+	Glicko2_rating DefaultState()
+	{
+		return Glicko2_math::FromGlicko(1500.0,350.0,0.06);
+	}
+
+	// fseek() and ftell() with 64 bit offsets, as tables can pass 2 GB
+	bool Seek(std::FILE* file, std::int64_t offset, int origin)
+	{
+#if defined(_WIN32)
+		return _fseeki64(file,offset,origin) == 0;
+#else
+		return fseeko(file,(off_t)offset,origin) == 0;
+#endif
+	}
+
+	std::int64_t Tell(std::FILE* file)
+	{
+#if defined(_WIN32)
+		return _ftelli64(file);
+#else
+		return (std::int64_t)ftello(file);
+#endif
+	}
+
+
+
+	// buffered sequential reader of fixed size records
+	template<class T>
+	class Reader
+	{
+		public:
+
+			Reader() : file(0), position(0), count(0), failed(false) {}
+			~Reader() { Close(); }
+
+			bool Open(const char* path, std::int64_t offset)
+			{
+				Close();
+				file = std::fopen(path,"rb");
+				if ( file == 0 || !Seek(file,offset,SEEK_SET) )
+				{
+					failed = true;
+					return false;
+				}
+				buffer.resize(file_buffer_bytes / sizeof(T) + 1);
+				return true;
+			}
+
+			bool Next(T& record)
+			{
+				if ( position == count )
+				{
+					count    = file ? std::fread(&buffer[0],sizeof(T),buffer.size(),file) : 0;
+					position = 0;
+					if ( count == 0 )
+					{
+						failed = failed || (file && std::ferror(file));
+						return false;
+					}
+				}
+				record = buffer[position++];
+				return true;
+			}
+
+			bool Failed() const { return failed; }
+
+			void Close()
+			{
+				if ( file )
+				{
+					std::fclose(file);
+				}
+				file     = 0;
+				position = 0;
+				count    = 0;
+			}
+
+		private:
+
+			Reader(const Reader&);
+			Reader& operator=(const Reader&);
+
+			std::FILE*     file;
+			std::vector<T> buffer;
+			std::size_t    position;
+			std::size_t    count;
+			bool           failed;
+	};
+
+
+
+	std::FILE* OpenWrite(const std::string& path)
+	{
+		std::FILE* file = std::fopen(path.c_str(),"wb");
+		if ( file )
+		{
+			std::setvbuf(file,0,_IOFBF,file_buffer_bytes);
+		}
+		return file;
+	}
+
+
+
+	// open a player table positioned at its first record; a missing table is empty
+	bool OpenTable(const char* path, Reader<Glicko2_external::Player>& reader)
+	{
+		std::FILE* file = std::fopen(path,"rb");
+		if ( file == 0 )
+		{
+			return true;
+		}
+
+		char magic[sizeof(table_magic)];
+		bool ok = std::fread(magic,1,sizeof(magic),file) == sizeof(magic) && std::memcmp(magic,table_magic,sizeof(magic)) == 0;
+		std::fclose(file);
+
+		return ok && reader.Open(path,(std::int64_t)sizeof(table_magic));
+	}
+
+
+
+	// External merge sort by key.  Records are buffered up to a fixed count,
+	// and each full buffer is sorted and written as a run file.  Runs are then
+	// merged through a heap, oldest first on equal keys, so equal keys come out
+	// in the order they went in.  If everything fits in the buffer, no file is
+	// written and the sorted buffer is read back directly.
+	template<class T>
+	class Sorter
+	{
+		public:
+
+			Sorter(const std::string& prefix, std::size_t memory) :
+				prefix(prefix),
+				capacity(std::max<std::size_t>(1,memory / sizeof(T))),
+				position(0),
+				spilled(0),
+				names(0),
+				failed(false)
+			{
+			}
+
+			~Sorter() { Clear(); }
+
+			bool Add(const T& record)
+			{
+				buffer.push_back(record);
+				return buffer.size() < capacity ? !failed : Spill();
+			}
+
+			// prepare to read back in key order, merging runs down to a number
+			// that can be read at once within memory
+			bool Finish(std::size_t memory)
+			{
+				std::stable_sort(buffer.begin(),buffer.end(),KeyLess<T>);
+				position = 0;
+				if ( runs.empty() )
+				{
+					return !failed;
+				}
+
+				if ( !buffer.empty() && !Spill() )
+				{
+					return false;
+				}
+				std::vector<T>().swap(buffer);
+
+				std::size_t fan_in = std::max<std::size_t>(2,memory / file_buffer_bytes);
+				while ( runs.size() > fan_in )
+				{
+					std::vector<std::string> group(runs.begin(),runs.begin() + fan_in);
+					runs.erase(runs.begin(),runs.begin() + fan_in);
+
+					// the merged run replaces the oldest runs, so stays first
+					std::string path = NewPath();
+					std::FILE*  file = OpenWrite(path);
+					runs.insert(runs.begin(),path);
+					if ( file == 0 || !OpenMerge(group) )
+					{
+						failed = true;
+					}
+
+					T record;
+					while ( !failed && NextMerged(record) )
+					{
+						failed = std::fwrite(&record,sizeof(T),1,file) != 1;
+					}
+					failed = (file && std::fclose(file) != 0) || failed;
+
+					CloseMerge();
+					for ( unsigned int i=0;i<group.size();i++ )
+					{
+						std::remove(group[i].c_str());
+					}
+					if ( failed )
+					{
+						return false;
+					}
+				}
+
+				return OpenMerge(runs);
+			}
+
+			bool Next(T& record)
+			{
+				if ( runs.empty() )
+				{
+					if ( position == buffer.size() )
+					{
+						return false;
+					}
+					record = buffer[position++];
+					return true;
+				}
+				return NextMerged(record);
+			}
+
+			bool Failed() const { return failed; }
+
+			unsigned int GetRunCount() const { return spilled; }
+
+			// discard everything, removing run files
+			void Clear()
+			{
+				CloseMerge();
+				for ( unsigned int i=0;i<runs.size();i++ )
+				{
+					std::remove(runs[i].c_str());
+				}
+				runs.clear();
+				std::vector<T>().swap(buffer);
+				position = 0;
+				spilled  = 0;
+				failed   = false;
+			}
+
+		private:
+
+			Sorter(const Sorter&);
+			Sorter& operator=(const Sorter&);
+
+			std::string NewPath()
+			{
+				char number[32];
+				std::snprintf(number,sizeof(number),"%u.run",names++);
+				return prefix + number;
+			}
+
+			bool Spill()
+			{
+				std::stable_sort(buffer.begin(),buffer.end(),KeyLess<T>);
+
+				std::string path = NewPath();
+				std::FILE*  file = OpenWrite(path);
+				runs.push_back(path);
+				spilled++;
+
+				failed = file == 0 || std::fwrite(&buffer[0],sizeof(T),buffer.size(),file) != buffer.size() || failed;
+				failed = (file && std::fclose(file) != 0) || failed;
+
+				buffer.clear();
+				return !failed;
+			}
+
+			bool OpenMerge(const std::vector<std::string>& paths)
+			{
+				CloseMerge();
+				readers.resize(paths.size());
+				heads.resize(paths.size());
+				for ( unsigned int i=0;i<paths.size();i++ )
+				{
+					readers[i] = new Reader<T>;
+					if ( !readers[i]->Open(paths[i].c_str(),0) )
+					{
+						failed = true;
+						return false;
+					}
+					if ( readers[i]->Next(heads[i]) )
+					{
+						heap.push(std::make_pair(heads[i].key,i));
+					}
+				}
+				return true;
+			}
+
+			bool NextMerged(T& record)
+			{
+				if ( heap.empty() )
+				{
+					return false;
+				}
+
+				unsigned int i = heap.top().second;
+				heap.pop();
+				record = heads[i];
+
+				if ( readers[i]->Next(heads[i]) )
+				{
+					heap.push(std::make_pair(heads[i].key,i));
+				}
+				else if ( readers[i]->Failed() )
+				{
+					failed = true;
+				}
+				return true;
+			}
+
+			void CloseMerge()
+			{
+				for ( unsigned int i=0;i<readers.size();i++ )
+				{
+					delete readers[i];
+				}
+				readers.clear();
+				heads.clear();
+				heap = Heap();
+			}
+
+			typedef std::pair<std::uint64_t,unsigned int> Entry;
+			typedef std::priority_queue<Entry,std::vector<Entry>,std::greater<Entry> > Heap;
+
+			std::string               prefix;
+			std::size_t               capacity;
+			std::vector<T>            buffer;
+			std::size_t               position;
+			std::vector<std::string>  runs;
+			unsigned int              spilled;
+			unsigned int              names;
+			bool                      failed;
+			std::vector<Reader<T>*>   readers;
+			std::vector<T>            heads;
+			Heap                      heap;
+	};
+
+
+
+	std::string RunPrefix(const char* directory, const void* owner, const char* name)
+	{
+		char unique[64];
+		std::snprintf(unique,sizeof(unique),"/glicko2_%p_%s_",owner,name);
+		return std::string(directory) + unique;
+	}
+}
+
+
+
+class Glicko2_external_impl
+{
+	public:
+
+		Glicko2_external_impl(const char* table, const char* directory, std::size_t memory);
+
+		std::string table;
+		std::size_t memory;
+
+		// results of the open period, by opponent
+		Sorter<Result> results;
+		std::uint64_t  result_count;
+
+		// results with opponents' ratings, by player
+		Sorter<Rated> rated;
+
+		// first pass: look up every opponent's rating
+		bool Join();
+
+		// second pass: write the updated table
+		bool Rate();
+};
+
+
+
+Glicko2_external_impl::Glicko2_external_impl(const char* table, const char* directory, std::size_t memory) :
+	table(table),
+	memory(memory),
+	results(RunPrefix(directory,this,"results"),memory / 2),
+	result_count(0),
+	rated(RunPrefix(directory,this,"rated"),memory / 2)
+{
+}
+
+
+
+bool Glicko2_external_impl::Join()
+{
+	GLICKO2_TRACE_SCOPE(GRAPH_BUILD);
+
+	Reader<Glicko2_external::Player> players;
+	if ( !results.Finish(memory / 2) || !OpenTable(table.c_str(),players) )
+	{
+		return false;
+	}
+
+	// both streams are in id order, so each table record is read once
+	Glicko2_external::Player player;
+	bool                     have_player = players.Next(player);
+
+	Result result;
+	while ( results.Next(result) )
+	{
+		while ( have_player && player.id < result.key )
+		{
+			have_player = players.Next(player);
+		}
+
+		Glicko2_rating opponent = have_player && player.id == result.key ? player.state : DefaultState();
+
+		Rated entry;
+		entry.key       = result.other;
+		entry.rating    = opponent.rating;
+		entry.deviation = opponent.deviation;
+		entry.score     = result.score;
+		if ( !rated.Add(entry) )
+		{
+			return false;
+		}
+	}
+
+	return !results.Failed() && !players.Failed();
+}
+
+
+
+bool Glicko2_external_impl::Rate()
+{
+	Reader<Glicko2_external::Player> players;
+	if ( !rated.Finish(memory) || !OpenTable(table.c_str(),players) )
+	{
+		return false;
+	}
+
+	std::string path = table + ".new";
+	std::FILE*  file = OpenWrite(path);
+	if ( file == 0 )
+	{
+		return false;
+	}
+	bool ok = std::fwrite(table_magic,1,sizeof(table_magic),file) == sizeof(table_magic);
+
+	Glicko2_external::Player player;
+	bool                     have_player = players.Next(player);
+	Rated                    entry       = Rated();
+	bool                     have_entry  = rated.Next(entry);
+
+	while ( ok && (have_player || have_entry) )
+	{
+		Glicko2_external::Player current;
+		if ( have_player && (!have_entry || player.id < entry.key) )
+		{
+			// no results; copied as is
+			ok          = std::fwrite(&player,sizeof(player),1,file) == 1;
+			have_player = players.Next(player);
+			continue;
+		}
+
+		if ( have_player && player.id == entry.key )
+		{
+			current     = player;
+			have_player = players.Next(player);
+		}
+		else
+		{
+			current.id    = entry.key;
+			current.state = DefaultState();
+		}
+
+		// sum this player's results a block at a time, as Glicko2_math::Update()
+		// would with them all in memory
+		double       ratings[Glicko2_math::block_size];
+		double       deviations[Glicko2_math::block_size];
+		double       scores[Glicko2_math::block_size];
+		unsigned int count        = 0;
+		double       variance_sum = 0.0;
+		double       delta_sum    = 0.0;
+		while ( have_entry && entry.key == current.id )
+		{
+			ratings[count]    = entry.rating;
+			deviations[count] = entry.deviation;
+			scores[count]     = entry.score;
+			if ( ++count == Glicko2_math::block_size )
+			{
+				Glicko2_math::Accumulate(current.state.rating,ratings,deviations,scores,count,variance_sum,delta_sum);
+				count = 0;
+			}
+			have_entry = rated.Next(entry);
+		}
+		if ( count > 0 )
+		{
+			Glicko2_math::Accumulate(current.state.rating,ratings,deviations,scores,count,variance_sum,delta_sum);
+		}
+
+		double variance = 1.0 / variance_sum;
+		Glicko2_math::Finalize(current.state,Glicko2_math::SolveVolatility(current.state.deviation,current.state.volatility,variance,variance*delta_sum),variance_sum,delta_sum);
+
+		ok = std::fwrite(&current,sizeof(current),1,file) == 1;
+	}
+
+	ok = std::fclose(file) == 0 && ok && !rated.Failed() && !players.Failed();
+	players.Close();
+
+	// swap in the new table only once it is complete
+	if ( !ok || std::rename(path.c_str(),table.c_str()) != 0 )
+	{
+		std::remove(path.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+
+
+
+
+Glicko2_external::Glicko2_external(const char* table, const char* directory, std::size_t memory) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_external_impl(table,directory,memory);
+}
+
+
+
+Glicko2_external::~Glicko2_external()
+{
+	delete pimpl;
+}
+
+
+
+bool Glicko2_external::AddResult(std::uint64_t player, std::uint64_t opponent, double score)
+{
+	Result result;
+	result.key   = opponent;
+	result.other = player;
+	result.score = score;
+
+	pimpl->result_count++;
+	return pimpl->results.Add(result);
+}
+
+
+
+bool Glicko2_external::AddMatch(std::uint64_t player, std::uint64_t opponent, Glicko2::RESULT result)
+{
+	double score = Glicko2_math::Score(result == Glicko2::WIN,result == Glicko2::DRAW);
+
+	bool ok = AddResult(player,opponent,score);
+	return AddResult(opponent,player,1.0 - score) && ok;
+}
+
+
+
+std::uint64_t Glicko2_external::GetResultCount() const
+{
+	return pimpl->result_count;
+}
+
+
+
+unsigned int Glicko2_external::GetRunCount() const
+{
+	return pimpl->results.GetRunCount() + pimpl->rated.GetRunCount();
+}
+
+
+
+bool Glicko2_external::Update()
+{
+	// the results are no longer needed once joined, so their memory and files
+	// are released before the second pass
+	bool ok = pimpl->Join();
+	pimpl->results.Clear();
+	ok = ok && pimpl->Rate();
+	pimpl->rated.Clear();
+
+	pimpl->result_count = 0;
+	return ok;
+}
+
+
+
+bool Glicko2_external::WriteTable(const char* path, const Player* players, std::size_t count)
+{
+	for ( std::size_t i=1;i<count;i++ )
+	{
+		if ( players[i].id <= players[i-1].id )
+		{
+			return false;
+		}
+	}
+
+	std::FILE* file = OpenWrite(path);
+	if ( file == 0 )
+	{
+		return false;
+	}
+
+	bool ok = std::fwrite(table_magic,1,sizeof(table_magic),file) == sizeof(table_magic);
+	ok = ok && (count == 0 || std::fwrite(players,sizeof(Player),count,file) == count);
+	ok = std::fclose(file) == 0 && ok;
+	return ok;
+}
+
+
+
+bool Glicko2_external::ReadTable(const char* path, std::vector<Player>& players)
+{
+	players.clear();
+
+	Reader<Player> reader;
+	if ( !OpenTable(path,reader) )
+	{
+		return false;
+	}
+
+	Player player;
+	while ( reader.Next(player) )
+	{
+		players.push_back(player);
+	}
+	return !reader.Failed();
+}
+
+
+
+bool Glicko2_external::Find(const char* path, std::uint64_t id, Glicko2_rating& state)
+{
+	std::FILE* file = std::fopen(path,"rb");
+	if ( file == 0 )
+	{
+		return false;
+	}
+
+	char magic[sizeof(table_magic)];
+	bool ok = std::fread(magic,1,sizeof(magic),file) == sizeof(magic) && std::memcmp(magic,table_magic,sizeof(magic)) == 0;
+	ok = ok && Seek(file,0,SEEK_END);
+
+	std::int64_t size  = ok ? Tell(file) : 0;
+	std::size_t  low   = 0;
+	std::size_t  high  = size > (std::int64_t)sizeof(table_magic) ? (std::size_t)(size - (std::int64_t)sizeof(table_magic)) / sizeof(Player) : 0;
+	bool         found = false;
+	while ( ok && !found && low < high )
+	{
+		std::size_t middle = low + (high - low) / 2;
+
+		Player player;
+		ok = Seek(file,(std::int64_t)sizeof(table_magic) + (std::int64_t)middle * (std::int64_t)sizeof(Player),SEEK_SET) && std::fread(&player,sizeof(player),1,file) == 1;
+		if ( !ok )
+		{
+			break;
+		}
+
+		if ( player.id < id )
+		{
+			low = middle + 1;
+		}
+		else if ( id < player.id )
+		{
+			high = middle;
+		}
+		else
+		{
+			state = player.state;
+			found = true;
+		}
+	}
+
+	std::fclose(file);
+	return found;
+}
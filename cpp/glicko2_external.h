@@ -0,0 +1,207 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_external_h__
+#define __glicko2_external_h__
+
+
+
+#include "glicko2.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+
+class Glicko2_external_impl;
+
+
+
+/**
+ * Rating periods for populations too large to hold in memory.
+ *
+ * Players live in a table file, one fixed size record per player in ascending
+ * id order.  Results are added during a rating period as with Glicko2, but by
+ * player id, and are spilled to sorted run files in a temporary directory
+ * whenever the memory budget fills.  Update() closes the period in two passes
+ * over the table:
+ *
+ * 1. the results, merged in opponent order, are joined with the table to look
+ *    up each opponent's rating, and spilled again in player order;
+ * 2. those are merged in player order and joined with the table, writing an
+ *    updated copy of it which then replaces the original.
+ *
+ * Memory use is bounded by the budget no matter how many players or results
+ * there are; when there are more runs than the budget can merge at once they
+ * are merged in several passes.  When a period's results fit in the budget no
+ * run files are written at all.  Players that are not in the table are added
+ * with a rating of 1500, a rating deviation of 350, and a volatility of 0.06
+ * when they first have a result.
+ *
+ * Table and run files are in native byte order, for use on one machine.
+ */
+class Glicko2_external
+{
+	public:
+
+
+
+		/**
+		 * Player table record.
+		 */
+		struct Player
+		{
+			/**
+			 * Player id.
+			 */
+			std::uint64_t id;
+
+			/**
+			 * Rating state, on the Glicko-2 scale.
+			 */
+			Glicko2_rating state;
+		};
+
+
+
+		/**
+		 * Constructor.
+		 *
+		 * @param table     Path of the player table.  A missing table is an empty
+		 *                  one, and is created by the first Update().
+		 * @param directory Directory for run files.
+		 * @param memory    Memory budget in bytes.
+		 */
+		Glicko2_external(const char* table, const char* directory, std::size_t memory = 64 << 20);
+
+		/**
+		 * Destructor.  Discards the results of an open period, and removes any
+		 * run files.
+		 */
+		~Glicko2_external();
+
+
+
+		/**
+		 * Add a result for one player.  Note that no calculation is performed
+		 * until Update() is called.
+		 *
+		 * @param player   Player the result is for.
+		 * @param opponent Other player in contest.
+		 * @param score    1.0 for a win, 0.0 for a loss, 0.5 for a draw, from
+		 *                 the point of view of player.
+		 *
+		 * @return false if a run file could not be written.
+		 */
+		bool AddResult(std::uint64_t player, std::uint64_t opponent, double score);
+
+		/**
+		 * Add a result for both players in a contest.  Note that no calculation is
+		 * performed until Update() is called.
+		 *
+		 * @param player   One player in contest.
+		 * @param opponent Other player in contest.
+		 * @param result   WIN, LOSS, or DRAW; from the point of view of player.
+		 *
+		 * @return false if a run file could not be written.
+		 */
+		bool AddMatch(std::uint64_t player, std::uint64_t opponent, Glicko2::RESULT result);
+
+		/**
+		 * @return Number of results added in the current rating period, counting
+		 *         a match as two.
+		 */
+		std::uint64_t GetResultCount() const;
+
+		/**
+		 * @return Number of run files written in the current rating period.
+		 */
+		unsigned int GetRunCount() const;
+
+
+
+		/**
+		 * Close the rating period: update every player with results in the table,
+		 * and clear all results.  The table is replaced only once the updated
+		 * copy is complete, so it is left unchanged if anything fails.
+		 *
+		 * @return false on a file error, in which case the period's results are
+		 *         discarded.
+		 */
+		bool Update();
+
+
+
+		/**
+		 * Write a player table.
+		 *
+		 * @param path    Path of the table.
+		 * @param players Players, in ascending id order with no repeats.
+		 * @param count   Number of players.
+		 *
+		 * @return false on a file error, or if the ids are out of order.
+		 */
+		static bool WriteTable(const char* path, const Player* players, std::size_t count);
+
+		/**
+		 * Read a whole player table into memory.
+		 *
+		 * @param path    Path of the table.
+		 * @param players Receives the players, in ascending id order.
+		 *
+		 * @return false on a file error.
+		 */
+		static bool ReadTable(const char* path, std::vector<Player>& players);
+
+		/**
+		 * Look up one player in a table, by binary search on the file.
+		 *
+		 * @param path  Path of the table.
+		 * @param id    Player id.
+		 * @param state Receives the player's rating state.
+		 *
+		 * @return false if the player is not in the table, or on a file error.
+		 */
+		static bool Find(const char* path, std::uint64_t id, Glicko2_rating& state);
+
+
+
+	private:
+
+		Glicko2_external(const Glicko2_external&);
+		Glicko2_external& operator=(const Glicko2_external&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_external_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_external_h__
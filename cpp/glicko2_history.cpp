@@ -0,0 +1,428 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_history.h"
+#include "glicko2_population.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+
+namespace
+{
+	// quantization steps per Glicko point, and per unit volatility, as in the
+	// population's cold tier
+	const double rating_steps     = 32.0;
+	const double volatility_steps = 1000000.0;
+
+
+
+	void PutVarint(std::vector<unsigned char>& out, std::uint64_t value)
+	{
+		while ( value >= 0x80 )
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+
+
+
+	std::uint64_t GetVarint(const unsigned char*& in)
+	{
+		std::uint64_t value = 0;
+		unsigned int  shift = 0;
+		while ( *in & 0x80 )
+		{
+			value |= (std::uint64_t)(*in++ & 0x7f) << shift;
+			shift += 7;
+		}
+		value |= (std::uint64_t)(*in++) << shift;
+		return value;
+	}
+
+
+
+	std::uint64_t ZigZag(std::int64_t value)
+	{
+		return ((std::uint64_t)value << 1) ^ (std::uint64_t)(value >> 63);
+	}
+
+
+
+	std::int64_t UnZigZag(std::uint64_t value)
+	{
+		return (std::int64_t)(value >> 1) ^ -(std::int64_t)(value & 1);
+	}
+
+
+
+	// an entry, quantized
+	struct Quantized
+	{
+		std::uint32_t period;
+		std::int64_t  rating;
+		std::int64_t  deviation;
+		std::int64_t  volatility;
+
+		bool SameRating(const Quantized& other) const
+		{
+			return rating == other.rating && deviation == other.deviation && volatility == other.volatility;
+		}
+	};
+
+	Quantized Quantize(unsigned int period, const Glicko2_rating& state)
+	{
+		Quantized q;
+		q.period     = period;
+		q.rating     = std::llround((Glicko2_math::ToGlickoRating(state.rating) - Glicko2_math::center) * rating_steps);
+		q.deviation  = std::llround(Glicko2_math::ToGlickoDeviation(state.deviation) * rating_steps);
+		q.volatility = std::llround(state.volatility * volatility_steps);
+		return q;
+	}
+
+	Glicko2_history_entry Dequantize(const Quantized& q)
+	{
+		Glicko2_history_entry entry;
+		entry.period     = q.period;
+		entry.rating     = (double)q.rating / rating_steps + Glicko2_math::center;
+		entry.deviation  = (double)q.deviation / rating_steps;
+		entry.volatility = (double)q.volatility / volatility_steps;
+		return entry;
+	}
+
+
+
+	// where a player's stream starts afresh
+	struct Point
+	{
+		std::uint32_t period;
+		std::uint32_t offset;
+	};
+
+	// one player's history
+	struct Track
+	{
+		std::vector<unsigned char> bytes;
+		std::vector<Point>         points;
+		unsigned int               count;
+
+		// the last entry, which the next is coded against
+		Quantized last;
+
+		Track() : count(0), last() {}
+
+		// the point to decode from for a period: the last at or before it, or
+		// points.size() if there is none
+		std::size_t FindPoint(unsigned int period) const
+		{
+			std::vector<Point>::const_iterator after = std::upper_bound(points.begin(),points.end(),period,[](unsigned int p, const Point& point) { return p < point.period; });
+			return after == points.begin() ? points.size() : (std::size_t)(after - points.begin()) - 1;
+		}
+	};
+
+
+
+	// walks a track's entries from one of its points
+	class Decoder
+	{
+		public:
+
+			Decoder(const Track& track, std::size_t point, unsigned int interval) :
+				entry(),
+				track(track),
+				in(&track.bytes[0] + track.points[point].offset),
+				point(point),
+				index((unsigned int)point * interval),
+				interval(interval)
+			{
+			}
+
+			// the entry last decoded
+			Quantized entry;
+
+			// where the next entry starts
+			const unsigned char* GetPosition() const
+			{
+				return in;
+			}
+
+			bool Next()
+			{
+				if ( index == track.count )
+				{
+					return false;
+				}
+
+				// entries at a point are coded from nothing, at the point's period
+				if ( index % interval == 0 )
+				{
+					entry.period     = track.points[point++].period;
+					entry.rating     = 0;
+					entry.deviation  = 0;
+					entry.volatility = 0;
+				}
+				entry.period     += (std::uint32_t)GetVarint(in);
+				entry.rating     += UnZigZag(GetVarint(in));
+				entry.deviation  += UnZigZag(GetVarint(in));
+				entry.volatility += UnZigZag(GetVarint(in));
+				index++;
+				return true;
+			}
+
+		private:
+
+			const Track&         track;
+			const unsigned char* in;
+			std::size_t          point;
+			unsigned int         index;
+			unsigned int         interval;
+	};
+}
+
+
+
+class Glicko2_history_impl
+{
+	public:
+
+		unsigned int       interval;
+		std::vector<Track> tracks;
+		std::size_t        entries;
+		unsigned int       version;
+
+		// drop a track's entries from a period on
+		void Truncate(Track& track, unsigned int period);
+
+		// append an entry to a track
+		void Append(Track& track, const Quantized& q);
+};
+
+
+
+void Glicko2_history_impl::Truncate(Track& track, unsigned int period)
+{
+	std::size_t point = track.FindPoint(period);
+	if ( point < track.points.size() && track.points[point].period == period )
+	{
+		// the point's own entry goes too, so the point does
+		point = point == 0 ? track.points.size() : point - 1;
+	}
+	if ( point == track.points.size() )
+	{
+		entries -= track.count;
+		track.bytes.clear();
+		track.points.clear();
+		track.count = 0;
+		return;
+	}
+
+	// keep the entries before the period, after the point
+	Decoder      decoder(track,point,interval);
+	unsigned int kept = (unsigned int)point * interval;
+	std::size_t  cut  = track.points[point].offset;
+	while ( decoder.Next() && decoder.entry.period < period )
+	{
+		track.last = decoder.entry;
+		cut        = (std::size_t)(decoder.GetPosition() - &track.bytes[0]);
+		kept++;
+	}
+
+	entries -= track.count - kept;
+	track.bytes.resize(cut);
+	track.points.resize(kept > point * interval ? point + 1 : point);
+	track.count = kept;
+}
+
+
+
+void Glicko2_history_impl::Append(Track& track, const Quantized& q)
+{
+	Quantized base = track.last;
+	if ( track.count % interval == 0 )
+	{
+		Point point;
+		point.period = q.period;
+		point.offset = (std::uint32_t)track.bytes.size();
+		track.points.push_back(point);
+
+		base.period     = q.period;
+		base.rating     = 0;
+		base.deviation  = 0;
+		base.volatility = 0;
+	}
+
+	PutVarint(track.bytes,q.period - base.period);
+	PutVarint(track.bytes,ZigZag(q.rating - base.rating));
+	PutVarint(track.bytes,ZigZag(q.deviation - base.deviation));
+	PutVarint(track.bytes,ZigZag(q.volatility - base.volatility));
+
+	track.last = q;
+	track.count++;
+	entries++;
+}
+
+
+
+
+
+
+Glicko2_history::Glicko2_history(unsigned int interval) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_history_impl;
+	pimpl->interval = interval > 0 ? interval : 1;
+	pimpl->entries  = 0;
+	pimpl->version  = 0;
+}
+
+
+
+Glicko2_history::~Glicko2_history()
+{
+	delete pimpl;
+}
+
+
+
+void Glicko2_history::Record(const Glicko2_population& population)
+{
+	Glicko2_history_impl& h = *pimpl;
+
+	unsigned int              version = population.GetVersion();
+	std::vector<unsigned int> players;
+	population.GetChangedSince(h.version,players);
+	h.version = version;
+	if ( players.empty() )
+	{
+		return;
+	}
+
+	std::vector<Glicko2_rating> states(players.size());
+	std::vector<unsigned int>   last_active(players.size());
+	population.GetStates(&players[0],players.size(),&states[0],&last_active[0]);
+
+	unsigned int period = population.GetPeriod();
+	for ( std::size_t i=0;i<players.size();i++ )
+	{
+		Add(players[i],period,states[i]);
+	}
+}
+
+
+
+void Glicko2_history::Add(unsigned int player, unsigned int period, const Glicko2_rating& state)
+{
+	Glicko2_history_impl& h = *pimpl;
+	if ( player >= h.tracks.size() )
+	{
+		h.tracks.resize(player + 1);
+	}
+
+	Track& track = h.tracks[player];
+	if ( track.count > 0 && track.last.period >= period )
+	{
+		h.Truncate(track,period);
+	}
+
+	Quantized q = Quantize(period,state);
+	if ( track.count > 0 && track.last.SameRating(q) )
+	{
+		return;
+	}
+	h.Append(track,q);
+}
+
+
+
+bool Glicko2_history::GetAt(unsigned int player, unsigned int period, Glicko2_history_entry& entry) const
+{
+	const Glicko2_history_impl& h = *pimpl;
+	if ( player >= h.tracks.size() )
+	{
+		return false;
+	}
+
+	const Track& track = h.tracks[player];
+	std::size_t  point = track.FindPoint(period);
+	if ( point == track.points.size() )
+	{
+		return false;
+	}
+
+	Decoder   decoder(track,point,h.interval);
+	Quantized found = Quantized();
+	while ( decoder.Next() && decoder.entry.period <= period )
+	{
+		found = decoder.entry;
+	}
+	entry = Dequantize(found);
+	return true;
+}
+
+
+
+void Glicko2_history::GetRange(unsigned int player, unsigned int first, unsigned int last, std::vector<Glicko2_history_entry>& entries) const
+{
+	const Glicko2_history_impl& h = *pimpl;
+	entries.clear();
+	if ( player >= h.tracks.size() || h.tracks[player].count == 0 )
+	{
+		return;
+	}
+
+	const Track& track = h.tracks[player];
+	std::size_t  point = track.FindPoint(first);
+	Decoder      decoder(track,point == track.points.size() ? 0 : point,h.interval);
+	while ( decoder.Next() && decoder.entry.period <= last )
+	{
+		if ( decoder.entry.period >= first )
+		{
+			entries.push_back(Dequantize(decoder.entry));
+		}
+	}
+}
+
+
+
+std::size_t Glicko2_history::GetEntryCount() const
+{
+	return pimpl->entries;
+}
+
+
+
+std::size_t Glicko2_history::GetBytes() const
+{
+	std::size_t bytes = 0;
+	for ( std::size_t i=0;i<pimpl->tracks.size();i++ )
+	{
+		bytes += pimpl->tracks[i].bytes.capacity() + pimpl->tracks[i].points.capacity() * sizeof(Point);
+	}
+	return bytes;
+}
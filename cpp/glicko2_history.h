@@ -0,0 +1,179 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_history_h__
+#define __glicko2_history_h__
+
+
+
+#include "glicko2_math.h"
+
+#include <cstddef>
+#include <vector>
+
+
+
+class Glicko2_population;
+class Glicko2_history_impl;
+
+
+
+/**
+ * A player's rating at some point in its history, on the Glicko scale.
+ */
+struct Glicko2_history_entry
+{
+	/**
+	 * Rating period from which the rating was in effect.
+	 */
+	unsigned int period;
+
+	/**
+	 * Glicko rating.
+	 */
+	double rating;
+
+	/**
+	 * Glicko rating deviation.
+	 */
+	double deviation;
+
+	/**
+	 * Volatility.
+	 */
+	double volatility;
+};
+
+
+
+/**
+ * History of every player's rating, period by period.
+ *
+ * Each player's history is a stream of its own, appended to whenever its
+ * rating changes: the periods as gaps, and rating, deviation and volatility as
+ * differences from the entry before, quantized as in the population's cold
+ * tier and varint coded, so a typical entry takes a few bytes.  Every few
+ * entries the stream starts afresh from absolute values, and a sparse index of
+ * those points lets a query decode only the entries near the periods it asks
+ * for.
+ *
+ * Ratings and deviations are kept to within 1/64 of a Glicko point, and
+ * volatilities to within 5e-7.
+ */
+class Glicko2_history
+{
+	public:
+
+
+
+		/**
+		 * Constructor.
+		 *
+		 * @param interval Entries between points in each player's index.
+		 */
+		Glicko2_history(unsigned int interval = 16);
+
+		/**
+		 * Destructor.
+		 */
+		~Glicko2_history();
+
+
+
+		/**
+		 * Record the players whose rating changed since the last call, as in
+		 * effect from the population's current period; typically called right
+		 * after Update().  The first call records every player.  After
+		 * Rollback(), entries for the periods undone are replaced.
+		 *
+		 * @param population Population, the same one every time.
+		 */
+		void Record(const Glicko2_population& population);
+
+		/**
+		 * Record one player's rating, as in effect from a period.  Entries for
+		 * that period or later are replaced.  A rating equal to the one already
+		 * in effect is not recorded.
+		 *
+		 * @param player Player index.
+		 * @param period Rating period.
+		 * @param state  Rating state, on the Glicko-2 scale.
+		 */
+		void Add(unsigned int player, unsigned int period, const Glicko2_rating& state);
+
+
+
+		/**
+		 * Get a player's rating as it was during a period.
+		 *
+		 * @param player Player index.
+		 * @param period Rating period.
+		 * @param entry  Receives the latest entry at or before the period.
+		 *
+		 * @return false if the player has no entry at or before the period.
+		 */
+		bool GetAt(unsigned int player, unsigned int period, Glicko2_history_entry& entry) const;
+
+		/**
+		 * Get a player's history over a range of periods.
+		 *
+		 * @param player  Player index.
+		 * @param first   First rating period.
+		 * @param last    Last rating period.
+		 * @param entries Receives the entries from first to last, in period
+		 *                order.
+		 */
+		void GetRange(unsigned int player, unsigned int first, unsigned int last, std::vector<Glicko2_history_entry>& entries) const;
+
+
+
+		/**
+		 * @return Number of entries, for all players.
+		 */
+		std::size_t GetEntryCount() const;
+
+		/**
+		 * @return Bytes held by the streams and the index.
+		 */
+		std::size_t GetBytes() const;
+
+
+
+	private:
+
+		Glicko2_history(const Glicko2_history&);
+		Glicko2_history& operator=(const Glicko2_history&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_history_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_history_h__
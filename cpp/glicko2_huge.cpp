@@ -0,0 +1,188 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+
+#include "glicko2_huge.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+
+#if defined(__linux__)
+#define GLICKO2_HAVE_HUGE
+#include <sys/mman.h>
+#endif
+
+
+
+namespace
+{
+	std::atomic<std::size_t> mapped_bytes(0);
+	std::atomic<std::size_t> advised_bytes(0);
+
+	// mappings the huge page advice was accepted for
+	std::mutex                advised_lock;
+	std::unordered_set<void*> advised;
+
+
+
+	inline std::size_t RoundUp(std::size_t bytes)
+	{
+		return (bytes + Glicko2_huge::huge_page_size - 1) / Glicko2_huge::huge_page_size * Glicko2_huge::huge_page_size;
+	}
+}
+
+
+
+const std::size_t Glicko2_huge::huge_page_size;
+
+
+
+void* Glicko2_huge::Allocate(std::size_t bytes)
+{
+#ifdef GLICKO2_HAVE_HUGE
+	if ( bytes >= huge_page_size )
+	{
+		std::size_t size = RoundUp(bytes);
+		if ( size < bytes )
+		{
+			throw std::bad_alloc();
+		}
+
+		// map a huge page more than needed, then trim to a huge page boundary;
+		// the kernel only backs aligned 2 MB ranges with huge pages
+		void* mapping = mmap(0,size + huge_page_size,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+		if ( mapping == MAP_FAILED )
+		{
+			throw std::bad_alloc();
+		}
+
+		char*       start = static_cast<char*>(mapping);
+		char*       data  = reinterpret_cast<char*>(RoundUp((std::size_t)start));
+		std::size_t head  = (std::size_t)(data - start);
+		if ( head > 0 )
+		{
+			munmap(start,head);
+		}
+		munmap(data + size,huge_page_size - head);
+
+		mapped_bytes += size;
+		if ( madvise(data,size,MADV_HUGEPAGE) == 0 )
+		{
+			advised_bytes += size;
+			std::lock_guard<std::mutex> lock(advised_lock);
+			advised.insert(data);
+		}
+		return data;
+	}
+#endif
+
+	return ::operator new(bytes);
+}
+
+
+
+void Glicko2_huge::Free(void* data, std::size_t bytes)
+{
+	if ( data == 0 )
+	{
+		return;
+	}
+
+#ifdef GLICKO2_HAVE_HUGE
+	if ( bytes >= huge_page_size )
+	{
+		std::size_t size = RoundUp(bytes);
+		{
+			std::lock_guard<std::mutex> lock(advised_lock);
+			if ( advised.erase(data) > 0 )
+			{
+				advised_bytes -= size;
+			}
+		}
+		mapped_bytes -= size;
+		munmap(data,size);
+		return;
+	}
+#endif
+
+	::operator delete(data);
+}
+
+
+
+std::size_t Glicko2_huge::GetMappedBytes()
+{
+	return mapped_bytes;
+}
+
+
+
+std::size_t Glicko2_huge::GetAdvisedBytes()
+{
+	return advised_bytes;
+}
+
+
+
+std::size_t Glicko2_huge::GetHugeBytes()
+{
+	std::size_t bytes = 0;
+
+#ifdef GLICKO2_HAVE_HUGE
+	std::FILE* file = std::fopen("/proc/self/smaps","r");
+	if ( file == 0 )
+	{
+		return 0;
+	}
+
+	// each mapping lists its AnonHugePages before its VmFlags, where "hg"
+	// marks memory advised with MADV_HUGEPAGE
+	char          line[1024];
+	unsigned long huge_kb = 0;
+	while ( std::fgets(line,sizeof(line),file) )
+	{
+		unsigned long kb;
+		if ( std::sscanf(line,"AnonHugePages: %lu kB",&kb) == 1 )
+		{
+			huge_kb = kb;
+		}
+		else if ( std::strncmp(line,"VmFlags:",8) == 0 )
+		{
+			if ( std::strstr(line," hg") != 0 )
+			{
+				bytes += (std::size_t)huge_kb * 1024;
+			}
+			huge_kb = 0;
+		}
+	}
+	std::fclose(file);
+#endif
+
+	return bytes;
+}
@@ -0,0 +1,153 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+
+#ifndef __glicko2_huge_h__
+#define __glicko2_huge_h__
+
+
+
+#include <cstddef>
+#include <new>
+
+
+
+/**
+ * Memory for large arrays, backed by 2 MB transparent huge pages where the
+ * system gives them.
+ *
+ * Allocations of at least huge_page_size bytes are mapped with mmap, aligned
+ * to and rounded up to whole huge pages, and advised with MADV_HUGEPAGE; one
+ * TLB entry then covers 2 MB of the array instead of 4 KB.  Smaller
+ * allocations, and every allocation off Linux, come from operator new.  The
+ * kernel is free to back advised memory with normal pages, e.g. when huge
+ * pages are disabled or memory is fragmented; the array works the same either
+ * way, and GetHugeBytes() reports what was actually obtained.
+ */
+class Glicko2_huge
+{
+	public:
+
+
+
+		/**
+		 * Size of a huge page, and the smallest allocation mapped as one.
+		 */
+		static const std::size_t huge_page_size = 2 * 1024 * 1024;
+
+
+
+		/**
+		 * Allocate memory.
+		 *
+		 * @param bytes Size of the allocation.
+		 *
+		 * @return Memory, aligned for any type.  Throws std::bad_alloc on
+		 *         failure.
+		 */
+		static void* Allocate(std::size_t bytes);
+
+		/**
+		 * Free memory from Allocate().
+		 *
+		 * @param data  Memory.
+		 * @param bytes Size it was allocated with.
+		 */
+		static void Free(void* data, std::size_t bytes);
+
+
+
+		/**
+		 * @return Bytes currently mapped for large allocations.
+		 */
+		static std::size_t GetMappedBytes();
+
+		/**
+		 * @return Of GetMappedBytes(), the bytes the kernel accepted the huge
+		 *         page advice for.
+		 */
+		static std::size_t GetAdvisedBytes();
+
+		/**
+		 * Bytes of memory advised for huge pages, by this or any other code in
+		 * the process, that are backed by huge pages right now, as
+		 * /proc/self/smaps reports them.  Reads the whole file, so it is meant
+		 * for diagnostics rather than hot paths.
+		 *
+		 * @return Bytes, or 0 where this cannot be read.
+		 */
+		static std::size_t GetHugeBytes();
+
+
+
+	private:
+
+		Glicko2_huge();
+};
+
+
+
+/**
+ * Standard allocator drawing from Glicko2_huge, for containers such as
+ * std::vector<double,Glicko2_huge_allocator<double> >.  Stateless; all
+ * instances are equal.
+ */
+template <typename T>
+class Glicko2_huge_allocator
+{
+	public:
+
+		typedef T value_type;
+
+		Glicko2_huge_allocator() {}
+
+		template <typename U>
+		Glicko2_huge_allocator(const Glicko2_huge_allocator<U>&) {}
+
+		T* allocate(std::size_t count)
+		{
+			if ( count > (std::size_t)-1 / sizeof(T) )
+			{
+				throw std::bad_alloc();
+			}
+			return static_cast<T*>(Glicko2_huge::Allocate(count * sizeof(T)));
+		}
+
+		void deallocate(T* data, std::size_t count)
+		{
+			Glicko2_huge::Free(data,count * sizeof(T));
+		}
+
+		template <typename U>
+		bool operator==(const Glicko2_huge_allocator<U>&) const { return true; }
+
+		template <typename U>
+		bool operator!=(const Glicko2_huge_allocator<U>&) const { return false; }
+};
+
+
+
+#endif // __glicko2_huge_h__
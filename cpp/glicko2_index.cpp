@@ -0,0 +1,577 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_index.h"
+#include "glicko2_huge.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLICKO2_INDEX_SSE2
+#include <emmintrin.h>
+#endif
+
+
+
+namespace
+{
+	// slots probed together; one control byte each
+	const unsigned int group_size = 16;
+
+	// control byte of an empty slot; a full slot holds 7 bits of its hash
+	const unsigned char empty = 0x80;
+
+	// ids hashed ahead of the one being looked up by the bulk functions
+	const unsigned int lookahead = 8;
+
+
+
+	inline void PrefetchLine(const void* address)
+	{
+#if defined(__GNUC__)
+		__builtin_prefetch(address);
+#else
+		(void)address;
+#endif
+	}
+
+
+
+	// 64 bit finalizer; every input bit affects every output bit
+	inline std::uint64_t Mix(std::uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+
+
+	inline std::uint64_t HashString(const char* id, std::size_t length)
+	{
+		std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ length;
+		while ( length >= 8 )
+		{
+			std::uint64_t chunk;
+			std::memcpy(&chunk,id,8);
+			h = Mix(h ^ chunk);
+			id     += 8;
+			length -= 8;
+		}
+
+		std::uint64_t tail = 0;
+		if ( length > 0 )
+		{
+			std::memcpy(&tail,id,length);
+		}
+		return Mix(h ^ tail);
+	}
+
+
+
+	// bit i set where byte i of the group equals value
+	inline unsigned int Match(const unsigned char* group, unsigned char value)
+	{
+#ifdef GLICKO2_INDEX_SSE2
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes,_mm_set1_epi8((char)value)));
+#else
+		unsigned int mask = 0;
+		for ( unsigned int i=0;i<group_size;i++ )
+		{
+			mask |= (unsigned int)(group[i] == value) << i;
+		}
+		return mask;
+#endif
+	}
+
+
+
+	inline unsigned int LowestBit(unsigned int mask)
+	{
+#if defined(__GNUC__)
+		return (unsigned int)__builtin_ctz(mask);
+#else
+		unsigned int bit = 0;
+		while ( !(mask & 1) )
+		{
+			mask >>= 1;
+			bit++;
+		}
+		return bit;
+#endif
+	}
+
+
+
+	// an integer id, or the offset of a string id in the index's text buffer
+	struct Slot
+	{
+		std::uint64_t key;
+		std::uint32_t length;
+		std::uint32_t player;
+	};
+
+
+
+	// table arrays, with Glicko2_huge_allocator
+	template <typename T>
+	using Array = std::vector<T,Glicko2_huge_allocator<T> >;
+
+
+
+	// Open addressing table.  control has a byte per slot plus a copy of the
+	// first group_size bytes at the end, so a group starting at any slot can be
+	// loaded without wrapping.  Nothing is ever erased, so the first empty slot
+	// of a probe sequence ends it.
+	class Table
+	{
+		public:
+
+			Table() : size(0), mask(0) {}
+
+			std::size_t GetSize() const     { return size; }
+			std::size_t GetCapacity() const { return slots.size(); }
+
+			std::size_t GetBytes() const
+			{
+				return control.capacity() + slots.capacity() * sizeof(Slot);
+			}
+
+			void Clear()
+			{
+				control.clear();
+				slots.clear();
+				size = 0;
+				mask = 0;
+			}
+
+			void Prefetch(std::uint64_t hash) const
+			{
+				if ( !slots.empty() )
+				{
+					std::size_t pos = (std::size_t)(hash >> 7) & mask;
+					PrefetchLine(&control[pos]);
+					PrefetchLine(&slots[pos]);
+				}
+			}
+
+			// make room for count ids in all; hasher recomputes a slot's hash
+			template<class Hasher>
+			void Reserve(std::size_t count, const Hasher& hasher)
+			{
+				// keep at most 7/8 of the slots full
+				std::size_t capacity = slots.size();
+				if ( count <= capacity - capacity / 8 && capacity > 0 )
+				{
+					return;
+				}
+
+				capacity = capacity > 0 ? capacity : group_size;
+				while ( count > capacity - capacity / 8 )
+				{
+					capacity *= 2;
+				}
+
+				Array<unsigned char> old_control;
+				Array<Slot>          old_slots;
+				old_control.swap(control);
+				old_slots.swap(slots);
+
+				control.assign(capacity + group_size,empty);
+				slots.resize(capacity);
+				mask = capacity - 1;
+				size = 0;
+
+				for ( std::size_t i=0;i<old_slots.size();i++ )
+				{
+					if ( old_control[i] != empty )
+					{
+						Place(hasher(old_slots[i]),old_slots[i]);
+					}
+				}
+			}
+
+			template<class Equal>
+			const Slot* Find(std::uint64_t hash, const Equal& equal) const
+			{
+				if ( slots.empty() )
+				{
+					return 0;
+				}
+
+				unsigned char tag  = (unsigned char)(hash & 0x7F);
+				std::size_t   pos  = (std::size_t)(hash >> 7) & mask;
+				std::size_t   step = 0;
+				for ( ;; )
+				{
+					const unsigned char* group = &control[pos];
+					for ( unsigned int hits=Match(group,tag);hits!=0;hits&=hits-1 )
+					{
+						const Slot& slot = slots[(pos + LowestBit(hits)) & mask];
+						if ( equal(slot) )
+						{
+							return &slot;
+						}
+					}
+
+					if ( Match(group,empty) != 0 )
+					{
+						return 0;
+					}
+
+					step += group_size;
+					pos   = (pos + step) & mask;
+				}
+			}
+
+			// add a slot known to be absent; there must be room for it
+			void Place(std::uint64_t hash, const Slot& slot)
+			{
+				std::size_t pos  = (std::size_t)(hash >> 7) & mask;
+				std::size_t step = 0;
+				for ( ;; )
+				{
+					unsigned int free = Match(&control[pos],empty);
+					if ( free != 0 )
+					{
+						std::size_t i = (pos + LowestBit(free)) & mask;
+						SetControl(i,(unsigned char)(hash & 0x7F));
+						slots[i] = slot;
+						size++;
+						return;
+					}
+
+					step += group_size;
+					pos   = (pos + step) & mask;
+				}
+			}
+
+		private:
+
+			void SetControl(std::size_t i, unsigned char value)
+			{
+				control[i] = value;
+				if ( i < group_size )
+				{
+					control[slots.size() + i] = value;
+				}
+			}
+
+			Array<unsigned char> control;
+			Array<Slot>          slots;
+			std::size_t          size;
+			std::size_t          mask;
+	};
+}
+
+
+
+class Glicko2_index_impl
+{
+	public:
+
+		Table             numbers;
+		Table             strings;
+		std::vector<char> text;
+
+		struct NumberHasher
+		{
+			std::uint64_t operator()(const Slot& slot) const { return Mix(slot.key); }
+		};
+
+		struct StringHasher
+		{
+			const std::vector<char>& text;
+			explicit StringHasher(const std::vector<char>& text) : text(text) {}
+			std::uint64_t operator()(const Slot& slot) const { return HashString(text.data() + slot.key,slot.length); }
+		};
+
+		struct NumberEqual
+		{
+			std::uint64_t id;
+			explicit NumberEqual(std::uint64_t id) : id(id) {}
+			bool operator()(const Slot& slot) const { return slot.key == id; }
+		};
+
+		struct StringEqual
+		{
+			const std::vector<char>& text;
+			const char*              id;
+			std::size_t              length;
+			StringEqual(const std::vector<char>& text, const char* id, std::size_t length) : text(text), id(id), length(length) {}
+			bool operator()(const Slot& slot) const { return slot.length == length && std::memcmp(text.data() + slot.key,id,length) == 0; }
+		};
+
+		// add an id whose hash is known; the table must have room
+		bool InsertNumber(std::uint64_t hash, std::uint64_t id, unsigned int player);
+		bool InsertString(std::uint64_t hash, const char* id, std::size_t length, unsigned int player);
+};
+
+
+
+bool Glicko2_index_impl::InsertNumber(std::uint64_t hash, std::uint64_t id, unsigned int player)
+{
+	if ( numbers.Find(hash,NumberEqual(id)) != 0 )
+	{
+		return false;
+	}
+
+	Slot slot;
+	slot.key    = id;
+	slot.length = 0;
+	slot.player = player;
+	numbers.Place(hash,slot);
+	return true;
+}
+
+
+
+bool Glicko2_index_impl::InsertString(std::uint64_t hash, const char* id, std::size_t length, unsigned int player)
+{
+	if ( strings.Find(hash,StringEqual(text,id,length)) != 0 )
+	{
+		return false;
+	}
+
+	Slot slot;
+	slot.key    = text.size();
+	slot.length = (std::uint32_t)length;
+	slot.player = player;
+	text.insert(text.end(),id,id + length);
+	strings.Place(hash,slot);
+	return true;
+}
+
+
+
+
+
+
+Glicko2_index::Glicko2_index() :
+	pimpl(0)
+{
+	pimpl = new Glicko2_index_impl;
+}
+
+
+
+Glicko2_index::~Glicko2_index()
+{
+	delete pimpl;
+}
+
+
+
+bool Glicko2_index::Insert(std::uint64_t id, unsigned int player)
+{
+	pimpl->numbers.Reserve(pimpl->numbers.GetSize() + 1,Glicko2_index_impl::NumberHasher());
+	return pimpl->InsertNumber(Mix(id),id,player);
+}
+
+
+
+bool Glicko2_index::Insert(const char* id, std::size_t length, unsigned int player)
+{
+	pimpl->strings.Reserve(pimpl->strings.GetSize() + 1,Glicko2_index_impl::StringHasher(pimpl->text));
+	return pimpl->InsertString(HashString(id,length),id,length,player);
+}
+
+
+
+bool Glicko2_index::Insert(const std::string& id, unsigned int player)
+{
+	return Insert(id.data(),id.size(),player);
+}
+
+
+
+unsigned int Glicko2_index::InsertBulk(const std::uint64_t* ids, const unsigned int* players, unsigned int count)
+{
+	Table& table = pimpl->numbers;
+	table.Reserve(table.GetSize() + count,Glicko2_index_impl::NumberHasher());
+
+	std::uint64_t hashes[lookahead];
+	for ( unsigned int i=0;i<count && i<lookahead;i++ )
+	{
+		hashes[i] = Mix(ids[i]);
+		table.Prefetch(hashes[i]);
+	}
+
+	unsigned int added = 0;
+	for ( unsigned int i=0;i<count;i++ )
+	{
+		std::uint64_t hash = hashes[i % lookahead];
+		if ( i + lookahead < count )
+		{
+			hashes[i % lookahead] = Mix(ids[i + lookahead]);
+			table.Prefetch(hashes[i % lookahead]);
+		}
+
+		added += pimpl->InsertNumber(hash,ids[i],players[i]) ? 1 : 0;
+	}
+	return added;
+}
+
+
+
+unsigned int Glicko2_index::InsertBulk(const char* const* ids, const std::size_t* lengths, const unsigned int* players, unsigned int count)
+{
+	Table& table = pimpl->strings;
+	table.Reserve(table.GetSize() + count,Glicko2_index_impl::StringHasher(pimpl->text));
+
+	std::size_t bytes = 0;
+	for ( unsigned int i=0;i<count;i++ )
+	{
+		bytes += lengths[i];
+	}
+	pimpl->text.reserve(pimpl->text.size() + bytes);
+
+	std::uint64_t hashes[lookahead];
+	for ( unsigned int i=0;i<count && i<lookahead;i++ )
+	{
+		hashes[i] = HashString(ids[i],lengths[i]);
+		table.Prefetch(hashes[i]);
+	}
+
+	unsigned int added = 0;
+	for ( unsigned int i=0;i<count;i++ )
+	{
+		std::uint64_t hash = hashes[i % lookahead];
+		if ( i + lookahead < count )
+		{
+			hashes[i % lookahead] = HashString(ids[i + lookahead],lengths[i + lookahead]);
+			table.Prefetch(hashes[i % lookahead]);
+		}
+
+		added += pimpl->InsertString(hash,ids[i],lengths[i],players[i]) ? 1 : 0;
+	}
+	return added;
+}
+
+
+
+unsigned int Glicko2_index::Find(std::uint64_t id) const
+{
+	const Slot* slot = pimpl->numbers.Find(Mix(id),Glicko2_index_impl::NumberEqual(id));
+	return slot ? slot->player : not_found;
+}
+
+
+
+unsigned int Glicko2_index::Find(const char* id, std::size_t length) const
+{
+	const Slot* slot = pimpl->strings.Find(HashString(id,length),Glicko2_index_impl::StringEqual(pimpl->text,id,length));
+	return slot ? slot->player : not_found;
+}
+
+
+
+unsigned int Glicko2_index::Find(const std::string& id) const
+{
+	return Find(id.data(),id.size());
+}
+
+
+
+void Glicko2_index::FindBulk(const std::uint64_t* ids, unsigned int* players, unsigned int count) const
+{
+	const Table& table = pimpl->numbers;
+
+	std::uint64_t hashes[lookahead];
+	for ( unsigned int i=0;i<count && i<lookahead;i++ )
+	{
+		hashes[i] = Mix(ids[i]);
+		table.Prefetch(hashes[i]);
+	}
+
+	for ( unsigned int i=0;i<count;i++ )
+	{
+		std::uint64_t hash = hashes[i % lookahead];
+		if ( i + lookahead < count )
+		{
+			hashes[i % lookahead] = Mix(ids[i + lookahead]);
+			table.Prefetch(hashes[i % lookahead]);
+		}
+
+		const Slot* slot = table.Find(hash,Glicko2_index_impl::NumberEqual(ids[i]));
+		players[i] = slot ? slot->player : not_found;
+	}
+}
+
+
+
+void Glicko2_index::FindBulk(const char* const* ids, const std::size_t* lengths, unsigned int* players, unsigned int count) const
+{
+	const Table& table = pimpl->strings;
+
+	std::uint64_t hashes[lookahead];
+	for ( unsigned int i=0;i<count && i<lookahead;i++ )
+	{
+		hashes[i] = HashString(ids[i],lengths[i]);
+		table.Prefetch(hashes[i]);
+	}
+
+	for ( unsigned int i=0;i<count;i++ )
+	{
+		std::uint64_t hash = hashes[i % lookahead];
+		if ( i + lookahead < count )
+		{
+			hashes[i % lookahead] = HashString(ids[i + lookahead],lengths[i + lookahead]);
+			table.Prefetch(hashes[i % lookahead]);
+		}
+
+		const Slot* slot = table.Find(hash,Glicko2_index_impl::StringEqual(pimpl->text,ids[i],lengths[i]));
+		players[i] = slot ? slot->player : not_found;
+	}
+}
+
+
+
+std::size_t Glicko2_index::GetSize() const
+{
+	return pimpl->numbers.GetSize() + pimpl->strings.GetSize();
+}
+
+
+
+std::size_t Glicko2_index::GetBytes() const
+{
+	return pimpl->numbers.GetBytes() + pimpl->strings.GetBytes() + pimpl->text.capacity();
+}
+
+
+
+void Glicko2_index::Clear()
+{
+	pimpl->numbers.Clear();
+	pimpl->strings.Clear();
+	pimpl->text.clear();
+}
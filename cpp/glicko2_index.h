@@ -0,0 +1,220 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_index_h__
+#define __glicko2_index_h__
+
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+
+class Glicko2_index_impl;
+
+
+
+/**
+ * Map from external player ids to dense player indices, such as those
+ * Glicko2_population::AddPlayer() returns.
+ *
+ * Ids are 64 bit integers or strings of any length (e.g. UUIDs); the two kinds
+ * are kept apart, so the integer 42 and the string "42" are different ids.
+ * Ids are never removed.
+ *
+ * Each kind is an open addressing hash table in flat arrays, probed 16 slots at
+ * a time by comparing one byte per slot with SSE2, or a scalar loop where SSE2
+ * is not available.  The tables use Glicko2_huge_allocator.  String ids are
+ * copied into a single buffer owned by the index.  The bulk functions hash
+ * ahead of the current id and prefetch its slots, hiding most of the cache
+ * misses of a large table.
+ */
+class Glicko2_index
+{
+	public:
+
+
+
+		/**
+		 * Returned by Find() for an id not in the index.
+		 */
+		static const unsigned int not_found = 0xFFFFFFFFu;
+
+
+
+		/**
+		 * Constructor.  Creates an empty index.
+		 */
+		Glicko2_index();
+
+		/**
+		 * Destructor.
+		 */
+		~Glicko2_index();
+
+
+
+		/**
+		 * Add an integer id.
+		 *
+		 * @param id     External id.
+		 * @param player Player index.
+		 *
+		 * @return true if added; false if the id was already present, in which
+		 *         case its player is unchanged.
+		 */
+		bool Insert(std::uint64_t id, unsigned int player);
+
+		/**
+		 * Add a string id.
+		 *
+		 * @param id     External id; need not be null terminated.
+		 * @param length Length of id in bytes.
+		 * @param player Player index.
+		 *
+		 * @return true if added; false if the id was already present, in which
+		 *         case its player is unchanged.
+		 */
+		bool Insert(const char* id, std::size_t length, unsigned int player);
+
+		/**
+		 * Add a string id.
+		 *
+		 * @param id     External id.
+		 * @param player Player index.
+		 *
+		 * @return true if added; false if the id was already present.
+		 */
+		bool Insert(const std::string& id, unsigned int player);
+
+		/**
+		 * Add many integer ids.  Room for all of them is made up front.
+		 *
+		 * @param ids     External ids.
+		 * @param players Player index of each id.
+		 * @param count   Number of ids.
+		 *
+		 * @return Number of ids added; ids already present are skipped.
+		 */
+		unsigned int InsertBulk(const std::uint64_t* ids, const unsigned int* players, unsigned int count);
+
+		/**
+		 * Add many string ids.  Room for all of them is made up front.
+		 *
+		 * @param ids     External ids.
+		 * @param lengths Length of each id in bytes.
+		 * @param players Player index of each id.
+		 * @param count   Number of ids.
+		 *
+		 * @return Number of ids added; ids already present are skipped.
+		 */
+		unsigned int InsertBulk(const char* const* ids, const std::size_t* lengths, const unsigned int* players, unsigned int count);
+
+
+
+		/**
+		 * Look up an integer id.
+		 *
+		 * @param id External id.
+		 *
+		 * @return Player index, or not_found.
+		 */
+		unsigned int Find(std::uint64_t id) const;
+
+		/**
+		 * Look up a string id.
+		 *
+		 * @param id     External id; need not be null terminated.
+		 * @param length Length of id in bytes.
+		 *
+		 * @return Player index, or not_found.
+		 */
+		unsigned int Find(const char* id, std::size_t length) const;
+
+		/**
+		 * Look up a string id.
+		 *
+		 * @param id External id.
+		 *
+		 * @return Player index, or not_found.
+		 */
+		unsigned int Find(const std::string& id) const;
+
+		/**
+		 * Look up many integer ids.
+		 *
+		 * @param ids     External ids.
+		 * @param players Receives the player index of each id, or not_found.
+		 * @param count   Number of ids.
+		 */
+		void FindBulk(const std::uint64_t* ids, unsigned int* players, unsigned int count) const;
+
+		/**
+		 * Look up many string ids.
+		 *
+		 * @param ids     External ids.
+		 * @param lengths Length of each id in bytes.
+		 * @param players Receives the player index of each id, or not_found.
+		 * @param count   Number of ids.
+		 */
+		void FindBulk(const char* const* ids, const std::size_t* lengths, unsigned int* players, unsigned int count) const;
+
+
+
+		/**
+		 * @return Number of ids, of both kinds.
+		 */
+		std::size_t GetSize() const;
+
+		/**
+		 * @return Bytes of memory held by the index.
+		 */
+		std::size_t GetBytes() const;
+
+		/**
+		 * Remove every id.
+		 */
+		void Clear();
+
+
+
+	private:
+
+		Glicko2_index(const Glicko2_index&);
+		Glicko2_index& operator=(const Glicko2_index&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_index_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_index_h__
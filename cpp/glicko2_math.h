@@ -0,0 +1,474 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_math_h__
+#define __glicko2_math_h__
+
+
+
+#include <cmath>
+
+
+
+/**
+ * Glicko-2 rating state.
+ *
+ * All three values are on the Glicko-2 scale, as used internally by Glicko2;
+ * use Glicko2_math to convert to and from Glicko ratings.  This is a plain
+ * trivially copyable value, suitable for arrays and memcpy.
+ */
+struct Glicko2_rating
+{
+	/**
+	 * Glicko-2 rating (mu).
+	 */
+	double rating;
+
+	/**
+	 * Glicko-2 rating deviation (phi).
+	 */
+	double deviation;
+
+	/**
+	 * Rating volatility (sigma).
+	 */
+	double volatility;
+};
+
+
+
+/**
+ * Glicko-2 math core.
+ *
+ * Pure functions implementing each step of the Glicko-2 algorithm, defined in
+ * this header so they inline into callers.  Glicko2 and the other rating
+ * classes in this library are built on these; clients with their own storage
+ * may call them directly.
+ *
+ * A rating period update is: Accumulate() over every result, then
+ * SolveVolatility(), then Finalize().  Update() does all three.
+ */
+class Glicko2_math
+{
+	public:
+
+
+
+		/**
+		 * Glicko to Glicko-2 scale factor.
+		 */
+		static constexpr double scale = 173.7178;
+
+		/**
+		 * Glicko rating corresponding to a Glicko-2 rating of 0.
+		 */
+		static constexpr double center = 1500.0;
+
+		/**
+		 * System constant tau, which constrains the change in volatility over
+		 * time; should be [0.3,1.2].
+		 */
+		static constexpr double dvolatility = 0.3;
+
+		/**
+		 * Convergence tolerance of the volatility iteration.
+		 */
+		static constexpr double tolerance = 0.0000001;
+
+		/**
+		 * Largest opponent block summed by a single specialized kernel.
+		 */
+		static constexpr unsigned int block_size = 8;
+
+
+
+		/**
+		 * Convert a Glicko rating to the Glicko-2 scale.
+		 *
+		 * @param rating Glicko rating.
+		 *
+		 * @return Glicko-2 rating.
+		 */
+		static constexpr double ToGlicko2Rating(double rating)
+		{
+			return (rating - center) / scale;
+		}
+
+		/**
+		 * Convert a Glicko rating deviation to the Glicko-2 scale.
+		 *
+		 * @param deviation Glicko rating deviation.
+		 *
+		 * @return Glicko-2 rating deviation.
+		 */
+		static constexpr double ToGlicko2Deviation(double deviation)
+		{
+			return deviation / scale;
+		}
+
+		/**
+		 * Convert a Glicko-2 rating to the Glicko scale.
+		 *
+		 * @param rating Glicko-2 rating.
+		 *
+		 * @return Glicko rating.
+		 */
+		static constexpr double ToGlickoRating(double rating)
+		{
+			return rating * scale + center;
+		}
+
+		/**
+		 * Convert a Glicko-2 rating deviation to the Glicko scale.
+		 *
+		 * @param deviation Glicko-2 rating deviation.
+		 *
+		 * @return Glicko rating deviation.
+		 */
+		static constexpr double ToGlickoDeviation(double deviation)
+		{
+			return deviation * scale;
+		}
+
+		/**
+		 * Build a Glicko-2 rating state from Glicko values.
+		 *
+		 * @param rating     Glicko rating.
+		 * @param deviation  Glicko rating deviation.
+		 * @param volatility Rating volatility.
+		 *
+		 * @return Rating state.
+		 */
+		static constexpr Glicko2_rating FromGlicko(double rating, double deviation, double volatility)
+		{
+			return Glicko2_rating{ ToGlicko2Rating(rating), ToGlicko2Deviation(deviation), volatility };
+		}
+
+		/**
+		 * Convert a result to its score.
+		 *
+		 * @param win  true for a win.
+		 * @param draw true for a draw.
+		 *
+		 * @return 1.0 for a win, 0.5 for a draw, 0.0 for a loss.
+		 */
+		static constexpr double Score(bool win, bool draw)
+		{
+			return win ? 1.0 : (draw ? 0.5 : 0.0);
+		}
+
+
+
+		/**
+		 * Glicko-2 g function, which weights a result by the opponent's deviation.
+		 *
+		 * @param deviation Opponent's Glicko-2 rating deviation.
+		 *
+		 * @return g(phi).
+		 */
+		static double g(double deviation)
+		{
+			return 1.0 / std::sqrt(1.0 + 3.0 * deviation * deviation / 9.86960440108935861883);
+		}
+
+		/**
+		 * Glicko-2 E function, the expected score against an opponent.
+		 *
+		 * @param rating          Player's Glicko-2 rating.
+		 * @param rating_opponent Opponent's Glicko-2 rating.
+		 * @param g_opponent      g() of the opponent's deviation.
+		 *
+		 * @return Expected score, in (0,1).
+		 */
+		static double E(double rating, double rating_opponent, double g_opponent)
+		{
+			return 1.0 / (1.0 + std::exp(-g_opponent*(rating - rating_opponent)));
+		}
+
+
+
+		/**
+		 * Add exactly N results to the variance and delta sums.  The trip count
+		 * is a constant, so the loop is fully unrolled.
+		 *
+		 * @param rating              Player's Glicko-2 rating.
+		 * @param opponent_ratings    Glicko-2 rating of each opponent.
+		 * @param opponent_deviations Glicko-2 rating deviation of each opponent.
+		 * @param results             Score of each contest.
+		 * @param variance_sum        Running sum of g^2 E (1 - E).
+		 * @param delta_sum           Running sum of g (s - E).
+		 */
+		template<unsigned int N>
+		static void AccumulateSums(double rating, const double* opponent_ratings, const double* opponent_deviations, const double* results, double& variance_sum, double& delta_sum)
+		{
+			double v = 0.0;
+			double d = 0.0;
+			for ( unsigned int i=0;i<N;i++ )
+			{
+				double g_i = g(opponent_deviations[i]);
+				double E_i = E(rating,opponent_ratings[i],g_i);
+				v += g_i * g_i * E_i * (1.0 - E_i);
+				d += g_i * (results[i] - E_i);
+			}
+
+			variance_sum += v;
+			delta_sum    += d;
+		}
+
+		/**
+		 * Add any number of results to the variance and delta sums.  Results are
+		 * summed in blocks of up to block_size, each by the AccumulateSums()
+		 * kernel for its size, so small counts take a single specialized block.
+		 *
+		 * @param rating              Player's Glicko-2 rating.
+		 * @param opponent_ratings    Glicko-2 rating of each opponent.
+		 * @param opponent_deviations Glicko-2 rating deviation of each opponent.
+		 * @param results             Score of each contest.
+		 * @param count               Number of results.
+		 * @param variance_sum        Running sum of g^2 E (1 - E).
+		 * @param delta_sum           Running sum of g (s - E).
+		 */
+		static void Accumulate(double rating, const double* opponent_ratings, const double* opponent_deviations, const double* results, unsigned int count, double& variance_sum, double& delta_sum)
+		{
+			for ( unsigned int begin=0;begin<count;begin+=block_size )
+			{
+				const double* r = opponent_ratings + begin;
+				const double* d = opponent_deviations + begin;
+				const double* s = results + begin;
+
+				switch ( count - begin )
+				{
+					case 1:  AccumulateSums<1>(rating,r,d,s,variance_sum,delta_sum); break;
+					case 2:  AccumulateSums<2>(rating,r,d,s,variance_sum,delta_sum); break;
+					case 3:  AccumulateSums<3>(rating,r,d,s,variance_sum,delta_sum); break;
+					case 4:  AccumulateSums<4>(rating,r,d,s,variance_sum,delta_sum); break;
+					case 5:  AccumulateSums<5>(rating,r,d,s,variance_sum,delta_sum); break;
+					case 6:  AccumulateSums<6>(rating,r,d,s,variance_sum,delta_sum); break;
+					case 7:  AccumulateSums<7>(rating,r,d,s,variance_sum,delta_sum); break;
+					default: AccumulateSums<8>(rating,r,d,s,variance_sum,delta_sum); break;
+				}
+			}
+		}
+
+
+
+		/**
+		 * Iterate for the new volatility.
+		 *
+		 * @param deviation  Player's Glicko-2 rating deviation.
+		 * @param volatility Player's volatility.
+		 * @param variance   Estimated variance, 1 / variance_sum.
+		 * @param delta      Estimated improvement, variance * delta_sum.
+		 *
+		 * @return New volatility.
+		 */
+		static double SolveVolatility(double deviation, double volatility, double variance, double delta)
+		{
+			// constants of the iteration, folded out of the loop
+			const double inv_tau_squared = 1.0 / (dvolatility*dvolatility);
+			const double phi_squared     = deviation*deviation + variance;
+			const double delta_squared   = delta*delta;
+			const double a               = std::log(volatility*volatility);
+
+			double x     = 0.0;
+			double x_new = a;
+			while ( std::fabs(x - x_new) > tolerance )
+			{
+				       x     = x_new;
+				double ex    = std::exp(x);
+				double d     = phi_squared + ex;
+				double h1    = -(x - a)*inv_tau_squared - 0.5*ex/d + 0.5*ex*delta_squared/(d*d);
+				double h2    = -inv_tau_squared - 0.5*ex*phi_squared/(d*d) + 0.5*delta_squared*ex*(phi_squared - ex)/(d*d*d);
+				       x_new = x - h1/h2;
+			}
+
+			return std::exp(x_new / 2.0);
+		}
+
+		/**
+		 * Cheaply decide whether SolveVolatility() would change the volatility by
+		 * less than a given amount, so that the solve may be skipped.  The root
+		 * x of the iteration satisfies (x - a) / tau^2 = g(x), with a the log of
+		 * the squared volatility; if tau^2 |g| stays within r over [a-r,a+r],
+		 * the root is within r of a.  r is chosen so the volatility moves by at
+		 * most the given amount, and |g| is bounded over that interval without
+		 * iterating.  The bound is loosest for few results or a large deviation,
+		 * and tightest for established players, whose volatility barely moves.
+		 *
+		 * @param deviation  Player's Glicko-2 rating deviation.
+		 * @param volatility Player's volatility.
+		 * @param variance   Estimated variance, 1 / variance_sum.
+		 * @param delta      Estimated improvement, variance * delta_sum.
+		 * @param freeze     Largest change in volatility that may be ignored.
+		 *
+		 * @return true if the new volatility is certainly within freeze of the
+		 *         old one.
+		 */
+		static bool IsVolatilityFrozen(double deviation, double volatility, double variance, double delta, double freeze)
+		{
+			if ( !(freeze > 0.0) )
+			{
+				return false;
+			}
+
+			// e^x over [a-r,a+r], with r = 2 log(k)
+			const double k             = 1.0 + freeze / volatility;
+			const double ex_low        = volatility*volatility / (k*k);
+			const double ex_high       = volatility*volatility * (k*k);
+			const double phi_squared   = deviation*deviation + variance;
+			const double delta_squared = delta*delta;
+
+			// g(x) = e^x (delta^2 - d) / 2 d^2, with d = phi^2 + e^x
+			const double d_low   = phi_squared + ex_low;
+			const double d_high  = phi_squared + ex_high;
+			const double g_bound = ex_high * std::fmax(std::fabs(delta_squared - d_low),std::fabs(delta_squared - d_high)) / (2.0*d_low*d_low);
+
+			return dvolatility*dvolatility*g_bound <= 2.0*std::log(k);
+		}
+
+		/**
+		 * SolveVolatility(), skipped when IsVolatilityFrozen() shows the change
+		 * is below freeze, in which case the volatility is kept as it is.
+		 *
+		 * @param deviation  Player's Glicko-2 rating deviation.
+		 * @param volatility Player's volatility.
+		 * @param variance   Estimated variance, 1 / variance_sum.
+		 * @param delta      Estimated improvement, variance * delta_sum.
+		 * @param freeze     Largest change in volatility that may be ignored; 0
+		 *                   always solves.
+		 * @param frozen     Set to true if the solve was skipped.
+		 *
+		 * @return New volatility.
+		 */
+		static double SolveVolatility(double deviation, double volatility, double variance, double delta, double freeze, bool& frozen)
+		{
+			frozen = IsVolatilityFrozen(deviation,volatility,variance,delta,freeze);
+			return frozen ? volatility : SolveVolatility(deviation,volatility,variance,delta);
+		}
+
+		/**
+		 * Compute the new rating and deviation, and store them with the new
+		 * volatility.
+		 *
+		 * @param player         Rating state to update.
+		 * @param new_volatility Result of SolveVolatility().
+		 * @param variance_sum   Final variance sum from Accumulate().
+		 * @param delta_sum      Final delta sum from Accumulate().
+		 * @param elapsed        Rating periods since the player's last update;
+		 *                       the deviation grows by elapsed times the
+		 *                       squared volatility.
+		 */
+		static void Finalize(Glicko2_rating& player, double new_volatility, double variance_sum, double delta_sum, double elapsed = 1.0)
+		{
+			// update the rating deviation to the new pre-rating period value
+			double pre_deviation = std::sqrt( player.deviation*player.deviation + elapsed*new_volatility*new_volatility );
+
+			// update the rating and deviation; the variance is inverted and
+			// inverted back, as it always has been, which keeps results the same
+			// to the last bit as before the math moved here
+			double variance      = 1.0 / variance_sum;
+			double new_deviation = 1.0 / std::sqrt( 1.0/(pre_deviation*pre_deviation) + 1.0/variance );
+
+			player.rating     = player.rating + new_deviation * new_deviation * delta_sum;
+			player.deviation  = new_deviation;
+			player.volatility = new_volatility;
+		}
+
+		/**
+		 * Get the rating state a player would have if the rating period ended
+		 * now, without changing the player.  The sums may be kept as results
+		 * arrive, so that each query costs only the solver.
+		 *
+		 * @param player       Rating state at the start of the period.
+		 * @param variance_sum Variance sum from Accumulate() over the results so
+		 *                     far; there must be at least one.
+		 * @param delta_sum    Delta sum from Accumulate() over the same results.
+		 *
+		 * @return Provisional rating state.
+		 */
+		static Glicko2_rating Provisional(const Glicko2_rating& player, double variance_sum, double delta_sum)
+		{
+			Glicko2_rating provisional = player;
+
+			double variance = 1.0 / variance_sum;
+			Finalize(provisional,SolveVolatility(player.deviation,player.volatility,variance,variance*delta_sum),variance_sum,delta_sum);
+			return provisional;
+		}
+
+		/**
+		 * Update a rating state with a single result as soon as it happens,
+		 * rather than at the end of a rating period.  This is a one result rating
+		 * period whose length is the time since the player's last update, which
+		 * need not be a whole number of periods.  No memory is touched beyond the
+		 * arguments.
+		 *
+		 * @param player             Rating state to update.
+		 * @param opponent_rating    Opponent's Glicko-2 rating, before the contest.
+		 * @param opponent_deviation Opponent's Glicko-2 rating deviation, before
+		 *                           the contest.
+		 * @param score              Score of the contest.
+		 * @param elapsed            Rating periods since the player's last update.
+		 */
+		static void UpdateInstant(Glicko2_rating& player, double opponent_rating, double opponent_deviation, double score, double elapsed)
+		{
+			double variance_sum = 0.0;
+			double delta_sum    = 0.0;
+			AccumulateSums<1>(player.rating,&opponent_rating,&opponent_deviation,&score,variance_sum,delta_sum);
+
+			double variance = 1.0 / variance_sum;
+			Finalize(player,SolveVolatility(player.deviation,player.volatility,variance,variance*delta_sum),variance_sum,delta_sum,elapsed);
+		}
+
+		/**
+		 * Update a rating state with one rating period's results.  Does nothing
+		 * when count is 0.
+		 *
+		 * @param player              Rating state to update.
+		 * @param opponent_ratings    Glicko-2 rating of each opponent.
+		 * @param opponent_deviations Glicko-2 rating deviation of each opponent.
+		 * @param results             Score of each contest.
+		 * @param count               Number of results.
+		 */
+		static void Update(Glicko2_rating& player, const double* opponent_ratings, const double* opponent_deviations, const double* results, unsigned int count)
+		{
+			if ( count == 0 )
+			{
+				return;
+			}
+
+			double variance_sum = 0.0;
+			double delta_sum    = 0.0;
+			Accumulate(player.rating,opponent_ratings,opponent_deviations,results,count,variance_sum,delta_sum);
+
+			double variance = 1.0 / variance_sum;
+			Finalize(player,SolveVolatility(player.deviation,player.volatility,variance,variance*delta_sum),variance_sum,delta_sum);
+		}
+
+};
+
+
+
+#endif // __glicko2_math_h__
@@ -0,0 +1,232 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_numa.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#define GLICKO2_HAVE_NUMA
+#include <dirent.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+
+namespace
+{
+	// mbind() policy and flags, from <linux/mempolicy.h>
+	const int          mpol_bind    = 2;
+	const unsigned int mpol_mf_move = 1 << 1;
+
+
+
+	// parse a cpulist such as "0-3,8-11"
+	void ParseCpuList(const char* text, std::vector<unsigned int>& cpus)
+	{
+		const char* p = text;
+		while ( *p >= '0' && *p <= '9' )
+		{
+			char*         end;
+			unsigned long first = std::strtoul(p,&end,10);
+			unsigned long last  = first;
+			p = end;
+			if ( *p == '-' )
+			{
+				last = std::strtoul(p + 1,&end,10);
+				p    = end;
+			}
+			for ( unsigned long cpu=first;cpu<=last;cpu++ )
+			{
+				cpus.push_back((unsigned int)cpu);
+			}
+			if ( *p == ',' )
+			{
+				p++;
+			}
+		}
+	}
+
+
+
+	struct Node
+	{
+		unsigned int              id;
+		std::vector<unsigned int> cpus;
+
+		bool operator<(const Node& other) const
+		{
+			return id < other.id;
+		}
+	};
+}
+
+
+
+class Glicko2_numa_impl
+{
+	public:
+
+		std::vector<Node> nodes;
+};
+
+
+
+
+
+
+Glicko2_numa::Glicko2_numa(const char* root) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_numa_impl;
+
+#ifdef GLICKO2_HAVE_NUMA
+	if ( DIR* dir = opendir(root) )
+	{
+		while ( struct dirent* entry = readdir(dir) )
+		{
+			unsigned int id;
+			char         rest;
+			if ( std::sscanf(entry->d_name,"node%u%c",&id,&rest) != 1 )
+			{
+				continue;
+			}
+
+			Node node;
+			node.id = id;
+
+			std::string path = std::string(root) + "/" + entry->d_name + "/cpulist";
+			if ( FILE* file = std::fopen(path.c_str(),"r") )
+			{
+				char text[4096];
+				if ( std::fgets(text,sizeof(text),file) )
+				{
+					ParseCpuList(text,node.cpus);
+				}
+				std::fclose(file);
+			}
+			pimpl->nodes.push_back(node);
+		}
+		closedir(dir);
+	}
+#else
+	(void)root;
+#endif
+
+	if ( pimpl->nodes.empty() )
+	{
+		pimpl->nodes.push_back(Node());
+		pimpl->nodes[0].id = 0;
+	}
+	std::sort(pimpl->nodes.begin(),pimpl->nodes.end());
+}
+
+
+
+Glicko2_numa::~Glicko2_numa()
+{
+	delete pimpl;
+}
+
+
+
+unsigned int Glicko2_numa::GetNodeCount() const
+{
+	return (unsigned int)pimpl->nodes.size();
+}
+
+
+
+unsigned int Glicko2_numa::GetCpuCount(unsigned int node) const
+{
+	return (unsigned int)pimpl->nodes[node].cpus.size();
+}
+
+
+
+bool Glicko2_numa::Pin(unsigned int node) const
+{
+	if ( pimpl->nodes.size() <= 1 )
+	{
+		return true;
+	}
+
+#ifdef GLICKO2_HAVE_NUMA
+	const std::vector<unsigned int>& cpus = pimpl->nodes[node].cpus;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for ( unsigned int i=0;i<cpus.size();i++ )
+	{
+		if ( cpus[i] < CPU_SETSIZE )
+		{
+			CPU_SET(cpus[i],&set);
+		}
+	}
+	return CPU_COUNT(&set) > 0 && sched_setaffinity(0,sizeof(set),&set) == 0;
+#else
+	(void)node;
+	return false;
+#endif
+}
+
+
+
+bool Glicko2_numa::Place(void* data, std::size_t bytes, unsigned int node) const
+{
+	if ( pimpl->nodes.size() <= 1 )
+	{
+		return true;
+	}
+
+#if defined(GLICKO2_HAVE_NUMA) && defined(SYS_mbind)
+	std::size_t page  = (std::size_t)sysconf(_SC_PAGESIZE);
+	std::size_t begin = ((std::size_t)data + page - 1) / page * page;
+	std::size_t end   = ((std::size_t)data + bytes) / page * page;
+	if ( end <= begin )
+	{
+		return true;
+	}
+
+	const unsigned int bits = 8 * sizeof(unsigned long);
+	unsigned int       id   = pimpl->nodes[node].id;
+
+	std::vector<unsigned long> mask(id / bits + 1,0);
+	mask[id / bits] = 1ul << (id % bits);
+	return syscall(SYS_mbind,(void*)begin,end - begin,mpol_bind,&mask[0],(unsigned long)mask.size() * bits + 1,mpol_mf_move) == 0;
+#else
+	(void)data;
+	(void)bytes;
+	(void)node;
+	return false;
+#endif
+}
@@ -0,0 +1,124 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_numa_h__
+#define __glicko2_numa_h__
+
+
+
+#include <cstddef>
+
+
+
+class Glicko2_numa_impl;
+
+
+
+/**
+ * NUMA topology of the machine: its memory nodes and the CPUs of each, for
+ * placing memory and pinning threads node by node.
+ *
+ * The topology is read from Linux sysfs; elsewhere, or when sysfs shows a
+ * single node, there is one node and pinning and placement do nothing.  No
+ * NUMA library is needed: placement uses the mbind system call directly.
+ */
+class Glicko2_numa
+{
+	public:
+
+
+
+		/**
+		 * Constructor.  Reads the topology.
+		 *
+		 * @param root Directory holding the node0, node1, ... directories, each
+		 *             with a cpulist file.
+		 */
+		Glicko2_numa(const char* root = "/sys/devices/system/node");
+
+		/**
+		 * Destructor.
+		 */
+		~Glicko2_numa();
+
+
+
+		/**
+		 * @return Number of nodes, at least 1.
+		 */
+		unsigned int GetNodeCount() const;
+
+		/**
+		 * Get the number of CPUs of a node.
+		 *
+		 * @param node Node, numbered from 0 in the order of the system's node
+		 *             ids.
+		 *
+		 * @return CPU count, or 0 if it could not be read.
+		 */
+		unsigned int GetCpuCount(unsigned int node) const;
+
+		/**
+		 * Pin the calling thread to the CPUs of a node.
+		 *
+		 * @param node Node.
+		 *
+		 * @return false if the thread could not be pinned; true on a single node,
+		 *         where nothing is done.
+		 */
+		bool Pin(unsigned int node) const;
+
+		/**
+		 * Move the whole pages of a range of memory to a node, and keep them
+		 * there.  Pages the range only partly covers are left alone, so that
+		 * neighbouring ranges placed on other nodes do not fight over them.
+		 *
+		 * @param data  Start of the range.
+		 * @param bytes Length of the range.
+		 * @param node  Node.
+		 *
+		 * @return false if the memory could not be placed; true on a single
+		 *         node, where nothing is done.
+		 */
+		bool Place(void* data, std::size_t bytes, unsigned int node) const;
+
+
+
+	private:
+
+		Glicko2_numa(const Glicko2_numa&);
+		Glicko2_numa& operator=(const Glicko2_numa&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_numa_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_numa_h__
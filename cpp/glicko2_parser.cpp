@@ -0,0 +1,425 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_parser.h"
+#include "glicko2_population.h"
+#include "glicko2_trace.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLICKO2_PARSER_SSE2
+#include <emmintrin.h>
+#endif
+
+
+
+namespace
+{
+	inline unsigned int LowestBit(unsigned int mask)
+	{
+#if defined(__GNUC__)
+		return (unsigned int)__builtin_ctz(mask);
+#else
+		unsigned int bit = 0;
+		while ( !(mask & 1) )
+		{
+			mask >>= 1;
+			bit++;
+		}
+		return bit;
+#endif
+	}
+
+
+
+	// first delimiter or newline at or after p, or end
+	inline const char* Scan(const char* p, const char* end, char delimiter)
+	{
+#ifdef GLICKO2_PARSER_SSE2
+		const __m128i delimiters = _mm_set1_epi8(delimiter);
+		const __m128i newlines   = _mm_set1_epi8('\n');
+		while ( end - p >= 16 )
+		{
+			__m128i      bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			unsigned int mask  = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes,delimiters),_mm_cmpeq_epi8(bytes,newlines)));
+			if ( mask != 0 )
+			{
+				return p + LowestBit(mask);
+			}
+			p += 16;
+		}
+#endif
+		while ( p < end && *p != delimiter && *p != '\n' )
+		{
+			p++;
+		}
+		return p;
+	}
+
+
+
+	// start of the line after the one p is in, or end
+	inline const char* NextLine(const char* p, const char* end)
+	{
+		const void* newline = std::memchr(p,'\n',(std::size_t)(end - p));
+		return newline ? static_cast<const char*>(newline) + 1 : end;
+	}
+
+
+
+	// a player field; an integer id when every byte is a digit, it fits, and
+	// it has no leading zero, so "007" stays a string id distinct from "7"
+	struct Field
+	{
+		const char*   begin;
+		std::size_t   length;
+		bool          numeric;
+		std::uint64_t number;
+	};
+
+	Field MakeField(const char* begin, const char* end)
+	{
+		Field field;
+		field.begin   = begin;
+		field.length  = (std::size_t)(end - begin);
+		field.numeric = field.length > 0 && field.length <= 19 && (field.length == 1 || *begin != '0');
+		field.number  = 0;
+		for ( const char* p=begin;field.numeric && p<end;p++ )
+		{
+			unsigned int digit = (unsigned int)(unsigned char)*p - '0';
+			field.numeric = digit < 10;
+			field.number  = field.number * 10 + digit;
+		}
+		return field;
+	}
+
+	bool ParseScore(const char* begin, const char* end, double& score)
+	{
+		if ( begin == end )
+		{
+			return false;
+		}
+
+		switch ( *begin )
+		{
+			case 'W': case 'w':
+				score = 1.0;
+				return true;
+
+			case 'L': case 'l':
+				score = 0.0;
+				return true;
+
+			case 'D': case 'd':
+				score = 0.5;
+				return true;
+
+			case '1':
+				score = 1.0;
+				return end - begin == 1 || (end - begin == 3 && begin[1] == '.' && begin[2] == '0');
+
+			case '0':
+				if ( end - begin == 1 || (end - begin == 3 && begin[1] == '.' && begin[2] == '0') )
+				{
+					score = 0.0;
+					return true;
+				}
+				score = 0.5;
+				return end - begin == 3 && begin[1] == '.' && begin[2] == '5';
+
+			case '.':
+				score = 0.5;
+				return end - begin == 2 && begin[1] == '5';
+		}
+		return false;
+	}
+
+	bool ParseTime(const char* begin, const char* end, std::int64_t& time)
+	{
+		bool negative = begin < end && *begin == '-';
+		begin += negative ? 1 : 0;
+		if ( begin == end )
+		{
+			return false;
+		}
+
+		std::uint64_t value = 0;
+		for ( const char* p=begin;p<end;p++ )
+		{
+			unsigned int digit = (unsigned int)(unsigned char)*p - '0';
+			if ( digit >= 10 || value > ((std::uint64_t)INT64_MAX - digit) / 10 )
+			{
+				return false;
+			}
+			value = value * 10 + digit;
+		}
+		time = negative ? -(std::int64_t)value : (std::int64_t)value;
+		return true;
+	}
+
+	// field end, not counting a carriage return before a newline
+	inline const char* Trim(const char* begin, const char* end)
+	{
+		return end > begin && end[-1] == '\r' ? end - 1 : end;
+	}
+
+
+
+	// a player not in the index when its line was parsed
+	struct Pending
+	{
+		std::size_t match;
+		bool        opponent;
+		Field       field;
+	};
+
+	// one thread's share of the input
+	struct Part
+	{
+		const char*                begin;
+		const char*                end;
+		std::vector<Glicko2_match> matches;
+		std::vector<Pending>       pending;
+		std::size_t                errors;
+	};
+}
+
+
+
+class Glicko2_parser_impl
+{
+	public:
+
+		Glicko2_population& population;
+		char                delimiter;
+		bool                header;
+		std::size_t         errors;
+
+		Glicko2_parser_impl(Glicko2_population& population, char delimiter, bool header) :
+			population(population),
+			delimiter(delimiter),
+			header(header),
+			errors(0)
+		{
+		}
+
+		// look up a player, in the index only
+		unsigned int Find(const Field& field) const
+		{
+			const Glicko2_index& index = population.GetIndex();
+			return field.numeric ? index.Find(field.number) : index.Find(field.begin,field.length);
+		}
+
+		// parse whole lines, on any thread
+		void ParsePart(Part& part) const;
+};
+
+
+
+void Glicko2_parser_impl::ParsePart(Part& part) const
+{
+	const char* p   = part.begin;
+	const char* end = part.end;
+	while ( p < end )
+	{
+		const char* player     = p;
+		const char* player_end = Scan(player,end,delimiter);
+		if ( player_end == end || *player_end != delimiter )
+		{
+			// blank lines are not errors
+			part.errors += Trim(player,player_end) != player ? 1 : 0;
+			p = NextLine(player_end,end);
+			continue;
+		}
+
+		const char* opponent     = player_end + 1;
+		const char* opponent_end = Scan(opponent,end,delimiter);
+		if ( opponent_end == end || *opponent_end != delimiter )
+		{
+			part.errors++;
+			p = NextLine(opponent_end,end);
+			continue;
+		}
+
+		Glicko2_match match;
+		match.time = 0;
+
+		const char* result     = opponent_end + 1;
+		const char* result_end = Scan(result,end,delimiter);
+		bool        ok         = ParseScore(result,Trim(result,result_end),match.score);
+		const char* field_end  = result_end;
+		if ( ok && field_end < end && *field_end == delimiter )
+		{
+			const char* time = field_end + 1;
+			field_end = Scan(time,end,delimiter);
+			ok        = ParseTime(time,Trim(time,field_end),match.time);
+		}
+		p = field_end < end && *field_end == '\n' ? field_end + 1 : NextLine(field_end,end);
+
+		if ( !ok )
+		{
+			part.errors++;
+			continue;
+		}
+
+		Field fields[2] = { MakeField(player,player_end), MakeField(opponent,opponent_end) };
+		if ( fields[0].length == 0 || fields[1].length == 0 )
+		{
+			part.errors++;
+			continue;
+		}
+
+		match.player   = Find(fields[0]);
+		match.opponent = Find(fields[1]);
+		for ( unsigned int i=0;i<2;i++ )
+		{
+			if ( (i == 0 ? match.player : match.opponent) == Glicko2_index::not_found )
+			{
+				Pending pending = { part.matches.size(), i == 1, fields[i] };
+				part.pending.push_back(pending);
+			}
+		}
+		part.matches.push_back(match);
+	}
+}
+
+
+
+
+
+
+Glicko2_parser::Glicko2_parser(Glicko2_population& population, char delimiter, bool header) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_parser_impl(population,delimiter,header);
+}
+
+
+
+Glicko2_parser::~Glicko2_parser()
+{
+	delete pimpl;
+}
+
+
+
+std::size_t Glicko2_parser::Parse(const char* text, std::size_t size, std::vector<Glicko2_match>& matches, unsigned int threads, bool last)
+{
+	GLICKO2_TRACE_SCOPE(INGEST);
+
+	Glicko2_parser_impl& p   = *pimpl;
+	const char*          end = text + size;
+
+	// only whole lines, unless there is no more to come
+	if ( !last )
+	{
+		const char* line = end;
+		while ( line > text && line[-1] != '\n' )
+		{
+			line--;
+		}
+		end = line;
+	}
+
+	const char* begin = text;
+	if ( p.header && begin < end )
+	{
+		begin    = NextLine(begin,end);
+		p.header = false;
+	}
+
+	// split at line boundaries; small inputs are not worth the threads
+	std::size_t most = (std::size_t)(end - begin) / 65536 + 1;
+	threads = threads < 1 ? 1 : (threads > most ? (unsigned int)most : threads);
+
+	std::vector<Part> parts(threads);
+	for ( unsigned int t=0;t<threads;t++ )
+	{
+		parts[t].begin  = t == 0 ? begin : parts[t-1].end;
+		parts[t].end    = t == threads - 1 ? end : NextLine(begin + (end - begin) * (t+1) / threads,end);
+		parts[t].end    = parts[t].end < parts[t].begin ? parts[t].begin : parts[t].end;
+		parts[t].errors = 0;
+	}
+
+	if ( threads == 1 )
+	{
+		p.ParsePart(parts[0]);
+	}
+	else
+	{
+		std::vector<std::thread> workers;
+		for ( unsigned int t=0;t<threads;t++ )
+		{
+			workers.push_back(std::thread(&Glicko2_parser_impl::ParsePart,pimpl,std::ref(parts[t])));
+		}
+		for ( unsigned int t=0;t<threads;t++ )
+		{
+			workers[t].join();
+		}
+	}
+
+	// new players, in input order; an earlier line may have added one already
+	Glicko2_index& index = p.population.GetIndex();
+	for ( unsigned int t=0;t<threads;t++ )
+	{
+		Part& part = parts[t];
+		for ( std::size_t i=0;i<part.pending.size();i++ )
+		{
+			const Pending& pending = part.pending[i];
+			unsigned int   player  = p.Find(pending.field);
+			if ( player == Glicko2_index::not_found )
+			{
+				player = p.population.AddPlayer();
+				if ( pending.field.numeric )
+				{
+					index.Insert(pending.field.number,player);
+				}
+				else
+				{
+					index.Insert(pending.field.begin,pending.field.length,player);
+				}
+			}
+			Glicko2_match& match = part.matches[pending.match];
+			(pending.opponent ? match.opponent : match.player) = player;
+		}
+
+		matches.insert(matches.end(),part.matches.begin(),part.matches.end());
+		p.errors += part.errors;
+	}
+
+	return (std::size_t)(end - text);
+}
+
+
+
+std::size_t Glicko2_parser::GetErrorCount() const
+{
+	return pimpl->errors;
+}
@@ -0,0 +1,123 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_parser_h__
+#define __glicko2_parser_h__
+
+
+
+#include "glicko2_periods.h"
+
+#include <cstddef>
+#include <vector>
+
+
+
+class Glicko2_population;
+class Glicko2_parser_impl;
+
+
+
+/**
+ * Parser for text match logs, one match per line:
+ *
+ *     player,opponent,result,time
+ *
+ * with a comma, tab, or any other single byte delimiter.  Players are external
+ * ids, either decimal integers or any other string (e.g. UUIDs), looked up in
+ * the population's index; players not yet in it are added to the population
+ * and the index.  Digits with a leading zero, such as 007, are a string id, so
+ * that they stay distinct from 7.  The result is from the point of view of the
+ * first player: 1, 0, or 0.5, or a word starting with W, L, or D in either
+ * case.  The time is an integer, and may be left out, in which case it is 0.
+ * Lines that do not parse are skipped and counted.
+ *
+ * Delimiters are found 16 bytes at a time with SSE2 where available.  Input can
+ * be split across threads at line boundaries; only players new to the
+ * population are then resolved on the calling thread, in input order, so the
+ * player indices assigned do not depend on the number of threads.
+ */
+class Glicko2_parser
+{
+	public:
+
+
+
+		/**
+		 * Constructor.
+		 *
+		 * @param population Population whose index resolves player ids, and to
+		 *                   which new players are added.
+		 * @param delimiter  Field delimiter, such as ',' or '\t'.
+		 * @param header     true to skip the first line of the input.
+		 */
+		Glicko2_parser(Glicko2_population& population, char delimiter = ',', bool header = false);
+
+		/**
+		 * Destructor.
+		 */
+		~Glicko2_parser();
+
+
+
+		/**
+		 * Parse matches, appending them to a buffer ready for Glicko2_periods or
+		 * for adding to the population.  Input may arrive in pieces that split
+		 * lines: unless last is true, a final line without a newline is left
+		 * unparsed, and should be passed again at the start of the next piece.
+		 *
+		 * @param text    Text to parse.
+		 * @param size    Size of text in bytes.
+		 * @param matches Receives the matches, appended in input order.
+		 * @param threads Number of threads to split the text across.
+		 * @param last    true if this is the end of the input.
+		 *
+		 * @return Number of bytes consumed.
+		 */
+		std::size_t Parse(const char* text, std::size_t size, std::vector<Glicko2_match>& matches, unsigned int threads = 1, bool last = true);
+
+		/**
+		 * @return Number of lines skipped as malformed so far.
+		 */
+		std::size_t GetErrorCount() const;
+
+
+
+	private:
+
+		Glicko2_parser(const Glicko2_parser&);
+		Glicko2_parser& operator=(const Glicko2_parser&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_parser_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_parser_h__
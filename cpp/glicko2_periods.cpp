@@ -0,0 +1,366 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_periods.h"
+#include "glicko2_population.h"
+#include "glicko2_trace.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <vector>
+
+
+
+namespace
+{
+	const std::int64_t seconds_per_day = 86400;
+
+	// fewest matches worth giving a thread of its own
+	const std::size_t thread_matches = 16384;
+
+	// radix digit when more than one pass is needed
+	const unsigned int digit_bits = 8;
+
+	// most periods spanned that are sorted in a single counting pass
+	const unsigned int counting_bits = 16;
+
+
+
+	std::int64_t FloorDiv(std::int64_t a, std::int64_t b)
+	{
+		std::int64_t q = a / b;
+		if ( a % b != 0 && ((a < 0) != (b < 0)) )
+		{
+			q--;
+		}
+		return q;
+	}
+
+
+
+	// year and month (1-12) of a day counted from 1970-01-01, proleptic Gregorian
+	void CivilFromDays(std::int64_t days, std::int64_t& year, unsigned int& month)
+	{
+		days += 719468;
+		std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+		unsigned int doe = (unsigned int)(days - era * 146097);
+		unsigned int yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+		unsigned int doy = doe - (365*yoe + yoe/4 - yoe/100);
+		unsigned int mp  = (5*doy + 2) / 153;
+
+		month = mp < 10 ? mp + 3 : mp - 9;
+		year  = (std::int64_t)yoe + era * 400 + (month <= 2 ? 1 : 0);
+	}
+
+
+
+	// run body(thread, begin, end) over [0,count) split evenly across threads
+	void ParallelFor(unsigned int threads, std::size_t count, const std::function<void(unsigned int,std::size_t,std::size_t)>& body)
+	{
+		if ( threads <= 1 )
+		{
+			body(0,0,count);
+			return;
+		}
+
+		std::vector<std::thread> workers;
+		for ( unsigned int t=0;t<threads;t++ )
+		{
+			std::size_t begin = count * t / threads;
+			std::size_t end   = count * (t+1) / threads;
+			workers.push_back(std::thread(body,t,begin,end));
+		}
+		for ( unsigned int t=0;t<workers.size();t++ )
+		{
+			workers[t].join();
+		}
+	}
+
+
+
+	// a match's period, relative to the first, and where the match came from
+	struct Entry
+	{
+		std::uint64_t key;
+		std::size_t   index;
+	};
+}
+
+
+
+class Glicko2_periods_impl
+{
+	public:
+
+		// fixed periods
+		std::int64_t origin;
+		std::int64_t duration;
+
+		// calendar periods, when duration is 0
+		Glicko2_periods::CALENDAR calendar;
+		std::int64_t              utc_offset;
+
+		// matches in period order, and the batches they form
+		std::vector<Glicko2_match> sorted;
+		std::vector<std::int64_t>  periods;
+		std::vector<std::size_t>   offsets;
+};
+
+
+
+
+
+
+Glicko2_periods::Glicko2_periods(std::int64_t origin, std::int64_t duration) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_periods_impl;
+	pimpl->origin     = origin;
+	pimpl->duration   = duration > 0 ? duration : 1;
+	pimpl->calendar   = DAY;
+	pimpl->utc_offset = 0;
+	pimpl->offsets.push_back(0);
+}
+
+
+
+Glicko2_periods::Glicko2_periods(CALENDAR calendar, std::int64_t utc_offset) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_periods_impl;
+	pimpl->origin     = 0;
+	pimpl->duration   = 0;
+	pimpl->calendar   = calendar;
+	pimpl->utc_offset = utc_offset;
+	pimpl->offsets.push_back(0);
+}
+
+
+
+Glicko2_periods::~Glicko2_periods()
+{
+	delete pimpl;
+}
+
+
+
+std::int64_t Glicko2_periods::GetPeriod(std::int64_t time) const
+{
+	if ( pimpl->duration > 0 )
+	{
+		return FloorDiv(time - pimpl->origin,pimpl->duration);
+	}
+
+	std::int64_t days = FloorDiv(time + pimpl->utc_offset,seconds_per_day);
+	switch ( pimpl->calendar )
+	{
+		case DAY:
+			return days;
+
+		case WEEK:
+			// 1970-01-01 was a Thursday
+			return FloorDiv(days + 3,7);
+
+		case MONTH:
+		case YEAR:
+		{
+			std::int64_t year  = 0;
+			unsigned int month = 0;
+			CivilFromDays(days,year,month);
+			return pimpl->calendar == YEAR ? year - 1970 : (year - 1970) * 12 + (month - 1);
+		}
+	}
+	return days;
+}
+
+
+
+void Glicko2_periods::Bucket(const Glicko2_match* matches, std::size_t count, unsigned int threads)
+{
+	GLICKO2_TRACE_SCOPE(INGEST);
+
+	Glicko2_periods_impl& p = *pimpl;
+	p.sorted.resize(count);
+	p.periods.clear();
+	p.offsets.assign(1,0);
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	// small inputs are not worth the threads
+	std::size_t most = (count + thread_matches - 1) / thread_matches;
+	threads = threads < 1 ? 1 : (threads > most ? (unsigned int)most : threads);
+
+	// period of every match, and the range they span
+	std::vector<Entry>        entries(count);
+	std::vector<std::int64_t> lows(threads,std::numeric_limits<std::int64_t>::max());
+	std::vector<std::int64_t> highs(threads,std::numeric_limits<std::int64_t>::min());
+	ParallelFor(threads,count,[&](unsigned int t, std::size_t begin, std::size_t end)
+	{
+		for ( std::size_t i=begin;i<end;i++ )
+		{
+			std::int64_t period = GetPeriod(matches[i].time);
+			entries[i].key   = (std::uint64_t)period;
+			entries[i].index = i;
+			lows[t]  = period < lows[t]  ? period : lows[t];
+			highs[t] = period > highs[t] ? period : highs[t];
+		}
+	});
+
+	std::int64_t low  = lows[0];
+	std::int64_t high = highs[0];
+	for ( unsigned int t=1;t<threads;t++ )
+	{
+		low  = lows[t]  < low  ? lows[t]  : low;
+		high = highs[t] > high ? highs[t] : high;
+	}
+
+	// keys relative to the first period need only as many bits as the range
+	std::uint64_t range = (std::uint64_t)high - (std::uint64_t)low;
+	unsigned int  bits  = 0;
+	while ( bits < 64 && (range >> bits) != 0 )
+	{
+		bits++;
+	}
+	unsigned int digit  = bits <= counting_bits ? (bits > 0 ? bits : 1) : digit_bits;
+	unsigned int passes = bits == 0 ? 0 : (bits + digit - 1) / digit;
+
+	ParallelFor(threads,count,[&](unsigned int, std::size_t begin, std::size_t end)
+	{
+		for ( std::size_t i=begin;i<end;i++ )
+		{
+			entries[i].key -= (std::uint64_t)low;
+		}
+	});
+
+	// least significant digit first; each pass is a stable counting sort, each
+	// thread counting and then placing its own share of the entries
+	std::vector<Entry>       scratch(passes > 0 ? count : 0);
+	std::size_t              buckets = (std::size_t)1 << digit;
+	std::vector<std::size_t> counts(threads * buckets);
+	for ( unsigned int pass=0;pass<passes;pass++ )
+	{
+		unsigned int shift = pass * digit;
+		std::fill(counts.begin(),counts.end(),0);
+
+		ParallelFor(threads,count,[&](unsigned int t, std::size_t begin, std::size_t end)
+		{
+			std::size_t* mine = &counts[t * buckets];
+			for ( std::size_t i=begin;i<end;i++ )
+			{
+				mine[(entries[i].key >> shift) & (buckets - 1)]++;
+			}
+		});
+
+		// each thread's first slot per bucket comes after every lower bucket,
+		// and after the same bucket's entries of earlier threads
+		std::size_t next = 0;
+		for ( std::size_t b=0;b<buckets;b++ )
+		{
+			for ( unsigned int t=0;t<threads;t++ )
+			{
+				std::size_t n = counts[t * buckets + b];
+				counts[t * buckets + b] = next;
+				next += n;
+			}
+		}
+
+		ParallelFor(threads,count,[&](unsigned int t, std::size_t begin, std::size_t end)
+		{
+			std::size_t* mine = &counts[t * buckets];
+			for ( std::size_t i=begin;i<end;i++ )
+			{
+				scratch[mine[(entries[i].key >> shift) & (buckets - 1)]++] = entries[i];
+			}
+		});
+
+		entries.swap(scratch);
+	}
+
+	ParallelFor(threads,count,[&](unsigned int, std::size_t begin, std::size_t end)
+	{
+		for ( std::size_t i=begin;i<end;i++ )
+		{
+			p.sorted[i] = matches[entries[i].index];
+		}
+	});
+
+	// a batch starts wherever the period changes
+	p.periods.push_back(low + (std::int64_t)entries[0].key);
+	for ( std::size_t i=1;i<count;i++ )
+	{
+		if ( entries[i].key != entries[i-1].key )
+		{
+			p.offsets.push_back(i);
+			p.periods.push_back(low + (std::int64_t)entries[i].key);
+		}
+	}
+	p.offsets.push_back(count);
+}
+
+
+
+std::size_t Glicko2_periods::GetBatchCount() const
+{
+	return pimpl->periods.size();
+}
+
+
+
+std::int64_t Glicko2_periods::GetBatchPeriod(std::size_t batch) const
+{
+	return pimpl->periods[batch];
+}
+
+
+
+const Glicko2_match* Glicko2_periods::GetBatch(std::size_t batch) const
+{
+	return &pimpl->sorted[0] + pimpl->offsets[batch];
+}
+
+
+
+std::size_t Glicko2_periods::GetBatchSize(std::size_t batch) const
+{
+	return pimpl->offsets[batch+1] - pimpl->offsets[batch];
+}
+
+
+
+void Glicko2_periods::AddBatch(std::size_t batch, Glicko2_population& population) const
+{
+	const Glicko2_match* match = GetBatch(batch);
+	std::size_t          size  = GetBatchSize(batch);
+	for ( std::size_t i=0;i<size;i++ )
+	{
+		population.AddResult(match[i].player,match[i].opponent,match[i].score);
+		population.AddResult(match[i].opponent,match[i].player,1.0 - match[i].score);
+	}
+}
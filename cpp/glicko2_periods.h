@@ -0,0 +1,209 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_periods_h__
+#define __glicko2_periods_h__
+
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+
+class Glicko2_population;
+class Glicko2_periods_impl;
+
+
+
+/**
+ * A timestamped contest between two players.
+ */
+struct Glicko2_match
+{
+	/**
+	 * Time of the contest; seconds since 1970-01-01 UTC for calendar periods,
+	 * any unit otherwise.
+	 */
+	std::int64_t time;
+
+	/**
+	 * Player index of one player.
+	 */
+	unsigned int player;
+
+	/**
+	 * Player index of the other player.
+	 */
+	unsigned int opponent;
+
+	/**
+	 * 1.0 for a win, 0.0 for a loss, 0.5 for a draw, from the point of view of
+	 * player.
+	 */
+	double score;
+};
+
+
+
+/**
+ * Splits a stream of timestamped matches into rating periods.
+ *
+ * Periods are either of a fixed duration from an origin, or aligned to the
+ * UTC calendar: days, weeks starting on Monday, months, or years, optionally
+ * shifted to a local time zone.  Each match is given its period number, and
+ * the matches are sorted by it with a radix sort, a single counting pass when
+ * the matches span few enough periods, split across threads.  The sort is
+ * stable, so matches within a period keep their order.  The result is one
+ * batch per period that holds at least one match, in time order, each ready
+ * to add to a Glicko2_population.
+ */
+class Glicko2_periods
+{
+	public:
+
+
+
+		/**
+		 * Calendar periods.
+		 */
+		enum CALENDAR
+		{
+			DAY,
+			WEEK,
+			MONTH,
+			YEAR
+		};
+
+
+
+		/**
+		 * Constructor for periods of a fixed duration.  Period n holds times in
+		 * [origin + n*duration, origin + (n+1)*duration).
+		 *
+		 * @param origin   Start of period 0.
+		 * @param duration Length of each period, in the same unit as the times;
+		 *                 must be positive.
+		 */
+		Glicko2_periods(std::int64_t origin, std::int64_t duration);
+
+		/**
+		 * Constructor for calendar periods.  Periods are numbered from the one
+		 * holding 1970-01-01, so period 0 of WEEK is the week starting on Monday
+		 * 1969-12-29.
+		 *
+		 * @param calendar   Period length.
+		 * @param utc_offset Seconds to add to UTC to get the local time at which
+		 *                   periods begin.
+		 */
+		explicit Glicko2_periods(CALENDAR calendar, std::int64_t utc_offset = 0);
+
+		/**
+		 * Destructor.
+		 */
+		~Glicko2_periods();
+
+
+
+		/**
+		 * Get the period a time falls in.
+		 *
+		 * @param time Time.
+		 *
+		 * @return Period number.
+		 */
+		std::int64_t GetPeriod(std::int64_t time) const;
+
+		/**
+		 * Sort matches into batches by period, replacing any previous batches.
+		 * The matches are copied.
+		 *
+		 * @param matches Matches, in any order.
+		 * @param count   Number of matches.
+		 * @param threads Number of threads to split the sort across.
+		 */
+		void Bucket(const Glicko2_match* matches, std::size_t count, unsigned int threads = 1);
+
+
+
+		/**
+		 * @return Number of batches; only periods holding a match have one.
+		 */
+		std::size_t GetBatchCount() const;
+
+		/**
+		 * Get the period of a batch.
+		 *
+		 * @param batch Batch index, in period order.
+		 *
+		 * @return Period number.
+		 */
+		std::int64_t GetBatchPeriod(std::size_t batch) const;
+
+		/**
+		 * Get the matches of a batch.
+		 *
+		 * @param batch Batch index.
+		 *
+		 * @return First match of the batch.
+		 */
+		const Glicko2_match* GetBatch(std::size_t batch) const;
+
+		/**
+		 * Get the number of matches in a batch.
+		 *
+		 * @param batch Batch index.
+		 *
+		 * @return Match count.
+		 */
+		std::size_t GetBatchSize(std::size_t batch) const;
+
+		/**
+		 * Add every match of a batch to a population, as AddResult() for both
+		 * players.
+		 *
+		 * @param batch      Batch index.
+		 * @param population Population the match players belong to.
+		 */
+		void AddBatch(std::size_t batch, Glicko2_population& population) const;
+
+
+
+	private:
+
+		Glicko2_periods(const Glicko2_periods&);
+		Glicko2_periods& operator=(const Glicko2_periods&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_periods_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_periods_h__
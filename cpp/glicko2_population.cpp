@@ -0,0 +1,1256 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_population.h"
+#include "glicko2_arrow.h"
+#include "glicko2_events.h"
+#include "glicko2_huge.h"
+#include "glicko2_numa.h"
+#include "glicko2_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+
+namespace
+{
+	// a player's location is a hot slot, or cold_flag plus a cold block number
+	const std::uint32_t cold_flag = 0x80000000u;
+
+	// players per cold block
+	const unsigned int cold_block_size = 256;
+
+	// cold tier quantization steps per Glicko point, and per unit volatility
+	const double rating_steps     = 32.0;
+	const double volatility_steps = 1000000.0;
+
+
+
+	void PutVarint(std::vector<unsigned char>& out, std::uint64_t value)
+	{
+		while ( value >= 0x80 )
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+
+
+
+	std::uint64_t GetVarint(const unsigned char*& in)
+	{
+		std::uint64_t value = 0;
+		unsigned int  shift = 0;
+		while ( *in & 0x80 )
+		{
+			value |= (std::uint64_t)(*in++ & 0x7f) << shift;
+			shift += 7;
+		}
+		value |= (std::uint64_t)(*in++) << shift;
+		return value;
+	}
+
+
+
+	std::uint64_t ZigZag(std::int64_t value)
+	{
+		return ((std::uint64_t)value << 1) ^ (std::uint64_t)(value >> 63);
+	}
+
+
+
+	std::int64_t UnZigZag(std::uint64_t value)
+	{
+		return (std::int64_t)(value >> 1) ^ -(std::int64_t)(value & 1);
+	}
+
+
+
+	// a decoded cold player
+	struct ColdRecord
+	{
+		unsigned int   player;
+		Glicko2_rating state;
+		std::uint32_t  last_active;
+	};
+
+
+
+	// up to cold_block_size cold players, quantized and varint coded; each
+	// record's player index is coded relative to the previous record's
+	class ColdBlock
+	{
+		public:
+
+			ColdBlock() : count(0), last_player(0) {}
+
+			unsigned int GetCount() const { return count; }
+			std::size_t  GetBytes() const { return bytes.capacity(); }
+
+			void Append(const ColdRecord& record)
+			{
+				PutVarint(bytes,ZigZag((std::int64_t)record.player - (std::int64_t)last_player));
+				PutVarint(bytes,ZigZag(std::llround((Glicko2_math::ToGlickoRating(record.state.rating) - Glicko2_math::center) * rating_steps)));
+				PutVarint(bytes,(std::uint64_t)std::llround(Glicko2_math::ToGlickoDeviation(record.state.deviation) * rating_steps));
+				PutVarint(bytes,(std::uint64_t)std::llround(record.state.volatility * volatility_steps));
+				PutVarint(bytes,record.last_active);
+
+				last_player = record.player;
+				count++;
+			}
+
+			void Decode(std::vector<ColdRecord>& records) const
+			{
+				records.resize(count);
+
+				const unsigned char* in     = bytes.empty() ? 0 : &bytes[0];
+				unsigned int         player = 0;
+				for ( unsigned int i=0;i<count;i++ )
+				{
+					player = (unsigned int)((std::int64_t)player + UnZigZag(GetVarint(in)));
+
+					ColdRecord& record = records[i];
+					record.player           = player;
+					record.state.rating     = Glicko2_math::ToGlicko2Rating((double)UnZigZag(GetVarint(in)) / rating_steps + Glicko2_math::center);
+					record.state.deviation  = Glicko2_math::ToGlicko2Deviation((double)GetVarint(in) / rating_steps);
+					record.state.volatility = (double)GetVarint(in) / volatility_steps;
+					record.last_active      = (std::uint32_t)GetVarint(in);
+				}
+			}
+
+			bool Find(unsigned int player, ColdRecord& found) const
+			{
+				std::vector<ColdRecord> records;
+				Decode(records);
+				for ( unsigned int i=0;i<records.size();i++ )
+				{
+					if ( records[i].player == player )
+					{
+						found = records[i];
+						return true;
+					}
+				}
+				return false;
+			}
+
+			void Remove(unsigned int player)
+			{
+				std::vector<ColdRecord> records;
+				Decode(records);
+
+				bytes.clear();
+				count       = 0;
+				last_player = 0;
+				for ( unsigned int i=0;i<records.size();i++ )
+				{
+					if ( records[i].player != player )
+					{
+						Append(records[i]);
+					}
+				}
+
+				if ( count == 0 )
+				{
+					std::vector<unsigned char>().swap(bytes);
+				}
+			}
+
+		private:
+
+			std::vector<unsigned char> bytes;
+			unsigned int               count;
+			unsigned int               last_player;
+	};
+
+
+
+	// one side of a contest
+	struct Result
+	{
+		unsigned int player;
+		unsigned int opponent;
+		double       score;
+	};
+
+
+
+	// columns, with Glicko2_huge_allocator
+	template <typename T>
+	using Column = std::vector<T,Glicko2_huge_allocator<T> >;
+
+
+
+	// move part of a column to a NUMA node
+	template <typename T>
+	void PlaceColumn(const Glicko2_numa& numa, unsigned int node, Column<T>& column, std::size_t begin, std::size_t end)
+	{
+		if ( begin < end )
+		{
+			numa.Place(&column[begin],(end - begin) * sizeof(T),node);
+		}
+	}
+}
+
+
+
+class Glicko2_population_impl
+{
+	public:
+
+		Glicko2_population_impl();
+
+		// rating period; atomic, as queries may read it while an update runs
+		std::atomic<unsigned int> period;
+
+		// hot tier columns that change with each rating period, by hot slot
+		struct Epoch
+		{
+			Column<double>        rating;
+			Column<double>        deviation;
+			Column<double>        volatility;
+			Column<std::uint32_t> last_active;
+		};
+
+		// the committed epoch, epochs[current], and the one before it; updates
+		// write the other epoch and commit by flipping current
+		Epoch                     epochs[2];
+		std::atomic<unsigned int> current;
+		bool                      can_rollback;
+
+		// hot slots written by the last update, where the two epochs differ
+		std::vector<unsigned int> changed;
+
+		// hot tier columns shared by both epochs, by hot slot
+		Column<unsigned int> slot_player;
+		Column<unsigned int> result_count;
+
+		// hot slot or cold block of each player
+		Column<std::uint32_t> location;
+
+		// cold tier
+		std::vector<ColdBlock> cold_blocks;
+		unsigned int           cold_count;
+
+		// external ids of players
+		Glicko2_index index;
+
+		// version of the population, advanced by every call that changes
+		// states, and the version each player last changed in, by player; the
+		// version is atomic, as queries may read it while an update runs
+		std::atomic<std::uint32_t> version;
+		Column<std::uint32_t>      versions;
+
+		// where changes are published, if anywhere
+		Glicko2_events* events;
+
+		// volatility freeze, and how often updates skipped or ran the solve
+		double                     volatility_freeze;
+		std::atomic<std::uint64_t> frozen_count;
+		std::atomic<std::uint64_t> solved_count;
+
+		// results of the open rating period
+		Column<Result> results;
+
+		// update in progress: results grouped by hot slot, with the opponents'
+		// ratings as of the start of the period, and per slot intermediate sums
+		Column<unsigned int> offsets;
+		Column<unsigned int> fill;
+		Column<double>       opponent_ratings;
+		Column<double>       opponent_deviations;
+		Column<double>       scores;
+		Column<double>       variance_sums;
+		Column<double>       delta_sums;
+		Column<double>       new_volatilities;
+
+		// committed and spare epochs
+		Epoch&       Front()       { return epochs[current.load(std::memory_order_acquire)]; }
+		const Epoch& Front() const { return epochs[current.load(std::memory_order_acquire)]; }
+		Epoch&       Back()        { return epochs[current.load(std::memory_order_relaxed) ^ 1]; }
+
+		// bring the spare epoch up to date with the committed one
+		void Sync();
+
+		// set a hot slot in both epochs
+		void Store(unsigned int slot, const Glicko2_rating& state, std::uint32_t active);
+
+		// stamp the changed slots with a new version, and publish them
+		void Changed();
+
+		// add a player to the hot tier
+		unsigned int AddHot(unsigned int player, const Glicko2_rating& state, std::uint32_t active);
+
+		// move a cold player to the hot tier; returns its hot slot
+		unsigned int Promote(unsigned int player);
+
+		// get any player's state
+		bool Find(unsigned int player, Glicko2_rating& state, std::uint32_t& active) const;
+
+		// move the columns of a range of hot slots, and of their results, to a
+		// node
+		void Place(const Glicko2_numa& numa, unsigned int node, unsigned int begin, unsigned int end);
+};
+
+
+
+Glicko2_population_impl::Glicko2_population_impl() :
+	period(0),
+	current(0),
+	can_rollback(false),
+	cold_count(0),
+	version(0),
+	events(0),
+	volatility_freeze(0.0),
+	frozen_count(0),
+	solved_count(0),
+	offsets(1,0)
+{
+}
+
+
+
+void Glicko2_population_impl::Sync()
+{
+	const Epoch& front = Front();
+	Epoch&       back  = Back();
+
+	for ( unsigned int i=0;i<changed.size();i++ )
+	{
+		unsigned int slot = changed[i];
+		back.rating[slot]      = front.rating[slot];
+		back.deviation[slot]   = front.deviation[slot];
+		back.volatility[slot]  = front.volatility[slot];
+		back.last_active[slot] = front.last_active[slot];
+	}
+	changed.clear();
+}
+
+
+
+void Glicko2_population_impl::Store(unsigned int slot, const Glicko2_rating& state, std::uint32_t active)
+{
+	for ( unsigned int e=0;e<2;e++ )
+	{
+		epochs[e].rating[slot]      = state.rating;
+		epochs[e].deviation[slot]   = state.deviation;
+		epochs[e].volatility[slot]  = state.volatility;
+		epochs[e].last_active[slot] = active;
+	}
+}
+
+
+
+void Glicko2_population_impl::Changed()
+{
+	version++;
+
+	const Epoch& front = Front();
+	const Epoch& back  = Back();
+	for ( unsigned int i=0;i<changed.size();i++ )
+	{
+		unsigned int slot   = changed[i];
+		unsigned int player = slot_player[slot];
+		versions[player] = version;
+
+		if ( events != 0 )
+		{
+			Glicko2_event event;
+			event.player            = player;
+			event.period            = period;
+			event.before.rating     = back.rating[slot];
+			event.before.deviation  = back.deviation[slot];
+			event.before.volatility = back.volatility[slot];
+			event.after.rating      = front.rating[slot];
+			event.after.deviation   = front.deviation[slot];
+			event.after.volatility  = front.volatility[slot];
+			events->Publish(event);
+		}
+	}
+}
+
+
+
+unsigned int Glicko2_population_impl::AddHot(unsigned int player, const Glicko2_rating& state, std::uint32_t active)
+{
+	unsigned int slot = (unsigned int)slot_player.size();
+
+	for ( unsigned int e=0;e<2;e++ )
+	{
+		epochs[e].rating.push_back(state.rating);
+		epochs[e].deviation.push_back(state.deviation);
+		epochs[e].volatility.push_back(state.volatility);
+		epochs[e].last_active.push_back(active);
+	}
+	slot_player.push_back(player);
+	result_count.push_back(0);
+
+	location[player] = slot;
+	return slot;
+}
+
+
+
+unsigned int Glicko2_population_impl::Promote(unsigned int player)
+{
+	std::uint32_t where = location[player];
+	if ( !(where & cold_flag) )
+	{
+		return where;
+	}
+
+	ColdBlock& block = cold_blocks[where & ~cold_flag];
+
+	ColdRecord record;
+	block.Find(player,record);
+	block.Remove(player);
+	cold_count--;
+
+	return AddHot(player,record.state,record.last_active);
+}
+
+
+
+bool Glicko2_population_impl::Find(unsigned int player, Glicko2_rating& state, std::uint32_t& active) const
+{
+	std::uint32_t where = location[player];
+	if ( !(where & cold_flag) )
+	{
+		const Epoch& front = Front();
+		state.rating     = front.rating[where];
+		state.deviation  = front.deviation[where];
+		state.volatility = front.volatility[where];
+		active           = front.last_active[where];
+		return true;
+	}
+
+	ColdRecord record;
+	if ( !cold_blocks[where & ~cold_flag].Find(player,record) )
+	{
+		return false;
+	}
+
+	state  = record.state;
+	active = record.last_active;
+	return true;
+}
+
+
+
+void Glicko2_population_impl::Place(const Glicko2_numa& numa, unsigned int node, unsigned int begin, unsigned int end)
+{
+	// placement is only a hint; memory that cannot be moved still works
+	for ( unsigned int e=0;e<2;e++ )
+	{
+		PlaceColumn(numa,node,epochs[e].rating,begin,end);
+		PlaceColumn(numa,node,epochs[e].deviation,begin,end);
+		PlaceColumn(numa,node,epochs[e].volatility,begin,end);
+		PlaceColumn(numa,node,epochs[e].last_active,begin,end);
+	}
+	PlaceColumn(numa,node,variance_sums,begin,end);
+	PlaceColumn(numa,node,delta_sums,begin,end);
+	PlaceColumn(numa,node,new_volatilities,begin,end);
+
+	PlaceColumn(numa,node,opponent_ratings,offsets[begin],offsets[end]);
+	PlaceColumn(numa,node,opponent_deviations,offsets[begin],offsets[end]);
+	PlaceColumn(numa,node,scores,offsets[begin],offsets[end]);
+}
+
+
+
+
+
+
+Glicko2_population::Glicko2_population() :
+	pimpl(0)
+{
+	pimpl = new Glicko2_population_impl;
+}
+
+
+
+Glicko2_population::~Glicko2_population()
+{
+	delete pimpl;
+}
+
+
+
+unsigned int Glicko2_population::AddPlayer()
+{
+	return AddPlayer(1500.0,350.0,0.06);
+}
+
+
+
+unsigned int Glicko2_population::AddPlayer(double rating, double deviation, double volatility)
+{
+	unsigned int player = (unsigned int)pimpl->location.size();
+	pimpl->location.push_back(0);
+	pimpl->versions.push_back(++pimpl->version);
+	pimpl->AddHot(player,Glicko2_math::FromGlicko(rating,deviation,volatility),pimpl->period);
+	return player;
+}
+
+
+
+unsigned int Glicko2_population::GetPlayerCount() const
+{
+	return (unsigned int)pimpl->location.size();
+}
+
+
+
+Glicko2_index& Glicko2_population::GetIndex()
+{
+	return pimpl->index;
+}
+
+
+
+const Glicko2_index& Glicko2_population::GetIndex() const
+{
+	return pimpl->index;
+}
+
+
+
+double Glicko2_population::GetRating(unsigned int player) const
+{
+	return Glicko2_math::ToGlickoRating(GetState(player).rating);
+}
+
+
+
+double Glicko2_population::GetDeviation(unsigned int player) const
+{
+	return Glicko2_math::ToGlickoDeviation(GetState(player).deviation);
+}
+
+
+
+double Glicko2_population::GetVolatility(unsigned int player) const
+{
+	return GetState(player).volatility;
+}
+
+
+
+Glicko2_rating Glicko2_population::GetState(unsigned int player) const
+{
+	Glicko2_rating state = Glicko2_rating();
+	std::uint32_t  active = 0;
+	pimpl->Find(player,state,active);
+	return state;
+}
+
+
+
+void Glicko2_population::SetState(unsigned int player, const Glicko2_rating& state)
+{
+	// not part of any rating period, so it survives Rollback()
+	unsigned int slot = pimpl->Promote(player);
+	pimpl->Store(slot,state,pimpl->Front().last_active[slot]);
+	pimpl->versions[player] = ++pimpl->version;
+}
+
+
+
+void Glicko2_population::SetState(unsigned int player, const Glicko2_rating& state, unsigned int last_active)
+{
+	pimpl->Store(pimpl->Promote(player),state,last_active);
+	pimpl->versions[player] = ++pimpl->version;
+}
+
+
+
+void Glicko2_population::GetStates(const unsigned int* players, std::size_t count, Glicko2_rating* states, unsigned int* last_active) const
+{
+	const Glicko2_population_impl&        p     = *pimpl;
+	const Glicko2_population_impl::Epoch& front = p.Front();
+
+	// hot players directly; cold players are gathered by block
+	std::vector<std::pair<std::uint32_t,std::size_t> > cold;
+	for ( std::size_t i=0;i<count;i++ )
+	{
+		std::uint32_t where = p.location[players[i]];
+		if ( where & cold_flag )
+		{
+			cold.push_back(std::make_pair(where & ~cold_flag,i));
+			continue;
+		}
+		states[i].rating     = front.rating[where];
+		states[i].deviation  = front.deviation[where];
+		states[i].volatility = front.volatility[where];
+		last_active[i]       = front.last_active[where];
+	}
+	std::sort(cold.begin(),cold.end());
+
+	std::vector<ColdRecord> records;
+	for ( std::size_t i=0;i<cold.size();i++ )
+	{
+		if ( i == 0 || cold[i].first != cold[i-1].first )
+		{
+			p.cold_blocks[cold[i].first].Decode(records);
+			std::sort(records.begin(),records.end(),[](const ColdRecord& a, const ColdRecord& b) { return a.player < b.player; });
+		}
+
+		std::size_t j = cold[i].second;
+		ColdRecord  key;
+		key.player = players[j];
+		std::vector<ColdRecord>::const_iterator found = std::lower_bound(records.begin(),records.end(),key,[](const ColdRecord& a, const ColdRecord& b) { return a.player < b.player; });
+		states[j]      = found->state;
+		last_active[j] = found->last_active;
+	}
+}
+
+
+
+unsigned int Glicko2_population::GetLastActive(unsigned int player) const
+{
+	Glicko2_rating state = Glicko2_rating();
+	std::uint32_t  active = 0;
+	pimpl->Find(player,state,active);
+	return active;
+}
+
+
+
+unsigned int Glicko2_population::GetVersion() const
+{
+	return pimpl->version;
+}
+
+
+
+void Glicko2_population::GetChangedSince(unsigned int version, std::vector<unsigned int>& players) const
+{
+	const Column<std::uint32_t>& versions = pimpl->versions;
+
+	players.clear();
+	for ( unsigned int i=0;i<versions.size();i++ )
+	{
+		if ( versions[i] > version )
+		{
+			players.push_back(i);
+		}
+	}
+}
+
+
+
+void Glicko2_population::SetEvents(Glicko2_events* events)
+{
+	pimpl->events = events;
+}
+
+
+
+void Glicko2_population::AddResult(unsigned int player, unsigned int opponent, double score)
+{
+	// returning players come back to the hot tier
+	unsigned int slot = pimpl->Promote(player);
+	pimpl->Promote(opponent);
+
+	Result result;
+	result.player   = player;
+	result.opponent = opponent;
+	result.score    = score;
+	pimpl->results.push_back(result);
+
+	pimpl->result_count[slot]++;
+}
+
+
+
+void Glicko2_population::AddMatch(unsigned int player, unsigned int opponent, Glicko2::RESULT result)
+{
+	double score = 0.0;
+	switch ( result )
+	{
+		case Glicko2::WIN:
+			score = 1.0;
+			break;
+
+		case Glicko2::LOSS:
+			score = 0.0;
+			break;
+
+		case Glicko2::DRAW:
+			score = 0.5;
+			break;
+	}
+
+	AddResult(player,opponent,score);
+	AddResult(opponent,player,1.0 - score);
+}
+
+
+
+std::size_t Glicko2_population::GetResultCount() const
+{
+	return pimpl->results.size();
+}
+
+
+
+void Glicko2_population::Update(unsigned int threads)
+{
+	BeginUpdate();
+
+	unsigned int size = GetUpdateSize();
+	if ( threads <= 1 || size < 2 )
+	{
+		UpdateRange(0,size);
+	}
+	else
+	{
+		std::vector<std::thread> workers;
+		for ( unsigned int i=0;i<threads;i++ )
+		{
+			unsigned int begin = (unsigned int)((unsigned long long)size * i / threads);
+			unsigned int end   = (unsigned int)((unsigned long long)size * (i+1) / threads);
+			workers.push_back(std::thread(&Glicko2_population::UpdateRange,this,begin,end));
+		}
+		for ( unsigned int i=0;i<workers.size();i++ )
+		{
+			workers[i].join();
+		}
+	}
+
+	EndUpdate();
+}
+
+
+
+void Glicko2_population::Update(const Glicko2_numa& numa, unsigned int threads_per_node)
+{
+	BeginUpdate();
+
+	Glicko2_population_impl& p       = *pimpl;
+	unsigned int             size    = GetUpdateSize();
+	unsigned int             nodes   = numa.GetNodeCount();
+	unsigned int             threads = threads_per_node > 0 ? threads_per_node : 1;
+
+	std::vector<std::thread> workers;
+	for ( unsigned int node=0;node<nodes;node++ )
+	{
+		unsigned int node_begin = (unsigned int)((unsigned long long)size * node / nodes);
+		unsigned int node_end   = (unsigned int)((unsigned long long)size * (node+1) / nodes);
+		if ( nodes > 1 )
+		{
+			p.Place(numa,node,node_begin,node_end);
+		}
+
+		for ( unsigned int i=0;i<threads;i++ )
+		{
+			unsigned int begin = node_begin + (unsigned int)((unsigned long long)(node_end - node_begin) * i / threads);
+			unsigned int end   = node_begin + (unsigned int)((unsigned long long)(node_end - node_begin) * (i+1) / threads);
+			workers.push_back(std::thread([this,&numa,node,begin,end]()
+			{
+				numa.Pin(node);
+				UpdateRange(begin,end);
+			}));
+		}
+	}
+	for ( unsigned int i=0;i<workers.size();i++ )
+	{
+		workers[i].join();
+	}
+
+	EndUpdate();
+}
+
+
+
+void Glicko2_population::BeginUpdate()
+{
+	GLICKO2_TRACE_SCOPE(GRAPH_BUILD);
+
+	Glicko2_population_impl& p   = *pimpl;
+	unsigned int             hot = (unsigned int)p.slot_player.size();
+
+	// the spare epoch becomes the new one; it need only catch up on the
+	// players the last update changed, and this period's players are then
+	// the ones that will differ
+	p.Sync();
+	for ( unsigned int slot=0;slot<hot;slot++ )
+	{
+		if ( p.result_count[slot] != 0 )
+		{
+			p.changed.push_back(slot);
+		}
+	}
+	p.can_rollback = false;
+
+	// results are grouped by hot slot; each group starts at offsets[slot]
+	p.offsets.resize(hot + 1);
+	p.offsets[0] = 0;
+	for ( unsigned int slot=0;slot<hot;slot++ )
+	{
+		p.offsets[slot+1] = p.offsets[slot] + p.result_count[slot];
+	}
+	p.fill.assign(p.offsets.begin(),p.offsets.end() - 1);
+
+	// copy each opponent's rating now, so the sums read contiguous arrays
+	const Glicko2_population_impl::Epoch& front = p.Front();
+	std::size_t total = p.results.size();
+	p.opponent_ratings.resize(total);
+	p.opponent_deviations.resize(total);
+	p.scores.resize(total);
+	for ( std::size_t i=0;i<total;i++ )
+	{
+		const Result& result   = p.results[i];
+		unsigned int  opponent = p.location[result.opponent];
+		unsigned int  k        = p.fill[p.location[result.player]]++;
+
+		p.opponent_ratings[k]    = front.rating[opponent];
+		p.opponent_deviations[k] = front.deviation[opponent];
+		p.scores[k]              = result.score;
+	}
+
+	p.variance_sums.resize(hot);
+	p.delta_sums.resize(hot);
+	p.new_volatilities.resize(hot);
+}
+
+
+
+unsigned int Glicko2_population::GetUpdateSize() const
+{
+	return (unsigned int)pimpl->offsets.size() - 1;
+}
+
+
+
+void Glicko2_population::UpdateRange(unsigned int begin, unsigned int end)
+{
+	Glicko2_population_impl&              p     = *pimpl;
+	const Glicko2_population_impl::Epoch& front = p.Front();
+	Glicko2_population_impl::Epoch&       back  = p.Back();
+
+	// each step runs over the whole range before the next, keeping the loops
+	// tight and the trace showing time per step
+	{
+		GLICKO2_TRACE_SCOPE(SUMS);
+		for ( unsigned int slot=begin;slot<end;slot++ )
+		{
+			unsigned int first = p.offsets[slot];
+			unsigned int count = p.offsets[slot+1] - first;
+			if ( count == 0 )
+			{
+				continue;
+			}
+
+			double variance_sum = 0.0;
+			double delta_sum    = 0.0;
+			Glicko2_math::Accumulate(front.rating[slot],&p.opponent_ratings[first],&p.opponent_deviations[first],&p.scores[first],count,variance_sum,delta_sum);
+			p.variance_sums[slot] = variance_sum;
+			p.delta_sums[slot]    = delta_sum;
+		}
+	}
+
+	{
+		GLICKO2_TRACE_SCOPE(SOLVER);
+		std::uint64_t frozen = 0;
+		std::uint64_t solved = 0;
+		for ( unsigned int slot=begin;slot<end;slot++ )
+		{
+			if ( p.offsets[slot+1] == p.offsets[slot] )
+			{
+				continue;
+			}
+
+			double variance = 1.0 / p.variance_sums[slot];
+			bool   skipped;
+			p.new_volatilities[slot] = Glicko2_math::SolveVolatility(front.deviation[slot],front.volatility[slot],variance,variance*p.delta_sums[slot],p.volatility_freeze,skipped);
+			frozen += skipped ? 1 : 0;
+			solved += skipped ? 0 : 1;
+		}
+
+		// counted once per range, so concurrent ranges do not contend
+		p.frozen_count.fetch_add(frozen,std::memory_order_relaxed);
+		p.solved_count.fetch_add(solved,std::memory_order_relaxed);
+	}
+
+	{
+		GLICKO2_TRACE_SCOPE(FINALIZE);
+		unsigned int period = p.period.load(std::memory_order_relaxed);
+		for ( unsigned int slot=begin;slot<end;slot++ )
+		{
+			if ( p.offsets[slot+1] == p.offsets[slot] )
+			{
+				continue;
+			}
+
+			Glicko2_rating state;
+			state.rating     = front.rating[slot];
+			state.deviation  = front.deviation[slot];
+			state.volatility = front.volatility[slot];
+			Glicko2_math::Finalize(state,p.new_volatilities[slot],p.variance_sums[slot],p.delta_sums[slot]);
+
+			back.rating[slot]      = state.rating;
+			back.deviation[slot]   = state.deviation;
+			back.volatility[slot]  = state.volatility;
+			back.last_active[slot] = period;
+		}
+	}
+}
+
+
+
+void Glicko2_population::EndUpdate()
+{
+	Glicko2_population_impl& p = *pimpl;
+
+	// commit; the old epoch is kept for Rollback()
+	p.current.store(p.current.load(std::memory_order_relaxed) ^ 1,std::memory_order_release);
+	p.can_rollback = true;
+
+	p.results.clear();
+	p.result_count.assign(p.result_count.size(),0);
+	p.offsets.assign(1,0);
+	p.period++;
+	p.Changed();
+}
+
+
+
+void Glicko2_population::SetVolatilityFreeze(double freeze)
+{
+	pimpl->volatility_freeze = freeze > 0.0 ? freeze : 0.0;
+}
+
+
+
+double Glicko2_population::GetVolatilityFreeze() const
+{
+	return pimpl->volatility_freeze;
+}
+
+
+
+std::uint64_t Glicko2_population::GetFrozenCount() const
+{
+	return pimpl->frozen_count.load(std::memory_order_relaxed);
+}
+
+
+
+std::uint64_t Glicko2_population::GetSolvedCount() const
+{
+	return pimpl->solved_count.load(std::memory_order_relaxed);
+}
+
+
+
+bool Glicko2_population::Rollback()
+{
+	Glicko2_population_impl& p = *pimpl;
+	if ( !p.can_rollback || !p.results.empty() )
+	{
+		return false;
+	}
+
+	// the two epochs still differ in exactly the changed slots, so the next
+	// update catches up from the restored epoch as usual
+	p.current.store(p.current.load(std::memory_order_relaxed) ^ 1,std::memory_order_release);
+	p.can_rollback = false;
+	p.period--;
+	p.Changed();
+	return true;
+}
+
+
+
+bool Glicko2_population::CanRollback() const
+{
+	return pimpl->can_rollback && pimpl->results.empty();
+}
+
+
+
+unsigned int Glicko2_population::GetPeriod() const
+{
+	return pimpl->period;
+}
+
+
+
+bool Glicko2_population::SetPeriod(unsigned int period)
+{
+	Glicko2_population_impl& p = *pimpl;
+	if ( !p.results.empty() )
+	{
+		return false;
+	}
+
+	p.can_rollback = false;
+	p.period       = period;
+	return true;
+}
+
+
+
+unsigned int Glicko2_population::Demote(unsigned int inactive_periods)
+{
+	Glicko2_population_impl& p     = *pimpl;
+	unsigned int             moved = 0;
+
+	// moving players renumbers hot slots, so commit to the current epoch and
+	// keep both epochs identical from here on
+	p.Sync();
+	p.can_rollback = false;
+	std::uint32_t version = ++p.version;
+	unsigned int  period  = p.period;
+
+	// players with pending results count them in result_count, but players
+	// who are only opponents do not; both must stay hot for the update
+	std::vector<bool> opponents(p.location.size(),false);
+	for ( std::size_t i=0;i<p.results.size();i++ )
+	{
+		opponents[p.results[i].opponent] = true;
+	}
+
+	Glicko2_population_impl::Epoch& front = p.Front();
+	for ( unsigned int slot=(unsigned int)p.slot_player.size();slot>0;slot-- )
+	{
+		unsigned int s = slot - 1;
+		// last_active can be ahead of period after SetState(), SetPeriod() or
+		// ReadArrow(); such a player counts as active
+		if ( p.result_count[s] != 0 || opponents[p.slot_player[s]] || front.last_active[s] >= period || period - front.last_active[s] <= inactive_periods )
+		{
+			continue;
+		}
+
+		// append to the last cold block, starting a new one when it is full
+		if ( p.cold_blocks.empty() || p.cold_blocks.back().GetCount() >= cold_block_size )
+		{
+			p.cold_blocks.push_back(ColdBlock());
+		}
+
+		ColdRecord record;
+		record.player           = p.slot_player[s];
+		record.state.rating     = front.rating[s];
+		record.state.deviation  = front.deviation[s];
+		record.state.volatility = front.volatility[s];
+		record.last_active      = front.last_active[s];
+		p.cold_blocks.back().Append(record);
+		p.location[record.player] = cold_flag | (std::uint32_t)(p.cold_blocks.size() - 1);
+		p.versions[record.player] = version;
+		p.cold_count++;
+
+		// fill the hole with the last hot player
+		unsigned int last = (unsigned int)p.slot_player.size() - 1;
+		for ( unsigned int e=0;e<2;e++ )
+		{
+			Glicko2_population_impl::Epoch& epoch = p.epochs[e];
+			epoch.rating[s]      = epoch.rating[last];
+			epoch.deviation[s]   = epoch.deviation[last];
+			epoch.volatility[s]  = epoch.volatility[last];
+			epoch.last_active[s] = epoch.last_active[last];
+			epoch.rating.pop_back();
+			epoch.deviation.pop_back();
+			epoch.volatility.pop_back();
+			epoch.last_active.pop_back();
+		}
+		if ( s != last )
+		{
+			p.slot_player[s]  = p.slot_player[last];
+			p.result_count[s] = p.result_count[last];
+			p.location[p.slot_player[s]] = s;
+		}
+		p.slot_player.pop_back();
+		p.result_count.pop_back();
+
+		moved++;
+	}
+
+	return moved;
+}
+
+
+
+bool Glicko2_population::IsCold(unsigned int player) const
+{
+	return (pimpl->location[player] & cold_flag) != 0;
+}
+
+
+
+unsigned int Glicko2_population::GetHotCount() const
+{
+	return (unsigned int)pimpl->slot_player.size();
+}
+
+
+
+unsigned int Glicko2_population::GetColdCount() const
+{
+	return pimpl->cold_count;
+}
+
+
+
+std::size_t Glicko2_population::GetColdBytes() const
+{
+	std::size_t bytes = 0;
+	for ( unsigned int i=0;i<pimpl->cold_blocks.size();i++ )
+	{
+		bytes += pimpl->cold_blocks[i].GetBytes();
+	}
+	return bytes;
+}
+
+
+
+bool Glicko2_population::WriteArrow(const char* path) const
+{
+	const Glicko2_population_impl& p = *pimpl;
+
+	Glicko2_arrow_writer writer;
+	writer.AddColumn("player",Glicko2_arrow_writer::UINT32);
+	writer.AddColumn("rating",Glicko2_arrow_writer::DOUBLE);
+	writer.AddColumn("deviation",Glicko2_arrow_writer::DOUBLE);
+	writer.AddColumn("volatility",Glicko2_arrow_writer::DOUBLE);
+	writer.AddColumn("last_active",Glicko2_arrow_writer::UINT32);
+	bool ok = writer.Open(path);
+
+	// the hot tier as it is
+	const Glicko2_population_impl::Epoch& front = p.Front();
+	if ( !p.slot_player.empty() )
+	{
+		const void* columns[] = { &p.slot_player[0], &front.rating[0], &front.deviation[0], &front.volatility[0], &front.last_active[0] };
+		ok = ok && writer.WriteBatch(p.slot_player.size(),columns);
+	}
+
+	// the cold tier, decoded into columns a few blocks at a time
+	std::vector<ColdRecord>    records;
+	std::vector<unsigned int>  players;
+	std::vector<double>        ratings, deviations, volatilities;
+	std::vector<std::uint32_t> last_active;
+	for ( unsigned int b=0;ok && b<p.cold_blocks.size();b++ )
+	{
+		p.cold_blocks[b].Decode(records);
+		for ( unsigned int i=0;i<records.size();i++ )
+		{
+			players.push_back(records[i].player);
+			ratings.push_back(records[i].state.rating);
+			deviations.push_back(records[i].state.deviation);
+			volatilities.push_back(records[i].state.volatility);
+			last_active.push_back(records[i].last_active);
+		}
+
+		if ( !players.empty() && (players.size() >= 256 * cold_block_size || b + 1 == p.cold_blocks.size()) )
+		{
+			const void* columns[] = { &players[0], &ratings[0], &deviations[0], &volatilities[0], &last_active[0] };
+			ok = writer.WriteBatch(players.size(),columns);
+			players.clear();
+			ratings.clear();
+			deviations.clear();
+			volatilities.clear();
+			last_active.clear();
+		}
+	}
+
+	return writer.Close() && ok;
+}
+
+
+
+bool Glicko2_population::ReadArrow(const char* path)
+{
+	Glicko2_arrow_reader reader;
+	if ( !reader.Open(path) )
+	{
+		return false;
+	}
+
+	const char*                      names[] = { "player", "rating", "deviation", "volatility", "last_active" };
+	const Glicko2_arrow_writer::TYPE types[] = { Glicko2_arrow_writer::UINT32, Glicko2_arrow_writer::DOUBLE, Glicko2_arrow_writer::DOUBLE, Glicko2_arrow_writer::DOUBLE, Glicko2_arrow_writer::UINT32 };
+	unsigned int                     columns[5];
+	for ( unsigned int c=0;c<5;c++ )
+	{
+		columns[c] = reader.FindColumn(names[c]);
+		if ( columns[c] == Glicko2_arrow_reader::not_found || reader.GetColumnType(columns[c]) != types[c] )
+		{
+			return false;
+		}
+	}
+
+	// read and check every batch before changing anything, so a bad file
+	// leaves the population as it was
+	std::vector<std::uint32_t>  players;
+	std::vector<Glicko2_rating> states;
+	std::vector<std::uint32_t>  last_active;
+	std::uint32_t               highest = 0;
+	for ( std::size_t batch=0;batch<reader.GetBatchCount();batch++ )
+	{
+		if ( !reader.ReadBatch(batch) )
+		{
+			return false;
+		}
+
+		const std::uint32_t* batch_players      = static_cast<const std::uint32_t*>(reader.GetColumn(columns[0]));
+		const double*        batch_ratings      = static_cast<const double*>(reader.GetColumn(columns[1]));
+		const double*        batch_deviations   = static_cast<const double*>(reader.GetColumn(columns[2]));
+		const double*        batch_volatilities = static_cast<const double*>(reader.GetColumn(columns[3]));
+		const std::uint32_t* batch_last_active  = static_cast<const std::uint32_t*>(reader.GetColumn(columns[4]));
+		for ( std::size_t i=0;i<reader.GetRowCount();i++ )
+		{
+			Glicko2_rating state;
+			state.rating     = batch_ratings[i];
+			state.deviation  = batch_deviations[i];
+			state.volatility = batch_volatilities[i];
+			players.push_back(batch_players[i]);
+			states.push_back(state);
+			last_active.push_back(batch_last_active[i]);
+			highest = std::max(highest,batch_players[i]);
+		}
+	}
+
+	// new players must be numbered within the file, or a single row could
+	// add billions of them
+	if ( !players.empty() && (highest >= cold_flag || (highest >= GetPlayerCount() && highest >= players.size())) )
+	{
+		return false;
+	}
+
+	while ( !players.empty() && highest >= GetPlayerCount() )
+	{
+		AddPlayer();
+	}
+	for ( std::size_t i=0;i<players.size();i++ )
+	{
+		SetState(players[i],states[i],last_active[i]);
+	}
+	return true;
+}
@@ -0,0 +1,473 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_population_h__
+#define __glicko2_population_h__
+
+
+
+#include "glicko2.h"
+#include "glicko2_index.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+
+class Glicko2_events;
+class Glicko2_numa;
+class Glicko2_population_impl;
+
+
+
+/**
+ * Population of players rated together, one rating period at a time.
+ *
+ * Players are identified by the dense index AddPlayer() returns.  Results are
+ * recorded during a rating period with AddResult() or AddMatch(), and applied to
+ * every player at once by Update(), which closes the period.  As with Glicko2,
+ * every player's new rating is computed from its opponents' ratings as they
+ * were at the start of the period, and players without results are unchanged.
+ *
+ * Ratings are held column by column rather than player by player, so an update
+ * streams through contiguous arrays and can be split across threads.  The
+ * columns, and the results grouped for an update, use Glicko2_huge_allocator.
+ *
+ * Players are kept in one of two tiers.  Active players are in the hot tier,
+ * at full precision.  Demote() moves players who have not played for a given
+ * number of periods to the cold tier, where they are stored quantized and
+ * compressed in blocks, taking a fraction of the space.  Cold players can
+ * still be queried, which decodes them on demand, and are moved back to the
+ * hot tier as soon as a result is added for them.  Quantization keeps ratings
+ * and deviations to within 1/64 of a Glicko point.
+ *
+ * The hot tier keeps two epochs of ratings: the committed one, and the one
+ * before it.  An update writes its results into the older epoch and commits by
+ * swapping the two, so the last closed period can be undone with Rollback()
+ * at no cost.  Since the committed epoch is never written during an update,
+ * other threads may call GetRating(), GetDeviation(), GetVolatility(),
+ * GetState(), GetStates(), GetLastActive(), GetPeriod() and GetVersion() while
+ * Update() runs, and see the previous period's ratings until it commits.  Such
+ * a query must finish before the next Update() starts, which brings the epoch
+ * it reads up to date.  No other call may run concurrently with anything.
+ *
+ * GetIndex() is a map from the caller's own player ids to player indices, for
+ * callers who do not keep one themselves; the population does not use it.
+ */
+class Glicko2_population
+{
+	public:
+
+
+
+		/**
+		 * Constructor.  Creates an empty population in rating period 0.
+		 */
+		Glicko2_population();
+
+		/**
+		 * Destructor.
+		 */
+		~Glicko2_population();
+
+
+
+		/**
+		 * Add a player with a rating of 1500, a rating deviation of 350, and a
+		 * volatility of 0.06.
+		 *
+		 * @return Index of the new player.
+		 */
+		unsigned int AddPlayer();
+
+		/**
+		 * Add a player with rating, rating deviation, and volatility specified.
+		 *
+		 * @param rating     Initial Glicko rating.
+		 * @param deviation  Initial Glicko rating deviation.
+		 * @param volatility Initial volatility.
+		 *
+		 * @return Index of the new player.
+		 */
+		unsigned int AddPlayer(double rating, double deviation, double volatility);
+
+		/**
+		 * @return Number of players, in both tiers.
+		 */
+		unsigned int GetPlayerCount() const;
+
+		/**
+		 * Get the map from external player ids to player indices.  Ids are
+		 * added by the caller, typically right after AddPlayer().
+		 *
+		 * @return The index.
+		 */
+		Glicko2_index& GetIndex();
+
+		/**
+		 * Get the map from external player ids to player indices.
+		 *
+		 * @return The index.
+		 */
+		const Glicko2_index& GetIndex() const;
+
+
+
+		/**
+		 * Get a player's Glicko rating.
+		 *
+		 * @param player Player index.
+		 *
+		 * @return
+		 */
+		double GetRating(unsigned int player) const;
+
+		/**
+		 * Get a player's Glicko rating deviation.
+		 *
+		 * @param player Player index.
+		 *
+		 * @return
+		 */
+		double GetDeviation(unsigned int player) const;
+
+		/**
+		 * Get a player's rating volatility.
+		 *
+		 * @param player Player index.
+		 *
+		 * @return
+		 */
+		double GetVolatility(unsigned int player) const;
+
+		/**
+		 * Get a player's complete rating state, on the Glicko-2 scale.
+		 *
+		 * @param player Player index.
+		 *
+		 * @return Rating state.
+		 */
+		Glicko2_rating GetState(unsigned int player) const;
+
+		/**
+		 * Set a player's complete rating state, on the Glicko-2 scale.  Moves a
+		 * cold player to the hot tier.
+		 *
+		 * @param player Player index.
+		 * @param state  Rating state.
+		 */
+		void SetState(unsigned int player, const Glicko2_rating& state);
+
+		/**
+		 * Set a player's complete rating state and last active period, as when
+		 * restoring a saved population.
+		 *
+		 * @param player      Player index.
+		 * @param state       Rating state.
+		 * @param last_active Last rating period with a result.
+		 */
+		void SetState(unsigned int player, const Glicko2_rating& state, unsigned int last_active);
+
+		/**
+		 * Get the rating states of many players at once.  Cold players are
+		 * decoded a block at a time, rather than a block per player as
+		 * GetState() does.
+		 *
+		 * @param players     Player indices.
+		 * @param count       Number of players.
+		 * @param states      Receives each player's rating state.
+		 * @param last_active Receives each player's last active period.
+		 */
+		void GetStates(const unsigned int* players, std::size_t count, Glicko2_rating* states, unsigned int* last_active) const;
+
+		/**
+		 * Get the last rating period in which a player had a result, or in which
+		 * the player was added if it has had none.
+		 *
+		 * @param player Player index.
+		 *
+		 * @return Rating period.
+		 */
+		unsigned int GetLastActive(unsigned int player) const;
+
+		/**
+		 * Get the version of the population's rating states.  It changes with
+		 * every call that changes any player's state or last active period:
+		 * AddPlayer(), SetState(), Update() (EndUpdate()), Rollback(), Demote()
+		 * (cold players are quantized), and ReadArrow().
+		 *
+		 * @return Version.
+		 */
+		unsigned int GetVersion() const;
+
+		/**
+		 * Get the players whose rating state or last active period may have
+		 * changed since a version, as GetVersion() returned it.  Any number of
+		 * callers can follow changes this way, each keeping its own version.
+		 *
+		 * @param version Version.
+		 * @param players Receives the players, in ascending order.
+		 */
+		void GetChangedSince(unsigned int version, std::vector<unsigned int>& players) const;
+
+		/**
+		 * Publish an event for every player whose state EndUpdate() or Rollback()
+		 * changes, with its state before and after, from the thread calling
+		 * them.  Other changes, such as SetState(), are not published.
+		 *
+		 * @param events Ring to publish to, or 0 for none.  Not owned.
+		 */
+		void SetEvents(Glicko2_events* events);
+
+
+
+		/**
+		 * Add a result for one player.  Note that no calculation is performed
+		 * until Update() is called.
+		 *
+		 * @param player   Player the result is for.
+		 * @param opponent Other player in contest.
+		 * @param score    1.0 for a win, 0.0 for a loss, 0.5 for a draw, from
+		 *                 the point of view of player.
+		 */
+		void AddResult(unsigned int player, unsigned int opponent, double score);
+
+		/**
+		 * Add a result for both players in a contest.  Note that no calculation is
+		 * performed until Update() is called.
+		 *
+		 * @param player   One player in contest.
+		 * @param opponent Other player in contest.
+		 * @param result   WIN, LOSS, or DRAW; from the point of view of player.
+		 */
+		void AddMatch(unsigned int player, unsigned int opponent, Glicko2::RESULT result);
+
+		/**
+		 * @return Number of results added in the current rating period, counting
+		 *         a match as two.
+		 */
+		std::size_t GetResultCount() const;
+
+
+
+		/**
+		 * Close the rating period: update every player with results, clear all
+		 * results, and advance to the next period.
+		 *
+		 * @param threads Number of threads to split the update across.
+		 */
+		void Update(unsigned int threads = 1);
+
+		/**
+		 * Update() across the nodes of a NUMA machine.  The hot tier is split
+		 * into one range of players per node; each range's columns, and its
+		 * opponents' ratings as gathered for the period, are moved to its node,
+		 * and updated by threads pinned to that node.  Every opponent read
+		 * across nodes happens in the one gathering pass, so the update itself
+		 * only touches memory on its own node.  The results are the same as
+		 * those of Update().
+		 *
+		 * @param numa             Topology; on a single node this is Update().
+		 * @param threads_per_node Number of threads per node.
+		 */
+		void Update(const Glicko2_numa& numa, unsigned int threads_per_node = 1);
+
+		/**
+		 * First step of Update(), for callers running the update on their own
+		 * threads: group the period's results by player.
+		 */
+		void BeginUpdate();
+
+		/**
+		 * Get the number of work items between BeginUpdate() and EndUpdate().
+		 *
+		 * @return Work item count; items are numbered from 0.
+		 */
+		unsigned int GetUpdateSize() const;
+
+		/**
+		 * Second step of Update(): update the players in a range of work items.
+		 * Disjoint ranges may be run concurrently on different threads.
+		 *
+		 * @param begin First work item.
+		 * @param end   One past the last work item.
+		 */
+		void UpdateRange(unsigned int begin, unsigned int end);
+
+		/**
+		 * Last step of Update(), once every work item is done: clear all results
+		 * and advance to the next period.
+		 */
+		void EndUpdate();
+
+		/**
+		 * Set the volatility freeze of this population's updates.  When
+		 * non-zero, a player's volatility iteration is skipped, and the
+		 * volatility kept as it is, whenever Glicko2_math::IsVolatilityFrozen()
+		 * shows it would change by less than this; otherwise it is solved as
+		 * usual.  Established players nearly always skip it.
+		 *
+		 * @param freeze Largest change in volatility that may be ignored; 0, the
+		 *               default, always solves.
+		 */
+		void SetVolatilityFreeze(double freeze);
+
+		/**
+		 * @return Volatility freeze, as set by SetVolatilityFreeze().
+		 */
+		double GetVolatilityFreeze() const;
+
+		/**
+		 * @return Number of player updates that skipped the volatility
+		 *         iteration, over the life of the population.
+		 */
+		std::uint64_t GetFrozenCount() const;
+
+		/**
+		 * @return Number of player updates that ran the volatility iteration,
+		 *         over the life of the population.
+		 */
+		std::uint64_t GetSolvedCount() const;
+
+		/**
+		 * @return Current rating period, the number of times Update() has been
+		 *         called.
+		 */
+		unsigned int GetPeriod() const;
+
+		/**
+		 * Set the current rating period, as when restoring a saved population.
+		 * Fails while there are results for the current period.  Disables
+		 * Rollback().
+		 *
+		 * @param period Rating period.
+		 *
+		 * @return false if there are results.
+		 */
+		bool SetPeriod(unsigned int period);
+
+		/**
+		 * Undo the last Update(), restoring every player's rating state as it
+		 * was before it and reopening that rating period, with no results.  Only
+		 * one period can be undone, and not once results have been added to the
+		 * next one or Demote() has been called.  SetState() is not undone.
+		 *
+		 * @return true if the period was undone.
+		 */
+		bool Rollback();
+
+		/**
+		 * @return true if Rollback() would succeed.
+		 */
+		bool CanRollback() const;
+
+
+
+		/**
+		 * Move players who have had no results in the last inactive_periods
+		 * closed rating periods to the cold tier.  Players with results pending
+		 * in the current period are never moved.
+		 *
+		 * @param inactive_periods Closed periods without a result before a player
+		 *                         is moved.
+		 *
+		 * @return Number of players moved.
+		 */
+		unsigned int Demote(unsigned int inactive_periods);
+
+		/**
+		 * @param player Player index.
+		 *
+		 * @return true if the player is in the cold tier.
+		 */
+		bool IsCold(unsigned int player) const;
+
+		/**
+		 * @return Number of players in the hot tier.
+		 */
+		unsigned int GetHotCount() const;
+
+		/**
+		 * @return Number of players in the cold tier.
+		 */
+		unsigned int GetColdCount() const;
+
+		/**
+		 * @return Bytes of encoded cold tier data.
+		 */
+		std::size_t GetColdBytes() const;
+
+
+
+		/**
+		 * Export every player to an Arrow IPC file, with columns player (the
+		 * player index, UINT32), rating, deviation and volatility (DOUBLE, on the
+		 * Glicko-2 scale, as in Glicko2_rating), and last_active (UINT32).  The
+		 * hot tier is written as one record batch straight from its columns, in
+		 * hot slot rather than player order; cold players follow, decoded.  The
+		 * index's external ids are not written.
+		 *
+		 * @param path Path of the file.
+		 *
+		 * @return false on a file error.
+		 */
+		bool WriteArrow(const char* path) const;
+
+		/**
+		 * Import players from an Arrow IPC file with the columns WriteArrow()
+		 * writes.  Each player in the file is set to its state and last active
+		 * period there, as with SetState(); players not yet in the population
+		 * are added first, up to the highest player index in the file.  The
+		 * whole file is checked before any player is changed, so on failure the
+		 * population is as it was.  The file does not hold the rating period,
+		 * which is left as it is; restore it with SetPeriod().
+		 *
+		 * @param path Path of the file.
+		 *
+		 * @return false on a file error, if a column is missing or of the wrong
+		 *         type, or if a player index is beyond both the population and
+		 *         the number of rows in the file.
+		 */
+		bool ReadArrow(const char* path);
+
+
+
+	private:
+
+		Glicko2_population(const Glicko2_population&);
+		Glicko2_population& operator=(const Glicko2_population&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_population_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_population_h__
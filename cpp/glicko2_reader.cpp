@@ -0,0 +1,576 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_reader.h"
+#include "glicko2_trace.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GLICKO2_HAVE_PREAD
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define GLICKO2_HAVE_IO_URING
+#endif
+#endif
+#endif
+
+
+
+#ifdef GLICKO2_HAVE_IO_URING
+namespace
+{
+	// Minimal io_uring: one submission and one completion ring, mapped from
+	// the kernel, used through the raw system calls so no library is needed.
+	class Ring
+	{
+		public:
+
+			Ring() : fd(-1), sq_ring(MAP_FAILED), cq_ring(MAP_FAILED), sqes(0), sq_ring_size(0), cq_ring_size(0), sqes_size(0) {}
+			~Ring() { Destroy(); }
+
+			bool Create(unsigned int entries)
+			{
+				io_uring_params params;
+				std::memset(&params,0,sizeof(params));
+				fd = (int)syscall(__NR_io_uring_setup,entries,&params);
+				if ( fd < 0 )
+				{
+					return false;
+				}
+
+				sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+				cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+				sqes_size    = params.sq_entries * sizeof(io_uring_sqe);
+
+				// newer kernels map both rings at once
+				bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+				if ( single )
+				{
+					sq_ring_size = cq_ring_size = sq_ring_size > cq_ring_size ? sq_ring_size : cq_ring_size;
+				}
+
+				sq_ring = mmap(0,sq_ring_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,fd,IORING_OFF_SQ_RING);
+				cq_ring = single ? sq_ring : mmap(0,cq_ring_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,fd,IORING_OFF_CQ_RING);
+				void* s = mmap(0,sqes_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,fd,IORING_OFF_SQES);
+				if ( sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || s == MAP_FAILED )
+				{
+					if ( s != MAP_FAILED )
+					{
+						munmap(s,sqes_size);
+					}
+					Destroy();
+					return false;
+				}
+				sqes = static_cast<io_uring_sqe*>(s);
+
+				char* sq = static_cast<char*>(sq_ring);
+				sq_tail  = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+				sq_mask  = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+				sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+
+				char* cq = static_cast<char*>(cq_ring);
+				cq_head  = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+				cq_tail  = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+				cq_mask  = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+				cqes     = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+				return true;
+			}
+
+			void Destroy()
+			{
+				if ( sqes )
+				{
+					munmap(sqes,sqes_size);
+				}
+				if ( cq_ring != MAP_FAILED && cq_ring != sq_ring )
+				{
+					munmap(cq_ring,cq_ring_size);
+				}
+				if ( sq_ring != MAP_FAILED )
+				{
+					munmap(sq_ring,sq_ring_size);
+				}
+				if ( fd >= 0 )
+				{
+					close(fd);
+				}
+				fd      = -1;
+				sq_ring = MAP_FAILED;
+				cq_ring = MAP_FAILED;
+				sqes    = 0;
+			}
+
+			// queue and submit one read; readv rather than read works on the
+			// oldest kernels with io_uring, and the vector must outlive the read
+			bool Read(int file, const iovec* vector, std::uint64_t offset, std::uint64_t tag)
+			{
+				unsigned int  tail  = __atomic_load_n(sq_tail,__ATOMIC_RELAXED);
+				unsigned int  index = tail & sq_mask;
+				io_uring_sqe& sqe   = sqes[index];
+
+				std::memset(&sqe,0,sizeof(sqe));
+				sqe.opcode    = IORING_OP_READV;
+				sqe.fd        = file;
+				sqe.addr      = (std::uint64_t)(std::uintptr_t)vector;
+				sqe.len       = 1;
+				sqe.off       = offset;
+				sqe.user_data = tag;
+
+				sq_array[index] = index;
+				__atomic_store_n(sq_tail,tail + 1,__ATOMIC_RELEASE);
+
+				// a signal or a short lived lack of kernel resources is retried;
+				// the latter only so often, before the read fails
+				for ( unsigned int busy=0;; )
+				{
+					long submitted = syscall(__NR_io_uring_enter,fd,1,0,0,(void*)0,(std::size_t)0);
+					if ( submitted >= 0 )
+					{
+						return submitted == 1;
+					}
+					if ( errno == EINTR )
+					{
+						continue;
+					}
+					if ( (errno != EAGAIN && errno != EBUSY) || ++busy > 100 )
+					{
+						return false;
+					}
+					sched_yield();
+				}
+			}
+
+			// wait for one completion
+			bool Wait(std::uint64_t& tag, int& result)
+			{
+				unsigned int head = __atomic_load_n(cq_head,__ATOMIC_RELAXED);
+				while ( head == __atomic_load_n(cq_tail,__ATOMIC_ACQUIRE) )
+				{
+					if ( syscall(__NR_io_uring_enter,fd,0,1,IORING_ENTER_GETEVENTS,(void*)0,(std::size_t)0) < 0 && errno != EINTR )
+					{
+						return false;
+					}
+				}
+
+				const io_uring_cqe& cqe = cqes[head & cq_mask];
+				tag    = cqe.user_data;
+				result = cqe.res;
+				__atomic_store_n(cq_head,head + 1,__ATOMIC_RELEASE);
+				return true;
+			}
+
+		private:
+
+			Ring(const Ring&);
+			Ring& operator=(const Ring&);
+
+			int           fd;
+			void*         sq_ring;
+			void*         cq_ring;
+			io_uring_sqe* sqes;
+			std::size_t   sq_ring_size;
+			std::size_t   cq_ring_size;
+			std::size_t   sqes_size;
+			unsigned int* sq_tail;
+			unsigned int  sq_mask;
+			unsigned int* sq_array;
+			unsigned int* cq_head;
+			unsigned int* cq_tail;
+			unsigned int  cq_mask;
+			io_uring_cqe* cqes;
+	};
+}
+#endif
+
+
+
+class Glicko2_reader_impl
+{
+	public:
+
+		Glicko2_reader_impl(std::size_t chunk_size, unsigned int depth);
+
+		std::size_t  chunk_size;
+		unsigned int depth;
+
+		// one buffer per chunk in flight; chunk n is read into buffer n % depth
+		std::vector<char>          memory;
+		std::vector<std::size_t>   filled;
+		std::vector<unsigned char> done;
+
+#ifdef GLICKO2_HAVE_PREAD
+		int        file;
+#else
+		std::FILE* file;
+#endif
+		std::uint64_t file_size;
+		std::uint64_t chunk_count;
+		std::uint64_t submitted;
+		std::uint64_t delivered;
+		bool          handed_out;
+		bool          failed;
+
+#ifdef GLICKO2_HAVE_IO_URING
+		Ring               ring;
+		std::vector<iovec> vectors;
+		bool               async;
+		int                in_flight;
+
+		// queue the next chunk not yet queued, if any
+		void Submit();
+
+		// wait for a completion and record it
+		bool Reap();
+#endif
+
+		char* Buffer(std::uint64_t chunk) { return &memory[0] + (std::size_t)(chunk % depth) * chunk_size; }
+
+		std::size_t ChunkBytes(std::uint64_t chunk) const
+		{
+			std::uint64_t begin = chunk * chunk_size;
+			return (std::size_t)(file_size - begin < chunk_size ? file_size - begin : chunk_size);
+		}
+
+		// read a chunk synchronously
+		bool ReadNow(std::uint64_t chunk);
+};
+
+
+
+Glicko2_reader_impl::Glicko2_reader_impl(std::size_t chunk_size, unsigned int depth) :
+	chunk_size(chunk_size > 0 ? chunk_size : 1),
+	depth(depth > 0 ? depth : 1),
+#ifdef GLICKO2_HAVE_PREAD
+	file(-1),
+#else
+	file(0),
+#endif
+	file_size(0),
+	chunk_count(0),
+	submitted(0),
+	delivered(0),
+	handed_out(false),
+	failed(false)
+#ifdef GLICKO2_HAVE_IO_URING
+	,async(false),
+	in_flight(0)
+#endif
+{
+}
+
+
+
+#ifdef GLICKO2_HAVE_IO_URING
+void Glicko2_reader_impl::Submit()
+{
+	if ( submitted >= chunk_count || failed )
+	{
+		return;
+	}
+
+	unsigned int slot = (unsigned int)(submitted % depth);
+	filled[slot] = 0;
+	done[slot]   = 0;
+	vectors[slot].iov_base = Buffer(submitted);
+	vectors[slot].iov_len  = ChunkBytes(submitted);
+	if ( !ring.Read(file,&vectors[slot],submitted * chunk_size,submitted) )
+	{
+		failed = true;
+		return;
+	}
+	submitted++;
+	in_flight++;
+}
+
+
+
+bool Glicko2_reader_impl::Reap()
+{
+	std::uint64_t chunk  = 0;
+	int           result = 0;
+	if ( !ring.Wait(chunk,result) )
+	{
+		failed = true;
+		return false;
+	}
+	in_flight--;
+
+	unsigned int slot = (unsigned int)(chunk % depth);
+	if ( result <= 0 )
+	{
+		failed = true;
+		return false;
+	}
+
+	// regular files only read short at the end, but finish the chunk if not
+	filled[slot] += (std::size_t)result;
+	if ( filled[slot] < ChunkBytes(chunk) )
+	{
+		vectors[slot].iov_base = Buffer(chunk) + filled[slot];
+		vectors[slot].iov_len  = ChunkBytes(chunk) - filled[slot];
+		if ( !ring.Read(file,&vectors[slot],chunk * chunk_size + filled[slot],chunk) )
+		{
+			failed = true;
+			return false;
+		}
+		in_flight++;
+		return true;
+	}
+
+	done[slot] = 1;
+	return true;
+}
+#endif
+
+
+
+bool Glicko2_reader_impl::ReadNow(std::uint64_t chunk)
+{
+	char*       buffer = Buffer(chunk);
+	std::size_t size   = ChunkBytes(chunk);
+	std::size_t got    = 0;
+	while ( got < size )
+	{
+#ifdef GLICKO2_HAVE_PREAD
+		ssize_t n = pread(file,buffer + got,size - got,(off_t)(chunk * chunk_size + got));
+#else
+		long   n = std::fseek(file,(long)(chunk * chunk_size + got),SEEK_SET) == 0 ? (long)std::fread(buffer + got,1,size - got,file) : -1;
+#endif
+		if ( n <= 0 )
+		{
+			failed = true;
+			return false;
+		}
+		got += (std::size_t)n;
+	}
+
+	filled[(std::size_t)(chunk % depth)] = got;
+	return true;
+}
+
+
+
+
+
+
+Glicko2_reader::Glicko2_reader(std::size_t chunk_size, unsigned int depth) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_reader_impl(chunk_size,depth);
+}
+
+
+
+Glicko2_reader::~Glicko2_reader()
+{
+	Close();
+	delete pimpl;
+}
+
+
+
+bool Glicko2_reader::Open(const char* path, bool async)
+{
+	Close();
+
+	Glicko2_reader_impl& p = *pimpl;
+#ifdef GLICKO2_HAVE_PREAD
+	p.file = open(path,O_RDONLY);
+	struct stat status;
+	if ( p.file < 0 || fstat(p.file,&status) != 0 )
+	{
+		Close();
+		return false;
+	}
+	p.file_size = (std::uint64_t)status.st_size;
+#else
+	p.file = std::fopen(path,"rb");
+	if ( p.file == 0 || std::fseek(p.file,0,SEEK_END) != 0 )
+	{
+		Close();
+		return false;
+	}
+	p.file_size = (std::uint64_t)std::ftell(p.file);
+#endif
+
+	p.chunk_count = (p.file_size + p.chunk_size - 1) / p.chunk_size;
+	p.memory.resize(p.chunk_size * p.depth);
+	p.filled.assign(p.depth,0);
+	p.done.assign(p.depth,0);
+
+#ifdef GLICKO2_HAVE_IO_URING
+	// fall back to pread() if the kernel refuses
+	p.vectors.resize(p.depth);
+	p.async = async && p.ring.Create(p.depth);
+	if ( p.async )
+	{
+		while ( p.submitted < p.chunk_count && p.submitted < p.depth )
+		{
+			p.Submit();
+		}
+	}
+#else
+	(void)async;
+#endif
+
+	return true;
+}
+
+
+
+void Glicko2_reader::Close()
+{
+	Glicko2_reader_impl& p = *pimpl;
+
+#ifdef GLICKO2_HAVE_IO_URING
+	// the kernel may still be writing into the buffers
+	while ( p.async && p.in_flight > 0 )
+	{
+		std::uint64_t chunk  = 0;
+		int           result = 0;
+		if ( !p.ring.Wait(chunk,result) )
+		{
+			break;
+		}
+		p.in_flight--;
+	}
+	p.ring.Destroy();
+	p.async     = false;
+	p.in_flight = 0;
+#endif
+
+#ifdef GLICKO2_HAVE_PREAD
+	if ( p.file >= 0 )
+	{
+		close(p.file);
+	}
+	p.file = -1;
+#else
+	if ( p.file )
+	{
+		std::fclose(p.file);
+	}
+	p.file = 0;
+#endif
+
+	p.file_size   = 0;
+	p.chunk_count = 0;
+	p.submitted   = 0;
+	p.delivered   = 0;
+	p.handed_out  = false;
+	p.failed      = false;
+}
+
+
+
+bool Glicko2_reader::Next(const char*& data, std::size_t& size)
+{
+	GLICKO2_TRACE_SCOPE(INGEST);
+
+	Glicko2_reader_impl& p = *pimpl;
+
+	// the caller is done with the last chunk, so its buffer can be refilled
+	if ( p.handed_out )
+	{
+		p.handed_out = false;
+		p.delivered++;
+#ifdef GLICKO2_HAVE_IO_URING
+		if ( p.async )
+		{
+			p.Submit();
+		}
+#endif
+	}
+
+	if ( p.failed || p.delivered >= p.chunk_count )
+	{
+		return false;
+	}
+
+	unsigned int slot = (unsigned int)(p.delivered % p.depth);
+#ifdef GLICKO2_HAVE_IO_URING
+	if ( p.async )
+	{
+		while ( !p.done[slot] )
+		{
+			if ( !p.Reap() )
+			{
+				return false;
+			}
+		}
+	}
+	else
+#endif
+	if ( !p.ReadNow(p.delivered) )
+	{
+		return false;
+	}
+
+	data         = p.Buffer(p.delivered);
+	size         = p.filled[slot];
+	p.handed_out = true;
+	return true;
+}
+
+
+
+bool Glicko2_reader::IsAsync() const
+{
+#ifdef GLICKO2_HAVE_IO_URING
+	return pimpl->async;
+#else
+	return false;
+#endif
+}
+
+
+
+bool Glicko2_reader::IsFailed() const
+{
+	return pimpl->failed;
+}
+
+
+
+std::uint64_t Glicko2_reader::GetFileSize() const
+{
+	return pimpl->file_size;
+}
@@ -0,0 +1,131 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_reader_h__
+#define __glicko2_reader_h__
+
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+
+class Glicko2_reader_impl;
+
+
+
+/**
+ * Sequential file reader that keeps several large reads in flight.
+ *
+ * The file is read in fixed size chunks, each into a buffer of its own, and
+ * handed out in file order by Next().  On Linux the reads are queued with
+ * io_uring, so the next chunks are already loading while the caller decodes
+ * the current one.  Where io_uring is not available, at build time or at run
+ * time (old kernels, or sandboxes that forbid it), each chunk is read with
+ * pread() when asked for instead.
+ */
+class Glicko2_reader
+{
+	public:
+
+
+
+		/**
+		 * Constructor.
+		 *
+		 * @param chunk_size Bytes per read.
+		 * @param depth      Number of chunks read ahead, and buffers held.
+		 */
+		Glicko2_reader(std::size_t chunk_size = 1 << 20, unsigned int depth = 4);
+
+		/**
+		 * Destructor.  Closes the file, waiting for reads in flight.
+		 */
+		~Glicko2_reader();
+
+
+
+		/**
+		 * Open a file and start reading it.  Closes any file already open.
+		 *
+		 * @param path  Path of the file.
+		 * @param async false to read with pread() even where io_uring works.
+		 *
+		 * @return false if the file could not be opened.
+		 */
+		bool Open(const char* path, bool async = true);
+
+		/**
+		 * Close the file, waiting for reads in flight.
+		 */
+		void Close();
+
+		/**
+		 * Get the next chunk of the file.  The chunk stays valid until the next
+		 * call to Next() or Close(), when its buffer is reused.
+		 *
+		 * @param data Receives the chunk.
+		 * @param size Receives its size; only the last chunk may be short.
+		 *
+		 * @return false at the end of the file or on a read error.
+		 */
+		bool Next(const char*& data, std::size_t& size);
+
+
+
+		/**
+		 * @return true if reads are going through io_uring.
+		 */
+		bool IsAsync() const;
+
+		/**
+		 * @return true if a read failed.
+		 */
+		bool IsFailed() const;
+
+		/**
+		 * @return Size of the open file in bytes.
+		 */
+		std::uint64_t GetFileSize() const;
+
+
+
+	private:
+
+		Glicko2_reader(const Glicko2_reader&);
+		Glicko2_reader& operator=(const Glicko2_reader&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_reader_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_reader_h__
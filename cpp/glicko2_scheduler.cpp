@@ -0,0 +1,379 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_scheduler.h"
+#include "glicko2_population.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+
+namespace
+{
+	// a population, and the state of its last update
+	struct Pool
+	{
+		Glicko2_population* population;
+		bool                pending;
+
+		// chunks of a split update not yet done
+		unsigned int remaining;
+	};
+
+
+
+	// a whole pool's update not yet begun, or a chunk of one split
+	struct Task
+	{
+		std::uint64_t deadline;
+		std::uint64_t sequence;
+		Pool*         pool;
+		bool          whole;
+		unsigned int  begin;
+		unsigned int  end;
+	};
+
+	// orders the queue earliest deadline first, then in submission order
+	struct Later
+	{
+		bool operator()(const Task& a, const Task& b) const
+		{
+			return a.deadline != b.deadline ? a.deadline > b.deadline : a.sequence > b.sequence;
+		}
+	};
+}
+
+
+
+class Glicko2_scheduler_impl
+{
+	public:
+
+		unsigned int             grain;
+		std::vector<std::thread> workers;
+
+		// everything below is guarded by mutex
+		std::mutex                                        mutex;
+		std::condition_variable                           wake;
+		std::condition_variable                           done;
+		std::deque<Pool>                                  pools;
+		std::priority_queue<Task,std::vector<Task>,Later> queue;
+		std::uint64_t                                     sequence;
+		bool                                              stop;
+
+		std::uint64_t updates;
+		std::uint64_t batched;
+		std::uint64_t splits;
+
+		// a worker's loop, until stopped with nothing left to run
+		void Work();
+
+		// run a pool whose update is too large to run whole
+		void Split(std::unique_lock<std::mutex>& lock, const Task& task);
+
+		// run a chunk of a split update, and end the update after its last
+		void RunChunk(std::unique_lock<std::mutex>& lock, const Task& task);
+
+		// mark a pool's update finished
+		void Finish(Pool& pool);
+};
+
+
+
+void Glicko2_scheduler_impl::Work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	std::vector<Pool*>           batch;
+	for ( ;; )
+	{
+		while ( queue.empty() && !stop )
+		{
+			wake.wait(lock);
+		}
+		if ( queue.empty() )
+		{
+			return;
+		}
+
+		Task task = queue.top();
+		queue.pop();
+		if ( !task.whole )
+		{
+			RunChunk(lock,task);
+			continue;
+		}
+
+		std::size_t results = task.pool->population->GetResultCount();
+		if ( results > grain )
+		{
+			Split(lock,task);
+			continue;
+		}
+
+		// a small pool takes along the small pools due next, up to grain results
+		batch.assign(1,task.pool);
+		while ( !queue.empty() && queue.top().whole && results + queue.top().pool->population->GetResultCount() <= grain )
+		{
+			results += queue.top().pool->population->GetResultCount();
+			batch.push_back(queue.top().pool);
+			queue.pop();
+		}
+
+		lock.unlock();
+		for ( std::size_t i=0;i<batch.size();i++ )
+		{
+			batch[i]->population->Update(1);
+		}
+		lock.lock();
+
+		for ( std::size_t i=0;i<batch.size();i++ )
+		{
+			Finish(*batch[i]);
+		}
+		batched += batch.size() > 1 ? batch.size() : 0;
+	}
+}
+
+
+
+void Glicko2_scheduler_impl::Split(std::unique_lock<std::mutex>& lock, const Task& task)
+{
+	Glicko2_population& population = *task.pool->population;
+
+	lock.unlock();
+	population.BeginUpdate();
+	unsigned int size   = population.GetUpdateSize();
+	unsigned int chunks = size / grain + (size % grain != 0 ? 1 : 0);
+	if ( chunks <= 1 )
+	{
+		population.UpdateRange(0,size);
+		population.EndUpdate();
+		lock.lock();
+		Finish(*task.pool);
+		return;
+	}
+	lock.lock();
+
+	// the other chunks go to whichever workers are free, at the pool's place
+	// in the queue; this worker runs the first
+	task.pool->remaining = chunks;
+	for ( unsigned int c=1;c<chunks;c++ )
+	{
+		Task chunk  = task;
+		chunk.whole = false;
+		chunk.begin = c * grain;
+		chunk.end   = c + 1 < chunks ? (c + 1) * grain : size;
+		queue.push(chunk);
+	}
+	wake.notify_all();
+	splits++;
+
+	Task first  = task;
+	first.whole = false;
+	first.begin = 0;
+	first.end   = grain;
+	RunChunk(lock,first);
+}
+
+
+
+void Glicko2_scheduler_impl::RunChunk(std::unique_lock<std::mutex>& lock, const Task& task)
+{
+	Glicko2_population& population = *task.pool->population;
+
+	lock.unlock();
+	population.UpdateRange(task.begin,task.end);
+	lock.lock();
+
+	if ( --task.pool->remaining == 0 )
+	{
+		lock.unlock();
+		population.EndUpdate();
+		lock.lock();
+		Finish(*task.pool);
+	}
+}
+
+
+
+void Glicko2_scheduler_impl::Finish(Pool& pool)
+{
+	pool.pending = false;
+	updates++;
+	done.notify_all();
+}
+
+
+
+
+
+
+Glicko2_scheduler::Glicko2_scheduler(unsigned int threads, unsigned int grain) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_scheduler_impl;
+	pimpl->grain    = grain > 0 ? grain : 1;
+	pimpl->sequence = 0;
+	pimpl->stop     = false;
+	pimpl->updates  = 0;
+	pimpl->batched  = 0;
+	pimpl->splits   = 0;
+
+	if ( threads == 0 )
+	{
+		threads = std::thread::hardware_concurrency();
+		threads = threads > 0 ? threads : 1;
+	}
+	for ( unsigned int i=0;i<threads;i++ )
+	{
+		pimpl->workers.push_back(std::thread(&Glicko2_scheduler_impl::Work,pimpl));
+	}
+}
+
+
+
+Glicko2_scheduler::~Glicko2_scheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(pimpl->mutex);
+		pimpl->stop = true;
+	}
+	pimpl->wake.notify_all();
+	for ( unsigned int i=0;i<pimpl->workers.size();i++ )
+	{
+		pimpl->workers[i].join();
+	}
+	delete pimpl;
+}
+
+
+
+unsigned int Glicko2_scheduler::AddPool(Glicko2_population& population)
+{
+	std::lock_guard<std::mutex> lock(pimpl->mutex);
+
+	Pool pool;
+	pool.population = &population;
+	pool.pending    = false;
+	pool.remaining  = 0;
+	pimpl->pools.push_back(pool);
+	return (unsigned int)pimpl->pools.size() - 1;
+}
+
+
+
+unsigned int Glicko2_scheduler::GetPoolCount() const
+{
+	std::lock_guard<std::mutex> lock(pimpl->mutex);
+	return (unsigned int)pimpl->pools.size();
+}
+
+
+
+void Glicko2_scheduler::Submit(unsigned int pool, std::uint64_t deadline)
+{
+	Glicko2_scheduler_impl&      s = *pimpl;
+	std::unique_lock<std::mutex> lock(s.mutex);
+
+	Pool& p = s.pools[pool];
+	while ( p.pending )
+	{
+		s.done.wait(lock);
+	}
+	p.pending = true;
+
+	Task task;
+	task.deadline = deadline;
+	task.sequence = s.sequence++;
+	task.pool     = &p;
+	task.whole    = true;
+	task.begin    = 0;
+	task.end      = 0;
+	s.queue.push(task);
+	s.wake.notify_one();
+}
+
+
+
+bool Glicko2_scheduler::IsPending(unsigned int pool) const
+{
+	std::lock_guard<std::mutex> lock(pimpl->mutex);
+	return pimpl->pools[pool].pending;
+}
+
+
+
+void Glicko2_scheduler::Wait(unsigned int pool)
+{
+	std::unique_lock<std::mutex> lock(pimpl->mutex);
+	while ( pimpl->pools[pool].pending )
+	{
+		pimpl->done.wait(lock);
+	}
+}
+
+
+
+void Glicko2_scheduler::WaitAll()
+{
+	std::unique_lock<std::mutex> lock(pimpl->mutex);
+	for ( std::size_t i=0;i<pimpl->pools.size();i++ )
+	{
+		while ( pimpl->pools[i].pending )
+		{
+			pimpl->done.wait(lock);
+		}
+	}
+}
+
+
+
+std::uint64_t Glicko2_scheduler::GetUpdateCount() const
+{
+	std::lock_guard<std::mutex> lock(pimpl->mutex);
+	return pimpl->updates;
+}
+
+
+
+std::uint64_t Glicko2_scheduler::GetBatchedCount() const
+{
+	std::lock_guard<std::mutex> lock(pimpl->mutex);
+	return pimpl->batched;
+}
+
+
+
+std::uint64_t Glicko2_scheduler::GetSplitCount() const
+{
+	std::lock_guard<std::mutex> lock(pimpl->mutex);
+	return pimpl->splits;
+}
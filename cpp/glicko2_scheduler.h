@@ -0,0 +1,156 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_scheduler_h__
+#define __glicko2_scheduler_h__
+
+
+
+#include <cstdint>
+
+
+
+class Glicko2_population;
+class Glicko2_scheduler_impl;
+
+
+
+/**
+ * Runs the rating period updates of many independent populations, one per
+ * game or mode say, on one persistent pool of worker threads.
+ *
+ * Each population is added once as a pool, and its period closed with
+ * Submit() instead of Update().  Pending updates run earliest deadline first.
+ * A pool with few results is run whole by one worker, together with other
+ * small pools that are due, so that hundreds of tiny pools cost a handful of
+ * wake-ups rather than a thread each.  A pool with many results is split into
+ * chunks of work items, queued at the pool's deadline, so that every idle
+ * worker helps with it, and a pool due sooner still gets a worker between
+ * chunks.  The results are the same as those of Update().
+ */
+class Glicko2_scheduler
+{
+	public:
+
+
+
+		/**
+		 * Constructor.  Starts the workers.
+		 *
+		 * @param threads Number of worker threads, or 0 for one per hardware
+		 *                thread.
+		 * @param grain   Work items per chunk; pools with at most this many
+		 *                results are run whole, and batched together up to it.
+		 */
+		Glicko2_scheduler(unsigned int threads = 0, unsigned int grain = 4096);
+
+		/**
+		 * Destructor.  Finishes the pending updates, and stops the workers.
+		 */
+		~Glicko2_scheduler();
+
+
+
+		/**
+		 * Add a population to schedule.  Only the thread submitting its updates
+		 * may touch it, and only while it is not pending.
+		 *
+		 * @param population Population.  Not owned.
+		 *
+		 * @return Pool index; pools are numbered from 0.
+		 */
+		unsigned int AddPool(Glicko2_population& population);
+
+		/**
+		 * @return Number of pools.
+		 */
+		unsigned int GetPoolCount() const;
+
+
+
+		/**
+		 * Close a pool's rating period, as Update() would, on the workers.  If
+		 * the pool's last update is still pending, waits for it first.
+		 *
+		 * @param pool     Pool index.
+		 * @param deadline When the update is due, in any unit; updates with
+		 *                 earlier deadlines run first, ties in submission order.
+		 */
+		void Submit(unsigned int pool, std::uint64_t deadline);
+
+		/**
+		 * @param pool Pool index.
+		 *
+		 * @return true if the pool's last update has not finished.
+		 */
+		bool IsPending(unsigned int pool) const;
+
+		/**
+		 * Wait for a pool's last update to finish.
+		 *
+		 * @param pool Pool index.
+		 */
+		void Wait(unsigned int pool);
+
+		/**
+		 * Wait for every pending update to finish.
+		 */
+		void WaitAll();
+
+
+
+		/**
+		 * @return Number of updates finished.
+		 */
+		std::uint64_t GetUpdateCount() const;
+
+		/**
+		 * @return Number of updates run in a batch with at least one other.
+		 */
+		std::uint64_t GetBatchedCount() const;
+
+		/**
+		 * @return Number of updates split into more than one chunk.
+		 */
+		std::uint64_t GetSplitCount() const;
+
+
+
+	private:
+
+		Glicko2_scheduler(const Glicko2_scheduler&);
+		Glicko2_scheduler& operator=(const Glicko2_scheduler&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_scheduler_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_scheduler_h__
@@ -0,0 +1,534 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_snapshots.h"
+#include "glicko2_population.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+
+namespace
+{
+	const char snapshot_magic[8] = { 'G','L','I','C','K','O','2','S' };
+
+	enum KIND
+	{
+		BASE,
+		DELTA
+	};
+
+	// before each snapshot
+	struct Header
+	{
+		std::uint32_t kind;
+		std::uint32_t period;
+		std::uint32_t players;
+		std::uint32_t count;
+		std::uint64_t bytes;
+	};
+
+	// a snapshot in the log
+	struct Entry
+	{
+		Header header;
+		long   offset;
+	};
+
+
+
+	void PutVarint(std::vector<unsigned char>& out, std::uint64_t value)
+	{
+		while ( value >= 0x80 )
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+
+
+
+	bool GetVarint(const unsigned char*& in, const unsigned char* end, std::uint64_t& value)
+	{
+		value = 0;
+		for ( unsigned int shift=0;in<end && shift<64;shift+=7 )
+		{
+			unsigned char byte = *in++;
+			value |= (std::uint64_t)(byte & 0x7f) << shift;
+			if ( !(byte & 0x80) )
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+
+	std::uint64_t ZigZag(std::int64_t value)
+	{
+		return ((std::uint64_t)value << 1) ^ (std::uint64_t)(value >> 63);
+	}
+
+
+
+	std::int64_t UnZigZag(std::uint64_t value)
+	{
+		return (std::int64_t)(value >> 1) ^ -(std::int64_t)(value & 1);
+	}
+
+
+
+	std::uint64_t Bits(double value)
+	{
+		std::uint64_t bits;
+		std::memcpy(&bits,&value,sizeof(bits));
+		return bits;
+	}
+
+
+
+	double FromBits(std::uint64_t bits)
+	{
+		double value;
+		std::memcpy(&value,&bits,sizeof(value));
+		return value;
+	}
+
+
+
+	// every player's state, column by column; players not yet written are
+	// taken to have the default state, so new players cost little in a delta
+	class State
+	{
+		public:
+
+			std::vector<double>        rating;
+			std::vector<double>        deviation;
+			std::vector<double>        volatility;
+			std::vector<std::uint32_t> last_active;
+
+			unsigned int GetSize() const
+			{
+				return (unsigned int)rating.size();
+			}
+
+			void Resize(unsigned int players)
+			{
+				Glicko2_rating fresh = Glicko2_math::FromGlicko(1500.0,350.0,0.06);
+				rating.resize(players,fresh.rating);
+				deviation.resize(players,fresh.deviation);
+				volatility.resize(players,fresh.volatility);
+				last_active.resize(players,0);
+			}
+	};
+
+
+
+	// list the snapshots in a log, up to any truncated one at the end
+	bool Scan(std::FILE* file, std::vector<Entry>& entries)
+	{
+		char magic[8];
+		if ( std::fread(magic,1,8,file) != 8 || std::memcmp(magic,snapshot_magic,8) != 0 || std::fseek(file,0,SEEK_END) != 0 )
+		{
+			return false;
+		}
+
+		long size   = std::ftell(file);
+		long offset = 8;
+		while ( size - offset >= (long)sizeof(Header) )
+		{
+			Entry entry;
+			if ( std::fseek(file,offset,SEEK_SET) != 0 || std::fread(&entry.header,sizeof(Header),1,file) != 1 )
+			{
+				return false;
+			}
+			entry.offset = offset + (long)sizeof(Header);
+			if ( entry.header.bytes > (std::uint64_t)(size - entry.offset) )
+			{
+				break;
+			}
+			entries.push_back(entry);
+			offset = entry.offset + (long)entry.header.bytes;
+		}
+		return true;
+	}
+
+
+
+	// apply a snapshot to the state it was written against
+	bool Apply(std::FILE* file, const Entry& entry, State& state)
+	{
+		const Header& header = entry.header;
+		state.Resize(header.players);
+
+		std::vector<unsigned char> payload((std::size_t)header.bytes);
+		if ( std::fseek(file,entry.offset,SEEK_SET) != 0 || (!payload.empty() && std::fread(&payload[0],1,payload.size(),file) != payload.size()) )
+		{
+			return false;
+		}
+
+		const unsigned char* in  = payload.empty() ? 0 : &payload[0];
+		const unsigned char* end = in + payload.size();
+		if ( header.kind == BASE )
+		{
+			std::size_t n = header.players;
+			if ( header.count != header.players || payload.size() != n * (3 * sizeof(double) + sizeof(std::uint32_t)) )
+			{
+				return false;
+			}
+			if ( n > 0 )
+			{
+				std::memcpy(&state.rating[0],in,n * sizeof(double));
+				std::memcpy(&state.deviation[0],in + n * sizeof(double),n * sizeof(double));
+				std::memcpy(&state.volatility[0],in + 2 * n * sizeof(double),n * sizeof(double));
+				std::memcpy(&state.last_active[0],in + 3 * n * sizeof(double),n * sizeof(std::uint32_t));
+			}
+			return true;
+		}
+
+		std::uint64_t next = 0;
+		for ( unsigned int i=0;i<header.count;i++ )
+		{
+			std::uint64_t gap, rating, deviation, volatility, active;
+			if ( !GetVarint(in,end,gap) || !GetVarint(in,end,rating) || !GetVarint(in,end,deviation) || !GetVarint(in,end,volatility) || !GetVarint(in,end,active) )
+			{
+				return false;
+			}
+
+			std::uint64_t player = next + gap;
+			if ( player >= header.players )
+			{
+				return false;
+			}
+			state.rating[player]      = FromBits(Bits(state.rating[player]) ^ rating);
+			state.deviation[player]   = FromBits(Bits(state.deviation[player]) ^ deviation);
+			state.volatility[player]  = FromBits(Bits(state.volatility[player]) ^ volatility);
+			state.last_active[player] = (std::uint32_t)((std::int64_t)header.period - UnZigZag(active));
+			next = player + 1;
+		}
+		return in == end;
+	}
+}
+
+
+
+class Glicko2_snapshots_impl
+{
+	public:
+
+		std::FILE*    file;
+		unsigned int  base_interval;
+		std::uint64_t written;
+
+		// what the log holds after the last snapshot written
+		bool         has_base;
+		unsigned int base_period;
+		unsigned int last_period;
+		unsigned int version;
+		State        state;
+
+		bool WriteSnapshot(const Header& header, const void* payload)
+		{
+			bool ok = std::fwrite(&header,sizeof(header),1,file) == 1 &&
+			          (header.bytes == 0 || std::fwrite(payload,1,(std::size_t)header.bytes,file) == header.bytes) &&
+			          std::fflush(file) == 0;
+			written += sizeof(header) + header.bytes;
+			return ok;
+		}
+};
+
+
+
+
+
+
+Glicko2_snapshots::Glicko2_snapshots(const char* path, unsigned int base_interval) :
+	pimpl(0)
+{
+	pimpl = new Glicko2_snapshots_impl;
+	pimpl->file          = std::fopen(path,"r+b");
+	pimpl->base_interval = base_interval > 0 ? base_interval : 1;
+	pimpl->written       = 0;
+	pimpl->has_base      = false;
+	pimpl->base_period   = 0;
+	pimpl->last_period   = 0;
+	pimpl->version       = 0;
+
+	if ( pimpl->file == 0 )
+	{
+		pimpl->file = std::fopen(path,"w+b");
+	}
+	if ( pimpl->file == 0 )
+	{
+		return;
+	}
+
+	// a new log starts with its magic; an existing one is appended to after
+	// its last complete snapshot, cutting off any torn by a crash
+	bool ok  = std::fseek(pimpl->file,0,SEEK_END) == 0;
+	long end = std::ftell(pimpl->file);
+	if ( ok && end == 0 )
+	{
+		ok = std::fwrite(snapshot_magic,1,8,pimpl->file) == 8;
+	}
+	else if ( ok )
+	{
+		std::vector<Entry> entries;
+		ok = std::fseek(pimpl->file,0,SEEK_SET) == 0 && Scan(pimpl->file,entries);
+
+		long complete = entries.empty() ? 8 : entries.back().offset + (long)entries.back().header.bytes;
+		if ( ok && complete < end )
+		{
+			std::fflush(pimpl->file);
+#if defined(_WIN32)
+			ok = _chsize(_fileno(pimpl->file),complete) == 0;
+#else
+			ok = ftruncate(fileno(pimpl->file),(off_t)complete) == 0;
+#endif
+		}
+		ok = ok && std::fseek(pimpl->file,0,SEEK_END) == 0;
+	}
+
+	if ( !ok )
+	{
+		std::fclose(pimpl->file);
+		pimpl->file = 0;
+	}
+}
+
+
+
+Glicko2_snapshots::~Glicko2_snapshots()
+{
+	if ( pimpl->file != 0 )
+	{
+		std::fclose(pimpl->file);
+	}
+	delete pimpl;
+}
+
+
+
+bool Glicko2_snapshots::Write(const Glicko2_population& population)
+{
+	Glicko2_snapshots_impl& s = *pimpl;
+	if ( s.file == 0 )
+	{
+		return false;
+	}
+
+	Header header;
+	header.period  = population.GetPeriod();
+	header.players = population.GetPlayerCount();
+
+	unsigned int version = population.GetVersion();
+	bool         base    = !s.has_base || header.period < s.last_period || header.period - s.base_period >= s.base_interval;
+
+	std::vector<unsigned int> players;
+	if ( base )
+	{
+		players.resize(header.players);
+		for ( unsigned int i=0;i<header.players;i++ )
+		{
+			players[i] = i;
+		}
+	}
+	else
+	{
+		population.GetChangedSince(s.version,players);
+	}
+
+	std::vector<Glicko2_rating> states(players.size());
+	std::vector<unsigned int>   last_active(players.size());
+	if ( !players.empty() )
+	{
+		population.GetStates(&players[0],players.size(),&states[0],&last_active[0]);
+	}
+	s.state.Resize(header.players);
+
+	bool ok = true;
+	if ( base )
+	{
+		for ( std::size_t i=0;i<players.size();i++ )
+		{
+			s.state.rating[i]      = states[i].rating;
+			s.state.deviation[i]   = states[i].deviation;
+			s.state.volatility[i]  = states[i].volatility;
+			s.state.last_active[i] = last_active[i];
+		}
+
+		std::size_t                n = header.players;
+		std::vector<unsigned char> payload(n * (3 * sizeof(double) + sizeof(std::uint32_t)));
+		if ( n > 0 )
+		{
+			std::memcpy(&payload[0],&s.state.rating[0],n * sizeof(double));
+			std::memcpy(&payload[n * sizeof(double)],&s.state.deviation[0],n * sizeof(double));
+			std::memcpy(&payload[2 * n * sizeof(double)],&s.state.volatility[0],n * sizeof(double));
+			std::memcpy(&payload[3 * n * sizeof(double)],&s.state.last_active[0],n * sizeof(std::uint32_t));
+		}
+
+		header.kind  = BASE;
+		header.count = header.players;
+		header.bytes = payload.size();
+		ok = s.WriteSnapshot(header,payload.empty() ? 0 : &payload[0]);
+
+		s.has_base    = true;
+		s.base_period = header.period;
+	}
+	else
+	{
+		// players that really changed, against the state last written
+		std::vector<unsigned char> payload;
+		unsigned int               count = 0;
+		unsigned int               next  = 0;
+		for ( std::size_t i=0;i<players.size();i++ )
+		{
+			unsigned int  player     = players[i];
+			std::uint64_t rating     = Bits(s.state.rating[player]) ^ Bits(states[i].rating);
+			std::uint64_t deviation  = Bits(s.state.deviation[player]) ^ Bits(states[i].deviation);
+			std::uint64_t volatility = Bits(s.state.volatility[player]) ^ Bits(states[i].volatility);
+			if ( rating == 0 && deviation == 0 && volatility == 0 && s.state.last_active[player] == last_active[i] )
+			{
+				continue;
+			}
+
+			PutVarint(payload,player - next);
+			PutVarint(payload,rating);
+			PutVarint(payload,deviation);
+			PutVarint(payload,volatility);
+			PutVarint(payload,ZigZag((std::int64_t)header.period - (std::int64_t)last_active[i]));
+			next = player + 1;
+			count++;
+
+			s.state.rating[player]      = states[i].rating;
+			s.state.deviation[player]   = states[i].deviation;
+			s.state.volatility[player]  = states[i].volatility;
+			s.state.last_active[player] = last_active[i];
+		}
+
+		header.kind  = DELTA;
+		header.count = count;
+		header.bytes = payload.size();
+		ok = s.WriteSnapshot(header,payload.empty() ? 0 : &payload[0]);
+	}
+
+	s.last_period = header.period;
+	s.version     = version;
+	return ok;
+}
+
+
+
+std::uint64_t Glicko2_snapshots::GetBytesWritten() const
+{
+	return pimpl->written;
+}
+
+
+
+bool Glicko2_snapshots::GetPeriods(const char* path, std::vector<unsigned int>& periods)
+{
+	std::FILE* file = std::fopen(path,"rb");
+	if ( file == 0 )
+	{
+		return false;
+	}
+
+	std::vector<Entry> entries;
+	bool               ok = Scan(file,entries);
+	std::fclose(file);
+
+	periods.clear();
+	for ( std::size_t i=0;i<entries.size();i++ )
+	{
+		periods.push_back(entries[i].header.period);
+	}
+	return ok;
+}
+
+
+
+bool Glicko2_snapshots::Read(const char* path, unsigned int period, Glicko2_population& population)
+{
+	if ( population.GetPlayerCount() != 0 )
+	{
+		return false;
+	}
+
+	std::FILE* file = std::fopen(path,"rb");
+	if ( file == 0 )
+	{
+		return false;
+	}
+
+	std::vector<Entry> entries;
+	bool               ok = Scan(file,entries);
+
+	// the last base at or before the period, and the deltas after it
+	std::size_t base = entries.size();
+	for ( std::size_t i=0;ok && i<entries.size();i++ )
+	{
+		if ( entries[i].header.kind == BASE && entries[i].header.period <= period )
+		{
+			base = i;
+		}
+	}
+	ok = ok && base < entries.size();
+
+	State        state;
+	unsigned int last = 0;
+	for ( std::size_t i=base;ok && i<entries.size() && entries[i].header.period <= period;i++ )
+	{
+		ok   = Apply(file,entries[i],state);
+		last = entries[i].header.period;
+	}
+	std::fclose(file);
+
+	if ( !ok )
+	{
+		return false;
+	}
+
+	for ( unsigned int i=0;i<state.GetSize();i++ )
+	{
+		Glicko2_rating rating;
+		rating.rating     = state.rating[i];
+		rating.deviation  = state.deviation[i];
+		rating.volatility = state.volatility[i];
+		population.SetState(population.AddPlayer(),rating,state.last_active[i]);
+	}
+	population.SetPeriod(last);
+	return true;
+}
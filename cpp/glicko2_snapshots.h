@@ -0,0 +1,141 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_snapshots_h__
+#define __glicko2_snapshots_h__
+
+
+
+#include <cstdint>
+#include <vector>
+
+
+
+class Glicko2_population;
+class Glicko2_snapshots_impl;
+
+
+
+/**
+ * Log of population snapshots, one per rating period, in a single file.
+ *
+ * Every few periods the whole population is written as a base snapshot.  In
+ * between, only the players whose state changed since the snapshot before
+ * are written, as a delta: player indices as gaps, and each value as the
+ * difference (XOR) of its bits from the value before, varint coded, so values
+ * that barely moved take few bytes.  Any period written can be restored by
+ * reading the base before it and applying the deltas up to it.  Snapshots are
+ * exact: a restored population has the same bits as the one written.
+ *
+ * The writer keeps a copy of every player's state as last written, to code
+ * deltas against, and follows the population's changes with
+ * Glicko2_population::GetChangedSince().
+ */
+class Glicko2_snapshots
+{
+	public:
+
+
+
+		/**
+		 * Constructor.  Opens the log for appending, creating it if needed.  A
+		 * snapshot left incomplete at the end of the log, as by a crash while
+		 * writing it, is cut off.  The first snapshot written is always a base.
+		 *
+		 * @param path          Path of the log.
+		 * @param base_interval Periods between base snapshots.
+		 */
+		Glicko2_snapshots(const char* path, unsigned int base_interval = 16);
+
+		/**
+		 * Destructor.  Closes the log.
+		 */
+		~Glicko2_snapshots();
+
+
+
+		/**
+		 * Write a snapshot of a population at its current period, typically
+		 * right after Update().  A base is written when base_interval periods
+		 * have passed since the last one, and also after Rollback(), since the
+		 * periods that follow replace those already logged.
+		 *
+		 * @param population Population, the same one every time.
+		 *
+		 * @return false on a file error.
+		 */
+		bool Write(const Glicko2_population& population);
+
+		/**
+		 * @return Bytes written to the log by this writer.
+		 */
+		std::uint64_t GetBytesWritten() const;
+
+
+
+		/**
+		 * List the periods a log can restore.
+		 *
+		 * @param path    Path of the log.
+		 * @param periods Receives the period of each snapshot, in log order.
+		 *
+		 * @return false on a file error.
+		 */
+		static bool GetPeriods(const char* path, std::vector<unsigned int>& periods);
+
+		/**
+		 * Restore a population as it was at a period, from the last base
+		 * snapshot at or before it and the deltas that follow.  A truncated
+		 * snapshot at the end of the log, as a crash while writing leaves, is
+		 * ignored.
+		 *
+		 * @param path       Path of the log.
+		 * @param period     Rating period.
+		 * @param population Empty population to restore into; on success its
+		 *                   period is that of the last snapshot applied.
+		 *
+		 * @return false on a file error, if the population is not empty, or if
+		 *         no base snapshot is at or before the period.
+		 */
+		static bool Read(const char* path, unsigned int period, Glicko2_population& population);
+
+
+
+	private:
+
+		Glicko2_snapshots(const Glicko2_snapshots&);
+		Glicko2_snapshots& operator=(const Glicko2_snapshots&);
+
+		/**
+		 * Private Implementation.
+		 */
+		Glicko2_snapshots_impl* pimpl;
+
+};
+
+
+
+#endif // __glicko2_snapshots_h__
@@ -0,0 +1,282 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+
+
+namespace
+{
+	// one completed span
+	struct Span
+	{
+		unsigned long long begin;
+		unsigned long long end;
+		int                stage;
+	};
+
+	// per thread ring of spans; owned by the registry so it outlives its thread
+	struct Ring
+	{
+		std::vector<Span>  spans;
+		unsigned long long written;
+		unsigned int       tid;
+	};
+
+	// all rings ever created, and recording state
+	struct Registry
+	{
+		std::mutex               lock;
+		std::vector<Ring*>       rings;
+		std::atomic<bool>        enabled;
+		std::atomic<std::size_t> capacity;
+
+		Registry() : enabled(false), capacity(65536) {}
+
+		~Registry()
+		{
+			for ( unsigned int i=0;i<rings.size();i++ )
+			{
+				delete rings[i];
+			}
+		}
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	// lazily register the calling thread's ring
+	Ring* GetRing()
+	{
+		static thread_local Ring* ring = 0;
+		if ( ring == 0 )
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> guard(registry.lock);
+
+			ring          = new Ring;
+			ring->spans.resize(registry.capacity.load() > 0 ? registry.capacity.load() : 1);
+			ring->written = 0;
+			ring->tid     = (unsigned int)registry.rings.size() + 1;
+			registry.rings.push_back(ring);
+		}
+		return ring;
+	}
+
+	const char* stage_names[Glicko2_trace::STAGE_COUNT] =
+	{
+		"ingest",
+		"graph_build",
+		"sums",
+		"solver",
+		"finalize",
+		"snapshot_write"
+	};
+}
+
+
+
+void Glicko2_trace::Enable(std::size_t capacity)
+{
+	GetRegistry().capacity.store(capacity);
+	GetRegistry().enabled.store(true);
+}
+
+
+
+void Glicko2_trace::Disable()
+{
+	GetRegistry().enabled.store(false);
+}
+
+
+
+bool Glicko2_trace::IsEnabled()
+{
+	return GetRegistry().enabled.load(std::memory_order_relaxed);
+}
+
+
+
+void Glicko2_trace::Clear()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> guard(registry.lock);
+
+	for ( unsigned int i=0;i<registry.rings.size();i++ )
+	{
+		registry.rings[i]->written = 0;
+	}
+}
+
+
+
+unsigned long long Glicko2_trace::Now()
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+
+void Glicko2_trace::Record(STAGE stage, unsigned long long begin, unsigned long long end)
+{
+	if ( !IsEnabled() )
+	{
+		return;
+	}
+
+	Ring* ring = GetRing();
+	Span& span = ring->spans[ring->written % ring->spans.size()];
+	span.begin = begin;
+	span.end   = end;
+	span.stage = stage;
+	ring->written++;
+}
+
+
+
+std::size_t Glicko2_trace::GetSpanCount()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> guard(registry.lock);
+
+	std::size_t count = 0;
+	for ( unsigned int i=0;i<registry.rings.size();i++ )
+	{
+		const Ring* ring = registry.rings[i];
+		count += ring->written < ring->spans.size() ? (std::size_t)ring->written : ring->spans.size();
+	}
+	return count;
+}
+
+
+
+bool Glicko2_trace::WriteChromeJson(std::FILE* file)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> guard(registry.lock);
+
+	// timestamps are relative to the earliest span so the viewer opens at zero
+	unsigned long long origin = ~0ULL;
+	for ( unsigned int i=0;i<registry.rings.size();i++ )
+	{
+		const Ring* ring  = registry.rings[i];
+		std::size_t count = ring->written < ring->spans.size() ? (std::size_t)ring->written : ring->spans.size();
+		for ( std::size_t j=0;j<count;j++ )
+		{
+			if ( ring->spans[j].begin < origin )
+			{
+				origin = ring->spans[j].begin;
+			}
+		}
+	}
+
+	bool first = true;
+	std::fprintf(file,"{\"traceEvents\":[\n");
+	for ( unsigned int i=0;i<registry.rings.size();i++ )
+	{
+		const Ring* ring = registry.rings[i];
+
+		// name the thread's row
+		std::fprintf(file,"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"glicko2 thread %u\"}}",first ? "" : ",\n",ring->tid,ring->tid);
+		first = false;
+
+		// oldest span first
+		std::size_t size  = ring->spans.size();
+		std::size_t count = ring->written < size ? (std::size_t)ring->written : size;
+		std::size_t start = ring->written < size ? 0 : (std::size_t)(ring->written % size);
+		for ( std::size_t j=0;j<count;j++ )
+		{
+			const Span& span = ring->spans[(start + j) % size];
+			std::fprintf(file,",\n{\"name\":\"%s\",\"cat\":\"glicko2\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				stage_names[span.stage],
+				ring->tid,
+				(double)(span.begin - origin) / 1000.0,
+				(double)(span.end - span.begin) / 1000.0);
+		}
+	}
+	std::fprintf(file,"\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	return std::ferror(file) == 0;
+}
+
+
+
+bool Glicko2_trace::WriteChromeJson(const char* path)
+{
+	std::FILE* file = std::fopen(path,"w");
+	if ( file == 0 )
+	{
+		return false;
+	}
+
+	bool ok = WriteChromeJson(file);
+	if ( std::fclose(file) != 0 )
+	{
+		ok = false;
+	}
+	return ok;
+}
+
+
+
+const char* Glicko2_trace::GetStageName(STAGE stage)
+{
+	if ( stage < 0 || stage >= STAGE_COUNT )
+	{
+		return "unknown";
+	}
+	return stage_names[stage];
+}
+
+
+
+
+
+
+Glicko2_trace_scope::Glicko2_trace_scope(Glicko2_trace::STAGE stage) :
+	stage(stage),
+	begin(Glicko2_trace::IsEnabled() ? Glicko2_trace::Now() : 0)
+{
+}
+
+
+
+Glicko2_trace_scope::~Glicko2_trace_scope()
+{
+	if ( begin != 0 )
+	{
+		Glicko2_trace::Record(stage,begin,Glicko2_trace::Now());
+	}
+}
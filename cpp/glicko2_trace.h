@@ -0,0 +1,239 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#ifndef __glicko2_trace_h__
+#define __glicko2_trace_h__
+
+
+
+#include <cstddef>
+#include <cstdio>
+
+
+
+/**
+ * Rating period stage timeline recorder.
+ *
+ * Each thread records completed stage spans into its own fixed size ring
+ * buffer, so recording never takes a lock and never allocates after the first
+ * span on a thread.  When a buffer is full the oldest spans are overwritten.
+ * At the end of a run the spans of every thread are written out as Chrome
+ * trace-event JSON, which can be loaded in chrome://tracing or Perfetto.
+ *
+ * Recording is off until Enable() is called.  The library's own stage
+ * instrumentation (see GLICKO2_TRACE_SCOPE) is only compiled in when
+ * GLICKO2_TRACE is defined, so default builds pay nothing for it.  It times
+ * whole batches, such as a Glicko2_population update; the spans of a single
+ * Glicko2 or Glicko2_fixed update, three per player, also need
+ * GLICKO2_TRACE_OBJECTS (see GLICKO2_TRACE_OBJECT_SCOPE).
+ */
+class Glicko2_trace
+{
+	public:
+
+
+
+		/**
+		 * Enumeration of traced pipeline stages.
+		 */
+		enum STAGE
+		{
+			/**
+			 * Reading and decoding match input.
+			 */
+			INGEST,
+
+			/**
+			 * Grouping matches by player.
+			 */
+			GRAPH_BUILD,
+
+			/**
+			 * Accumulating the g/E variance and delta sums.
+			 */
+			SUMS,
+
+			/**
+			 * Iterating for the new volatility.
+			 */
+			SOLVER,
+
+			/**
+			 * Computing and storing the new rating and deviation.
+			 */
+			FINALIZE,
+
+			/**
+			 * Writing ratings out after a period.
+			 */
+			SNAPSHOT_WRITE,
+
+			/**
+			 * Number of stages, not a stage.
+			 */
+			STAGE_COUNT
+		};
+
+
+
+		/**
+		 * Start recording spans.
+		 *
+		 * @param capacity Number of spans kept per thread.  Only applies to
+		 *                 threads which have not recorded a span yet.
+		 */
+		static void Enable(std::size_t capacity = 65536);
+
+		/**
+		 * Stop recording spans.  Recorded spans are kept until Clear().
+		 */
+		static void Disable();
+
+		/**
+		 * @return true if spans are currently being recorded.
+		 */
+		static bool IsEnabled();
+
+		/**
+		 * Discard all recorded spans.  Must not be called while traced work is
+		 * running on other threads.
+		 */
+		static void Clear();
+
+
+
+		/**
+		 * Get a monotonic timestamp suitable for Record().
+		 *
+		 * @return Nanoseconds since an arbitrary fixed point.
+		 */
+		static unsigned long long Now();
+
+		/**
+		 * Record a completed span on the calling thread.  Does nothing unless
+		 * recording is enabled.
+		 *
+		 * @param stage Stage the span belongs to.
+		 * @param begin Start time, from Now().
+		 * @param end   End time, from Now().
+		 */
+		static void Record(STAGE stage, unsigned long long begin, unsigned long long end);
+
+
+
+		/**
+		 * @return Total number of spans currently held, over all threads.
+		 */
+		static std::size_t GetSpanCount();
+
+		/**
+		 * Write all recorded spans as Chrome trace-event JSON.  Must not be
+		 * called while traced work is running on other threads.
+		 *
+		 * @param file Open output stream.
+		 *
+		 * @return true on success; false on a write error.
+		 */
+		static bool WriteChromeJson(std::FILE* file);
+
+		/**
+		 * Write all recorded spans as Chrome trace-event JSON to a file.
+		 *
+		 * @param path Output file name, overwritten if it exists.
+		 *
+		 * @return true on success; false if the file could not be written.
+		 */
+		static bool WriteChromeJson(const char* path);
+
+		/**
+		 * Get a stage's name as it appears in the trace output.
+		 *
+		 * @param stage Stage.
+		 *
+		 * @return Stage name, e.g. "solver".
+		 */
+		static const char* GetStageName(STAGE stage);
+
+};
+
+
+
+/**
+ * Records one span covering the lifetime of the object.
+ */
+class Glicko2_trace_scope
+{
+	public:
+
+		/**
+		 * Start a span.
+		 *
+		 * @param stage Stage being timed.
+		 */
+		explicit Glicko2_trace_scope(Glicko2_trace::STAGE stage);
+
+		/**
+		 * End the span, and record it if recording is enabled.
+		 */
+		~Glicko2_trace_scope();
+
+	private:
+
+		Glicko2_trace_scope(const Glicko2_trace_scope&);
+		Glicko2_trace_scope& operator=(const Glicko2_trace_scope&);
+
+		Glicko2_trace::STAGE stage;
+		unsigned long long   begin;
+};
+
+
+
+/**
+ * Time the rest of the enclosing block as the given Glicko2_trace stage.  Expands
+ * to nothing unless GLICKO2_TRACE is defined.
+ */
+#ifdef GLICKO2_TRACE
+#define GLICKO2_TRACE_JOIN2(a,b) a##b
+#define GLICKO2_TRACE_JOIN(a,b)  GLICKO2_TRACE_JOIN2(a,b)
+#define GLICKO2_TRACE_SCOPE(stage) Glicko2_trace_scope GLICKO2_TRACE_JOIN(glicko2_trace_scope_,__LINE__)(Glicko2_trace::stage)
+#else
+#define GLICKO2_TRACE_SCOPE(stage)
+#endif
+
+/**
+ * GLICKO2_TRACE_SCOPE for the stages of a single player's update, which are
+ * too short and too many to trace by default.  Expands to nothing unless
+ * GLICKO2_TRACE_OBJECTS is defined as well.
+ */
+#if defined(GLICKO2_TRACE) && defined(GLICKO2_TRACE_OBJECTS)
+#define GLICKO2_TRACE_OBJECT_SCOPE(stage) GLICKO2_TRACE_SCOPE(stage)
+#else
+#define GLICKO2_TRACE_OBJECT_SCOPE(stage)
+#endif
+
+
+
+#endif // __glicko2_trace_h__
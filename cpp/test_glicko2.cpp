@@ -1,6 +1,14 @@
 #include "glicko2.h"
+#include "glicko2_compact.h"
 
+#include <cmath>
 #include <cstdio>
+#include <utility>
+#include <vector>
+
+#ifdef GLICKO2_HAVE_PMR
+#include <memory_resource>
+#endif
 
 int main()
 {
@@ -20,6 +28,186 @@ int main()
 
 	printf("rating = %f, RD = %f\n", A.GetRating(), A.GetDeviation());
 
-	return 0;
+	// same example added in bulk, by value and by index
+	double       ratings[]    = { 1400.0, 1550.0, 1700.0 };
+	double       deviations[] = {   30.0,  100.0,  300.0 };
+	double       scores[]     = {    1.0,    0.0,    0.0 };
+	Glicko2      players[]    = { B, C, D };
+	unsigned int indices[]    = { 0, 1, 2 };
+
+	Glicko2 BA(1500.0, 200.0, 0.06);
+	BA.AddResults(ratings, deviations, scores, 3);
+	BA.Update();
+
+	Glicko2 IA(1500.0, 200.0, 0.06);
+	IA.AddResults(players, indices, scores, 3);
+	IA.Update();
+
+	// caller built buffers are taken over, not copied, leaving the caller
+	// with the rating's empty storage
+	std::vector<double> moved_ratings(ratings, ratings + 3);
+	std::vector<double> moved_deviations(deviations, deviations + 3);
+	std::vector<double> moved_scores(scores, scores + 3);
+
+	Glicko2 MA(1500.0, 200.0, 0.06);
+	MA.AddResults(std::move(moved_ratings), std::move(moved_deviations), std::move(moved_scores));
+	MA.Update();
+	bool adopted = moved_ratings.capacity() == 0 && moved_deviations.capacity() == 0 && moved_scores.capacity() == 0 && MA.GetRating() == BA.GetRating();
+
+	printf("bulk rating = %f, RD = %f\n", BA.GetRating(), BA.GetDeviation());
+	printf("indexed rating = %f, RD = %f\n", IA.GetRating(), IA.GetDeviation());
+
+	bool bulk_ok = BA.GetRating() == A.GetRating() && BA.GetDeviation() == A.GetDeviation() && IA.GetRating() == A.GetRating() && IA.GetDeviation() == A.GetDeviation();
+
+	// round trip through the 16 byte record
+	Glicko2 PA(Glicko2_compact::Pack(A.GetState(), 1).Unpack());
+	printf("compact rating = %.3f, RD = %.3f\n", PA.GetRating(), PA.GetDeviation());
+
+	bool compact_ok = std::fabs(PA.GetRating() - A.GetRating()) < 0.01 && std::fabs(PA.GetDeviation() - A.GetDeviation()) < 0.01 && std::fabs(PA.GetVolatility() - A.GetVolatility()) < 0.000001;
+
+	// provisional rating after each game, then at period close
+	Glicko2 VA(1500.0, 200.0, 0.06);
+	VA.AddWin(B);
+	printf("provisional after 1 = %f,", VA.GetProvisionalRating());
+	VA.AddLoss(C);
+	printf(" after 2 = %f,", VA.GetProvisionalRating());
+	VA.AddLoss(D);
+	printf(" after 3 = %f\n", VA.GetProvisionalRating());
+
+	double provisional = VA.GetProvisionalRating();
+	VA.Update();
+	bool   provisional_ok = std::fabs(provisional - VA.GetRating()) < 0.000001 && VA.GetProvisionalRating() == VA.GetRating();
+
+	// an instant update a whole period after the last is a one game rating period
+	Glicko2 WA(1500.0, 200.0, 0.06);
+	Glicko2 WB(1400.0,  30.0, 0.06);
+	Glicko2 XA(WA);
+	Glicko2 XB(WB);
+	WA.UpdateInstant(WB, Glicko2::WIN, 1.0);
+	XA.AddWin(XB);
+	XB.AddLoss(XA);
+	XA.Update();
+	XB.Update();
+
+	bool instant_ok = WA.GetRating() == XA.GetRating() && WA.GetDeviation() == XA.GetDeviation() && WB.GetRating() == XB.GetRating();
+
+	// and a quarter period later
+	WA.UpdateInstant(WB, Glicko2::LOSS, 1.25);
+	printf("instant rating = %f, RD = %f\n", WA.GetRating(), WA.GetDeviation());
+
+	instant_ok = instant_ok && WB.GetTime() == 1.25;
+
+#ifdef GLICKO2_HAVE_PMR
+	// same example with every player and result held in one arena
+	char                                arena_memory[8192];
+	std::pmr::monotonic_buffer_resource tournament(arena_memory, sizeof(arena_memory));
+	std::pmr::vector<Glicko2>           roster(&tournament);
+
+	roster.emplace_back(1500.0, 200.0, 0.06);
+	roster.emplace_back(1400.0,  30.0, 0.06);
+	roster.emplace_back(1550.0, 100.0, 0.06);
+	roster.emplace_back(1700.0, 300.0, 0.06);
+
+	roster[0].AddWin(roster[1]);
+	roster[0].AddLoss(roster[2]);
+	roster[0].AddLoss(roster[3]);
+	roster[0].Update();
+
+	printf("pmr rating = %f, RD = %f, in arena = %s\n", roster[0].GetRating(), roster[0].GetDeviation(), roster[3].get_allocator().resource() == &tournament ? "yes" : "no");
+
+	bool pmr_ok = roster[0].GetRating() == A.GetRating() && roster[0].GetDeviation() == A.GetDeviation() && roster[3].get_allocator().resource() == &tournament;
+#else
+	bool pmr_ok = true;
+#endif
+
+	// same example with the allocation free variant, spilling into an arena
+	double        memory[256];
+	Glicko2_arena arena(memory, sizeof(memory));
+
+	Glicko2_fixed FA(1500.0, 200.0, 0.06);
+	Glicko2_fixed FB(1400.0,  30.0, 0.06);
+	Glicko2_fixed FC(1550.0, 100.0, 0.06);
+	Glicko2_fixed FD(1700.0, 300.0, 0.06);
+
+	FA.SetArena(&arena);
+	for ( int i=0;i<GLICKO2_FIXED_CAPACITY;i++ )
+	{
+		FA.AddWin(FB);
+		FA.AddLoss(FC);
+		FA.AddLoss(FD);
+	}
+
+	Glicko2 SA(1500.0, 200.0, 0.06);
+	for ( int i=0;i<GLICKO2_FIXED_CAPACITY;i++ )
+	{
+		SA.AddWin(B);
+		SA.AddLoss(C);
+		SA.AddLoss(D);
+	}
+
+	bool spilled = arena.GetUsed() > 0;
+
+	FA.Update();
+	SA.Update();
+
+	printf("fixed rating = %f, RD = %f, spilled = %s\n", FA.GetRating(), FA.GetDeviation(), spilled ? "yes" : "no");
+
+	// the block kernels, for every block size and with blocks left over,
+	// against a plain loop; blocks sum in a different order, so only nearly
+	// the same
+	bool kernels_ok = true;
+	const unsigned int counts[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 17 };
+	for ( unsigned int c=0;c<10;c++ )
+	{
+		double opponent_ratings[17], opponent_deviations[17], opponent_scores[17];
+		for ( unsigned int i=0;i<counts[c];i++ )
+		{
+			opponent_ratings[i]    = Glicko2_math::ToGlicko2Rating(1300.0 + 37.0 * i);
+			opponent_deviations[i] = Glicko2_math::ToGlicko2Deviation(40.0 + 19.0 * i);
+			opponent_scores[i]     = (i % 3) * 0.5;
+		}
+
+		double rating       = Glicko2_math::ToGlicko2Rating(1480.0);
+		double variance_sum = 0.0;
+		double delta_sum    = 0.0;
+		Glicko2_math::Accumulate(rating, opponent_ratings, opponent_deviations, opponent_scores, counts[c], variance_sum, delta_sum);
+
+		double variance_plain = 0.0;
+		double delta_plain    = 0.0;
+		for ( unsigned int i=0;i<counts[c];i++ )
+		{
+			double g_i = Glicko2_math::g(opponent_deviations[i]);
+			double E_i = Glicko2_math::E(rating, opponent_ratings[i], g_i);
+			variance_plain += g_i * g_i * E_i * (1.0 - E_i);
+			delta_plain    += g_i * (opponent_scores[i] - E_i);
+		}
+
+		kernels_ok = kernels_ok && std::fabs(variance_sum - variance_plain) < 1e-12 && std::fabs(delta_sum - delta_plain) < 1e-12;
+	}
+
+	// an established player skips the volatility solve, and lands where the
+	// solve would have to within the freeze; a freeze too small falls back;
+	// the freeze belongs to EA alone, so EB still solves
+	Glicko2 EA(1500.0, 40.0, 0.06);
+	Glicko2 EB(EA);
+	EA.AddWin(B);
+	EA.AddDraw(C);
+	EB.AddWin(B);
+	EB.AddDraw(C);
+
+	EA.SetVolatilityFreeze(0.0001);
+	EB.Update();
+	EA.Update();
+	bool freeze_ok = Glicko2::GetFrozenCount() == 1 && Glicko2::GetSolvedCount() == 0 && EA.GetVolatility() == 0.06 && EB.GetVolatility() != 0.06 && std::fabs(EB.GetVolatility() - 0.06) < 0.0001 && std::fabs(EA.GetRating() - EB.GetRating()) < 0.01;
+
+	Glicko2 EC(EA);
+	EA.SetVolatilityFreeze(1e-15);
+	EA.AddWin(B);
+	EA.Update();
+	freeze_ok = freeze_ok && EC.GetVolatilityFreeze() == 0.0001 && Glicko2::GetFrozenCount() == 1 && Glicko2::GetSolvedCount() == 1;
+
+	printf("frozen rating = %f, RD = %f\n", EA.GetRating(), EA.GetDeviation());
+
+	return FA.GetRating() == SA.GetRating() && FA.GetDeviation() == SA.GetDeviation() && spilled && provisional_ok && instant_ok && freeze_ok && adopted && bulk_ok && compact_ok && pmr_ok && kernels_ok ? 0 : 1;
 }
 
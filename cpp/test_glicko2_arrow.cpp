@@ -0,0 +1,130 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_arrow.h"
+#include "glicko2_population.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+
+int main()
+{
+	// a population with players in both tiers
+	Glicko2_population population;
+	for ( unsigned int i=0;i<1000;i++ )
+	{
+		population.AddPlayer(1400.0 + (i % 200), 200.0 + (i % 100), 0.06);
+	}
+	for ( unsigned int period=0;period<4;period++ )
+	{
+		for ( unsigned int i=0;i<500;i++ )
+		{
+			unsigned int player = (i * 7 + period * 131) % (period < 2 ? 1000 : 600);
+			population.AddMatch(player, (player + 1 + i % 13) % 1000, i % 3 ? Glicko2::WIN : Glicko2::LOSS);
+		}
+		population.Update();
+	}
+	population.Demote(2);
+
+	bool ok = population.GetColdCount() > 0 && population.WriteArrow("test_glicko2_arrow.arrow");
+
+	// the columns as written
+	Glicko2_arrow_reader reader;
+	ok = ok && reader.Open("test_glicko2_arrow.arrow") && reader.GetColumnCount() == 5 && reader.GetBatchCount() == 2;
+	ok = ok && reader.FindColumn("deviation") == 2 && reader.GetColumnType(4) == Glicko2_arrow_writer::UINT32 && reader.FindColumn("id") == Glicko2_arrow_reader::not_found;
+	ok = ok && reader.ReadBatch(0) && reader.GetRowCount() == population.GetHotCount();
+	reader.Close();
+
+	// read back into an empty population
+	Glicko2_population copy;
+	ok = ok && copy.ReadArrow("test_glicko2_arrow.arrow") && copy.GetPlayerCount() == population.GetPlayerCount();
+	for ( unsigned int i=0;ok && i<population.GetPlayerCount();i++ )
+	{
+		Glicko2_rating a = population.GetState(i);
+		Glicko2_rating b = copy.GetState(i);
+		ok = a.rating == b.rating && a.deviation == b.deviation && a.volatility == b.volatility && population.GetLastActive(i) == copy.GetLastActive(i);
+	}
+
+	// a player index far beyond the file is rejected before any row applies
+	{
+		Glicko2_arrow_writer bad;
+		bad.AddColumn("player", Glicko2_arrow_writer::UINT32);
+		bad.AddColumn("rating", Glicko2_arrow_writer::DOUBLE);
+		bad.AddColumn("deviation", Glicko2_arrow_writer::DOUBLE);
+		bad.AddColumn("volatility", Glicko2_arrow_writer::DOUBLE);
+		bad.AddColumn("last_active", Glicko2_arrow_writer::UINT32);
+		ok = ok && bad.Open("test_glicko2_arrow.arrow");
+		for ( std::uint32_t player=0;player<=1;player++ )
+		{
+			std::uint32_t index      = player == 0 ? 0 : 0x7FFFFFF0u;
+			double        rating     = 1.0;
+			double        deviation  = 1.0;
+			double        volatility = 0.06;
+			std::uint32_t active     = 9;
+			const void*   columns[]  = { &index, &rating, &deviation, &volatility, &active };
+			ok = ok && bad.WriteBatch(1, columns);
+		}
+		ok = bad.Close() && ok;
+	}
+	Glicko2_rating before = copy.GetState(0);
+	ok = ok && !copy.ReadArrow("test_glicko2_arrow.arrow") && copy.GetPlayerCount() == population.GetPlayerCount() && copy.GetState(0).rating == before.rating && copy.GetLastActive(0) == population.GetLastActive(0);
+
+	// other column types, over several batches
+	Glicko2_arrow_writer writer;
+	writer.AddColumn("id", Glicko2_arrow_writer::UINT64);
+	writer.AddColumn("time", Glicko2_arrow_writer::INT64);
+	ok = ok && writer.Open("test_glicko2_arrow.arrow");
+	std::vector<std::uint64_t> ids;
+	std::vector<std::int64_t>  times;
+	for ( unsigned int batch=0;batch<3;batch++ )
+	{
+		ids.clear();
+		times.clear();
+		for ( unsigned int i=0;i<=batch*7;i++ )
+		{
+			ids.push_back(0xFEDCBA9876543210ull + i);
+			times.push_back(-(std::int64_t)(batch * 100 + i));
+		}
+		const void* columns[] = { &ids[0], &times[0] };
+		ok = ok && writer.WriteBatch(ids.size(), columns);
+	}
+	ok = writer.Close() && ok;
+
+	ok = ok && reader.Open("test_glicko2_arrow.arrow") && reader.GetBatchCount() == 3 && reader.GetColumnType(1) == Glicko2_arrow_writer::INT64;
+	ok = ok && reader.ReadBatch(2) && reader.GetRowCount() == 15;
+	ok = ok && static_cast<const std::uint64_t*>(reader.GetColumn(0))[14] == 0xFEDCBA987654321Eull && static_cast<const std::int64_t*>(reader.GetColumn(1))[3] == -203;
+	ok = ok && !reader.ReadBatch(3);
+	reader.Close();
+
+	printf("%u hot, %u cold, %s\n", population.GetHotCount(), population.GetColdCount(), ok ? "ok" : "FAILED");
+
+	std::remove("test_glicko2_arrow.arrow");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_events.h"
+#include "glicko2_population.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+
+
+int main()
+{
+	Glicko2_population population;
+	Glicko2_events     events(1 << 11);
+	Glicko2_events     small(16);
+	for ( unsigned int i=0;i<2000;i++ )
+	{
+		population.AddPlayer();
+	}
+
+	// a consumer reading while the periods are played; the ring wraps several
+	// times, but each period waits for the consumer, so none are lost
+	std::vector<Glicko2_event> received;
+	std::atomic<std::uint64_t> consumed(0);
+	std::atomic<bool>          done(false);
+	std::thread                consumer([&]()
+	{
+		std::uint64_t cursor = 0;
+		Glicko2_event batch[64];
+		for ( ;; )
+		{
+			bool        last = done.load();
+			std::size_t n    = events.Read(cursor, batch, 64);
+			received.insert(received.end(), batch, batch + n);
+			consumed.store(cursor);
+			if ( n == 0 && last )
+			{
+				break;
+			}
+		}
+	});
+
+	std::vector<Glicko2_rating> initial(2000);
+	for ( unsigned int i=0;i<2000;i++ )
+	{
+		initial[i] = population.GetState(i);
+	}
+
+	population.SetEvents(&events);
+	for ( unsigned int period=0;period<20;period++ )
+	{
+		for ( unsigned int i=0;i<200;i++ )
+		{
+			unsigned int player = (i * 11 + period * 173) % 2000;
+			population.AddMatch(player, (player + 1 + i % 5) % 2000, i % 3 ? Glicko2::WIN : Glicko2::LOSS);
+		}
+		population.Update();
+		if ( period == 10 )
+		{
+			population.Rollback();
+			population.Update();
+		}
+		while ( consumed.load() < events.GetPublished() )
+		{
+			std::this_thread::yield();
+		}
+	}
+	done.store(true);
+	consumer.join();
+
+	// the events chain from the initial states to the current ones
+	std::vector<Glicko2_rating> state(initial);
+	bool                        ok = received.size() == events.GetPublished() && events.GetPublished() > 4 * (1 << 11);
+	for ( std::size_t i=0;ok && i<received.size();i++ )
+	{
+		const Glicko2_event& event = received[i];
+		ok = event.before.rating == state[event.player].rating && event.before.deviation == state[event.player].deviation && event.before.volatility == state[event.player].volatility;
+		state[event.player] = event.after;
+	}
+	for ( unsigned int i=0;ok && i<2000;i++ )
+	{
+		Glicko2_rating now = population.GetState(i);
+		ok = now.rating == state[i].rating && now.deviation == state[i].deviation && now.volatility == state[i].volatility;
+	}
+
+	// a consumer that fell behind the small ring loses all but the newest 16,
+	// and is moved on to the oldest of those
+	for ( unsigned int i=0;i<40;i++ )
+	{
+		Glicko2_event event = Glicko2_event();
+		event.player = i;
+		small.Publish(event);
+	}
+	std::uint64_t cursor = 0;
+	Glicko2_event batch[16];
+	ok = ok && small.Read(cursor, batch, 1) == 1 && batch[0].player == 40 - 16 && cursor == 40 - 16 + 1;
+	ok = ok && small.Read(cursor, batch, 16) == 15 && batch[14].player == 39 && cursor == small.GetPublished();
+
+	// the largest rating changes of the last full period
+	std::vector<Glicko2_event> period_events;
+	for ( std::size_t i=0;i<received.size();i++ )
+	{
+		if ( received[i].period == 20 )
+		{
+			period_events.push_back(received[i]);
+		}
+	}
+	std::vector<Glicko2_event> movers;
+	Glicko2_events::SelectTopMovers(&period_events[0], period_events.size(), 10, movers);
+	ok = ok && movers.size() == 10;
+
+	unsigned int larger = 0;
+	for ( std::size_t i=0;ok && i<period_events.size();i++ )
+	{
+		larger += std::fabs(period_events[i].after.rating - period_events[i].before.rating) > std::fabs(movers[9].after.rating - movers[9].before.rating) ? 1 : 0;
+	}
+	ok = ok && larger < 10;
+	for ( std::size_t i=1;ok && i<movers.size();i++ )
+	{
+		ok = std::fabs(movers[i].after.rating - movers[i].before.rating) <= std::fabs(movers[i-1].after.rating - movers[i-1].before.rating);
+	}
+
+	printf("%u events, %s\n", (unsigned int)received.size(), ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
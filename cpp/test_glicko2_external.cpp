@@ -0,0 +1,63 @@
+#include "glicko2_external.h"
+#include "glicko2_population.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+int main()
+{
+	// the same period rated in memory and out of core, with a tiny memory
+	// budget so the results spill into many runs
+	std::vector<Glicko2_external::Player> players;
+	Glicko2_population                    population;
+	for ( unsigned int i=0;i<1000;i++ )
+	{
+		Glicko2_external::Player player;
+		player.id    = 10 * i;
+		player.state = Glicko2_math::FromGlicko(1200.0 + (i % 50) * 12.0, 50.0 + (i % 7) * 40.0, 0.06);
+		players.push_back(player);
+		population.AddPlayer(Glicko2_math::ToGlickoRating(player.state.rating), Glicko2_math::ToGlickoDeviation(player.state.deviation), 0.06);
+	}
+	population.AddPlayer();
+
+	bool ok = Glicko2_external::WriteTable("test_glicko2_external.table", &players[0], players.size());
+
+	Glicko2_external external("test_glicko2_external.table", ".", 16 * 1024);
+
+	// player 1000 is new, and only in the population so far
+	unsigned int seed = 12345;
+	for ( unsigned int i=0;i<20000;i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		unsigned int    a      = (seed >> 8) % 1001;
+		unsigned int    b      = (a + 1 + (seed >> 20) % 999) % 1001;
+		Glicko2::RESULT result = (seed & 3) == 0 ? Glicko2::DRAW : ((seed & 3) == 1 ? Glicko2::LOSS : Glicko2::WIN);
+
+		ok = ok && external.AddMatch(10 * a, 10 * b, result);
+		population.AddMatch(a, b, result);
+	}
+
+	unsigned int runs = external.GetRunCount();
+	ok = ok && external.Update();
+	population.Update();
+
+	std::vector<Glicko2_external::Player> rated;
+	ok = ok && Glicko2_external::ReadTable("test_glicko2_external.table", rated) && rated.size() == 1001;
+
+	double worst = 0.0;
+	for ( unsigned int i=0;ok && i<rated.size();i++ )
+	{
+		worst = std::fmax(worst, std::fabs(Glicko2_math::ToGlickoRating(rated[i].state.rating) - population.GetRating(i)));
+		worst = std::fmax(worst, std::fabs(Glicko2_math::ToGlickoDeviation(rated[i].state.deviation) - population.GetDeviation(i)));
+	}
+
+	Glicko2_rating state;
+	ok = ok && worst < 0.000001 && Glicko2_external::Find("test_glicko2_external.table", 5000, state) && state.rating == rated[500].state.rating && !Glicko2_external::Find("test_glicko2_external.table", 5001, state);
+
+	printf("runs = %u, largest difference = %g, %s\n", runs, worst, ok ? "ok" : "FAILED");
+
+	std::remove("test_glicko2_external.table");
+
+	return ok ? 0 : 1;
+}
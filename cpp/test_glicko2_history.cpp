@@ -0,0 +1,115 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_history.h"
+#include "glicko2_population.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+
+
+int main()
+{
+	Glicko2_population population;
+	for ( unsigned int i=0;i<1000;i++ )
+	{
+		population.AddPlayer();
+	}
+
+	// the exact states in effect from each period, to check against
+	Glicko2_history                           history(4);
+	std::vector<std::vector<Glicko2_rating> > states(61);
+	std::vector<unsigned int>                 players(1000);
+	std::vector<unsigned int>                 last_active(1000);
+	for ( unsigned int i=0;i<1000;i++ )
+	{
+		players[i] = i;
+	}
+
+	for ( unsigned int period=0;period<=60;period++ )
+	{
+		if ( period > 0 )
+		{
+			for ( unsigned int i=0;i<150;i++ )
+			{
+				unsigned int player = (i * 13 + period * 97) % (period % 2 ? 300 : 1000);
+				population.AddMatch(player, (player + 1 + i % 7) % 1000, i % 4 ? Glicko2::WIN : Glicko2::LOSS);
+			}
+			population.Update();
+
+			// one period is undone and played differently
+			if ( period == 40 )
+			{
+				history.Record(population);
+				population.Rollback();
+				history.Record(population);
+				population.AddMatch(0, 1, Glicko2::DRAW);
+				population.Update();
+			}
+		}
+		history.Record(population);
+
+		states[period].resize(1000);
+		population.GetStates(&players[0], 1000, &states[period][0], &last_active[0]);
+	}
+
+	// every player as of every period, to the quantization
+	bool ok = true;
+	for ( unsigned int period=0;ok && period<=60;period++ )
+	{
+		for ( unsigned int i=0;ok && i<1000;i++ )
+		{
+			Glicko2_history_entry entry;
+			ok = history.GetAt(i, period, entry) && entry.period <= period;
+			ok = ok && std::fabs(entry.rating - Glicko2_math::ToGlickoRating(states[period][i].rating)) <= 1.0 / 64;
+			ok = ok && std::fabs(entry.deviation - Glicko2_math::ToGlickoDeviation(states[period][i].deviation)) <= 1.0 / 64;
+			ok = ok && std::fabs(entry.volatility - states[period][i].volatility) <= 0.5e-6;
+		}
+	}
+
+	// a range agrees with the point queries
+	std::vector<Glicko2_history_entry> range;
+	history.GetRange(1, 10, 45, range);
+	ok = ok && !range.empty() && range.front().period >= 10 && range.back().period <= 45;
+	for ( unsigned int i=0;ok && i<range.size();i++ )
+	{
+		Glicko2_history_entry entry;
+		ok = history.GetAt(1, range[i].period, entry) && entry.period == range[i].period && entry.rating == range[i].rating;
+		ok = ok && (i == 0 || range[i].period > range[i-1].period);
+	}
+
+	Glicko2_history_entry entry;
+	ok = ok && !history.GetAt(1000, 10, entry);
+
+	// well under half of a (player, period, rating, deviation, volatility) row
+	ok = ok && history.GetBytes() < history.GetEntryCount() * 16;
+
+	printf("%u entries in %u bytes, %s\n", (unsigned int)history.GetEntryCount(), (unsigned int)history.GetBytes(), ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
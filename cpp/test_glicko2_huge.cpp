@@ -0,0 +1,76 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+
+#include "glicko2_huge.h"
+#include "glicko2_population.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+
+int main()
+{
+	bool ok = Glicko2_huge::GetMappedBytes() == 0;
+
+	// small arrays come from the heap, large ones are mapped a huge page at a
+	// time, and aligned to one
+	std::size_t mapped = 0;
+	{
+		std::vector<double,Glicko2_huge_allocator<double> > small(1000,1.0);
+		ok = ok && Glicko2_huge::GetMappedBytes() == 0;
+
+		std::vector<double,Glicko2_huge_allocator<double> > large(1000000,2.0);
+		mapped = Glicko2_huge::GetMappedBytes();
+#if defined(__linux__)
+		ok = ok && mapped == 4 * Glicko2_huge::huge_page_size && (std::uintptr_t)&large[0] % Glicko2_huge::huge_page_size == 0;
+#endif
+		ok = ok && Glicko2_huge::GetAdvisedBytes() <= mapped && small[999] == 1.0 && large[999999] == 2.0;
+	}
+	ok = ok && Glicko2_huge::GetMappedBytes() == 0 && Glicko2_huge::GetAdvisedBytes() == 0;
+
+	// a population large enough for its columns to be mapped
+	Glicko2_population population;
+	for ( unsigned int i=0;i<300000;i++ )
+	{
+		population.AddPlayer(1400.0 + i % 200, 80.0, 0.06);
+	}
+	for ( unsigned int i=0;i<300000;i+=2 )
+	{
+		population.AddMatch(i, i + 1, Glicko2::WIN);
+	}
+	population.Update(2);
+	ok = ok && population.GetRating(0) > 1400.0 && population.GetRating(1) < 1401.0;
+#if defined(__linux__)
+	ok = ok && Glicko2_huge::GetMappedBytes() > 0;
+#endif
+
+	printf("%u KB mapped, %u KB advised, %u KB huge, %s\n", (unsigned int)(Glicko2_huge::GetMappedBytes() / 1024), (unsigned int)(Glicko2_huge::GetAdvisedBytes() / 1024), (unsigned int)(Glicko2_huge::GetHugeBytes() / 1024), ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
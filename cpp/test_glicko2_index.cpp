@@ -0,0 +1,55 @@
+#include "glicko2_population.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main()
+{
+	// players known by 64 bit account number and by UUID
+	Glicko2_population population;
+
+	std::vector<std::uint64_t> accounts;
+	std::vector<unsigned int>  players;
+	for ( unsigned int i=0;i<100000;i++ )
+	{
+		accounts.push_back(0x1000000000000000ULL + 7919ULL * i);
+		players.push_back(population.AddPlayer());
+	}
+
+	Glicko2_index& index = population.GetIndex();
+	unsigned int   added = index.InsertBulk(&accounts[0], &players[0], (unsigned int)accounts.size());
+
+	std::string alice = "3f2504e0-4f89-11d3-9a0c-0305e82c3301";
+	std::string bob   = "3f2504e0-4f89-11d3-9a0c-0305e82c3302";
+	index.Insert(alice, players[10]);
+	index.Insert(bob, players[20]);
+
+	// look them all up again, plus some that were never added
+	std::vector<std::uint64_t> lookups(accounts);
+	lookups.push_back(42);
+	std::vector<unsigned int> found(lookups.size());
+	index.FindBulk(&lookups[0], &found[0], (unsigned int)lookups.size());
+
+	bool ok = added == accounts.size() && !index.Insert(accounts[5], 0) && index.GetSize() == accounts.size() + 2;
+	for ( unsigned int i=0;i<accounts.size();i++ )
+	{
+		ok = ok && found[i] == players[i];
+	}
+	ok = ok && found.back() == Glicko2_index::not_found;
+
+	const char* names[]   = { bob.c_str(), alice.c_str(), "42" };
+	std::size_t lengths[] = { bob.size(), alice.size(), 2 };
+	unsigned int named[3];
+	index.FindBulk(names, lengths, named, 3);
+	ok = ok && named[0] == players[20] && named[1] == players[10] && named[2] == Glicko2_index::not_found && index.Find(42) == Glicko2_index::not_found;
+
+	// a match between two UUIDs
+	population.AddMatch(index.Find(alice), index.Find(bob), Glicko2::WIN);
+	population.Update();
+	ok = ok && population.GetRating(players[10]) > 1500.0;
+
+	printf("ids = %u, %u bytes, %s\n", (unsigned int)index.GetSize(), (unsigned int)index.GetBytes(), ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_numa.h"
+#include "glicko2_population.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+
+
+
+namespace
+{
+	void WriteFile(const char* path, const char* text)
+	{
+		std::FILE* file = std::fopen(path, "w");
+		if ( file )
+		{
+			std::fputs(text, file);
+			std::fclose(file);
+		}
+	}
+}
+
+
+
+int main()
+{
+	// this machine, whatever it has
+	Glicko2_numa machine;
+	bool         ok = machine.GetNodeCount() >= 1 && (machine.GetNodeCount() > 1 || machine.Pin(0));
+
+	// a two node topology, listed out of order
+	mkdir("test_glicko2_numa.nodes", 0755);
+	mkdir("test_glicko2_numa.nodes/node1", 0755);
+	mkdir("test_glicko2_numa.nodes/node0", 0755);
+	WriteFile("test_glicko2_numa.nodes/node1/cpulist", "2,3\n");
+	WriteFile("test_glicko2_numa.nodes/node0/cpulist", "0-1\n");
+	WriteFile("test_glicko2_numa.nodes/possible", "0-1\n");
+
+	Glicko2_numa two("test_glicko2_numa.nodes");
+	ok = ok && two.GetNodeCount() == 2 && two.GetCpuCount(0) == 2 && two.GetCpuCount(1) == 2;
+
+	// an update split across nodes gives the same ratings, even where the
+	// threads cannot be pinned or the memory placed
+	Glicko2_population serial;
+	Glicko2_population split;
+	for ( unsigned int i=0;i<5000;i++ )
+	{
+		serial.AddPlayer(1300.0 + i % 400, 60.0 + i % 90, 0.06);
+		split.AddPlayer(1300.0 + i % 400, 60.0 + i % 90, 0.06);
+	}
+	for ( unsigned int period=0;period<3;period++ )
+	{
+		for ( unsigned int i=0;i<5000;i++ )
+		{
+			unsigned int    opponent = (i * 31 + period * 7 + 1) % 5000;
+			Glicko2::RESULT result   = (i + period) % 3 == 0 ? Glicko2::DRAW : ((i ^ opponent) & 1 ? Glicko2::WIN : Glicko2::LOSS);
+			serial.AddMatch(i, opponent, result);
+			split.AddMatch(i, opponent, result);
+		}
+		serial.Update(1);
+		split.Update(period == 1 ? machine : two, 2);
+	}
+	for ( unsigned int i=0;ok && i<5000;i++ )
+	{
+		ok = serial.GetRating(i) == split.GetRating(i) && serial.GetDeviation(i) == split.GetDeviation(i) && serial.GetVolatility(i) == split.GetVolatility(i);
+	}
+	ok = ok && split.GetPeriod() == 3 && split.Rollback();
+
+	std::remove("test_glicko2_numa.nodes/node1/cpulist");
+	std::remove("test_glicko2_numa.nodes/node0/cpulist");
+	std::remove("test_glicko2_numa.nodes/possible");
+	std::remove("test_glicko2_numa.nodes/node1");
+	std::remove("test_glicko2_numa.nodes/node0");
+	std::remove("test_glicko2_numa.nodes");
+
+	printf("%u nodes, %s\n", machine.GetNodeCount(), ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_parser.h"
+#include "glicko2_population.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+
+int main()
+{
+	// numeric and string ids, each result spelling, a header, CRLF, and bad lines
+	const char* results[] = { "1", "0", "0.5", "W", "loss", "d", ".5", "1.0" };
+	std::string text = "player,opponent,result,time\r\n";
+	char        line[128];
+	for ( unsigned int i=0;i<20000;i++ )
+	{
+		unsigned int a = (i * 7919) % 500;
+		unsigned int b = (i * 104729 + 1) % 500;
+		if ( a % 3 == 0 )
+		{
+			snprintf(line, sizeof(line), "user-%u,%u,%s,%d%s", a, b, results[i % 8], (int)i - 100, i % 2 ? "\r\n" : "\n");
+		}
+		else
+		{
+			snprintf(line, sizeof(line), "%u,user-%u,%s,%u\n", a, b, results[i % 8], i);
+		}
+		text += line;
+		if ( i % 5000 == 0 )
+		{
+			text += "\n1,2,maybe,3\n1,2\n";
+		}
+	}
+	text += "7,8,W";
+
+	// all at once on one thread
+	Glicko2_population         whole;
+	Glicko2_parser             whole_parser(whole, ',', true);
+	std::vector<Glicko2_match> expected;
+	bool ok = whole_parser.Parse(text.data(), text.size(), expected) == text.size();
+	ok = ok && expected.size() == 20001 && whole_parser.GetErrorCount() == 8;
+	ok = ok && expected[0].score == 1.0 && expected[1].score == 0.0 && expected[2].score == 0.5 && expected[4].score == 0.0 && expected[6].score == 0.5;
+	ok = ok && expected[0].time == -100 && expected[1].time == 1 && expected[20000].time == 0;
+	ok = ok && whole.GetIndex().Find("user-0", 6) == expected[0].player && whole.GetIndex().Find(std::uint64_t(1)) == expected[0].opponent;
+
+	// in uneven pieces on four threads, carrying partial lines over
+	Glicko2_population         pieces;
+	Glicko2_parser             pieces_parser(pieces, ',', true);
+	std::vector<Glicko2_match> matches;
+	std::string                carry;
+	for ( std::size_t at=0;at<text.size();at+=100003 )
+	{
+		carry.append(text, at, 100003);
+		bool last = at + 100003 >= text.size();
+		carry.erase(0, pieces_parser.Parse(carry.data(), carry.size(), matches, 4, last));
+	}
+	ok = ok && carry.empty() && matches.size() == expected.size() && pieces_parser.GetErrorCount() == 8;
+	ok = ok && pieces.GetPlayerCount() == whole.GetPlayerCount();
+	for ( std::size_t i=0;ok && i<matches.size();i++ )
+	{
+		ok = matches[i].player == expected[i].player && matches[i].opponent == expected[i].opponent && matches[i].score == expected[i].score && matches[i].time == expected[i].time;
+	}
+
+	// tab separated
+	Glicko2_population         tabbed;
+	Glicko2_parser             tab_parser(tabbed, '\t');
+	std::vector<Glicko2_match> tabs;
+	const char*                tsv = "10\t20\tD\t5\n20\t10\tw\n";
+	tab_parser.Parse(tsv, std::strlen(tsv), tabs);
+	ok = ok && tabs.size() == 2 && tabs[0].player == tabs[1].opponent && tabs[0].score == 0.5 && tabs[1].score == 1.0 && tabs[0].time == 5;
+
+	// times that do not fit in 64 bits are malformed, the largest that does is not
+	Glicko2_population         timed;
+	Glicko2_parser             time_parser(timed, ',');
+	std::vector<Glicko2_match> times;
+	const char*                big = "1,2,W,9223372036854775807\n1,2,W,9223372036854775808\n1,2,W,-99999999999999999999\n";
+	time_parser.Parse(big, std::strlen(big), times);
+	ok = ok && times.size() == 1 && times[0].time == INT64_MAX && time_parser.GetErrorCount() == 2;
+
+	// zero padded ids are not the same players as unpadded ones
+	Glicko2_population         padded;
+	Glicko2_parser             padded_parser(padded, ',');
+	std::vector<Glicko2_match> pads;
+	const char*                csv = "007,7,W\n0,00,L\n7,0,D\n";
+	padded_parser.Parse(csv, std::strlen(csv), pads);
+	ok = ok && pads.size() == 3 && padded.GetPlayerCount() == 4 && pads[0].player != pads[0].opponent && pads[1].player != pads[1].opponent;
+	ok = ok && pads[2].player == pads[0].opponent && pads[2].opponent == pads[1].player && padded.GetIndex().Find("007", 3) == pads[0].player;
+
+	printf("%u matches, %u players, %u errors, %s\n", (unsigned int)expected.size(), (unsigned int)whole.GetPlayerCount(), (unsigned int)whole_parser.GetErrorCount(), ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
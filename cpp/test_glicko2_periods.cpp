@@ -0,0 +1,66 @@
+#include "glicko2_periods.h"
+#include "glicko2_population.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+int main()
+{
+	// a year of matches in random order, split into weeks by one thread and by four
+	std::vector<Glicko2_match> matches(200000);
+	unsigned int               seed = 1;
+	for ( unsigned int i=0;i<matches.size();i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		matches[i].time     = 1704067200 + (std::int64_t)(seed % (366u * 86400u));
+		matches[i].player   = i % 100;
+		matches[i].opponent = (i * 7 + 1) % 100 == i % 100 ? (i + 1) % 100 : (i * 7 + 1) % 100;
+		matches[i].score    = (seed >> 16) % 3 * 0.5;
+	}
+
+	Glicko2_periods weekly(Glicko2_periods::WEEK);
+	Glicko2_periods threaded(Glicko2_periods::WEEK);
+	weekly.Bucket(&matches[0], matches.size(), 1);
+	threaded.Bucket(&matches[0], matches.size(), 4);
+
+	// the same as a stable comparison sort
+	std::vector<Glicko2_match> expected(matches);
+	std::stable_sort(expected.begin(), expected.end(), [&](const Glicko2_match& a, const Glicko2_match& b) { return weekly.GetPeriod(a.time) < weekly.GetPeriod(b.time); });
+
+	bool        ok   = weekly.GetBatchCount() == 53 && threaded.GetBatchCount() == 53;
+	std::size_t next = 0;
+	for ( std::size_t batch=0;ok && batch<weekly.GetBatchCount();batch++ )
+	{
+		const Glicko2_match* a = weekly.GetBatch(batch);
+		const Glicko2_match* b = threaded.GetBatch(batch);
+		for ( std::size_t i=0;i<weekly.GetBatchSize(batch);i++,next++ )
+		{
+			ok = ok && a[i].time == expected[next].time && b[i].time == a[i].time && weekly.GetPeriod(a[i].time) == weekly.GetBatchPeriod(batch);
+		}
+	}
+	ok = ok && next == matches.size();
+
+	// calendar boundaries: Monday 1970-01-05 starts week 1, and 2024 is a leap year
+	Glicko2_periods monthly(Glicko2_periods::MONTH);
+	Glicko2_periods fixed(1000, 3600);
+	ok = ok && weekly.GetPeriod(345599) == 0 && weekly.GetPeriod(345600) == 1;
+	ok = ok && monthly.GetPeriod(1709251199) == 649 && monthly.GetPeriod(1709251200) == 650 && monthly.GetPeriod(-1) == -1;
+	ok = ok && fixed.GetPeriod(999) == -1 && fixed.GetPeriod(1000) == 0 && fixed.GetPeriod(4600) == 1;
+
+	// rate every week in turn
+	Glicko2_population population;
+	for ( unsigned int i=0;i<100;i++ )
+	{
+		population.AddPlayer();
+	}
+	for ( std::size_t batch=0;batch<weekly.GetBatchCount();batch++ )
+	{
+		weekly.AddBatch(batch, population);
+		population.Update();
+	}
+
+	printf("batches = %u, periods = %u, %s\n", (unsigned int)weekly.GetBatchCount(), population.GetPeriod(), ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
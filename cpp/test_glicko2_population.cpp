@@ -0,0 +1,115 @@
+#include "glicko2_population.h"
+
+#include <cmath>
+#include <cstdio>
+
+int main()
+{
+	// Glicko-2 Example, rated as a population
+	// calculation from http://www.glicko.com/glicko2.doc/example.html
+
+	Glicko2_population population;
+
+	unsigned int A = population.AddPlayer(1500.0, 200.0, 0.06);
+	unsigned int B = population.AddPlayer(1400.0,  30.0, 0.06);
+	unsigned int C = population.AddPlayer(1550.0, 100.0, 0.06);
+	unsigned int D = population.AddPlayer(1700.0, 300.0, 0.06);
+
+	population.AddResult(A, B, 1.0);
+	population.AddResult(A, C, 0.0);
+	population.AddResult(A, D, 0.0);
+
+	population.Update();
+
+	printf("rating = %f, RD = %f\n", population.GetRating(A), population.GetDeviation(A));
+
+	bool ok = std::fabs(population.GetRating(A) - 1464.050666) < 0.000001 && population.GetRating(B) == 1400.0;
+
+	// a round robin among many players, in one thread and in four
+	Glicko2_population serial;
+	Glicko2_population threaded;
+	for ( unsigned int i=0;i<100;i++ )
+	{
+		serial.AddPlayer(1200.0 + 5.0 * i, 50.0 + i, 0.06);
+		threaded.AddPlayer(1200.0 + 5.0 * i, 50.0 + i, 0.06);
+	}
+	for ( unsigned int i=0;i<100;i++ )
+	{
+		for ( unsigned int j=i+1;j<100;j+=7 )
+		{
+			Glicko2::RESULT result = (i + j) % 3 == 0 ? Glicko2::DRAW : (i > j ? Glicko2::WIN : Glicko2::LOSS);
+			serial.AddMatch(i, j, result);
+			threaded.AddMatch(i, j, result);
+		}
+	}
+	serial.Update(1);
+	threaded.Update(4);
+
+	for ( unsigned int i=0;i<100;i++ )
+	{
+		ok = ok && serial.GetRating(i) == threaded.GetRating(i) && serial.GetDeviation(i) == threaded.GetDeviation(i);
+	}
+
+	// a bad period is undone, and the good one applied in its place
+	double rating_good = serial.GetRating(0);
+	threaded.AddMatch(0, 1, Glicko2::LOSS);
+	threaded.Update();
+	ok = ok && threaded.Rollback() && !threaded.CanRollback() && threaded.GetPeriod() == 1 && threaded.GetRating(0) == rating_good;
+	threaded.AddMatch(0, 1, Glicko2::WIN);
+	threaded.Update();
+
+	// players idle for more than two periods move to the cold tier, and come back on a result
+	serial.AddMatch(0, 1, Glicko2::WIN);
+	serial.Update();
+	ok = ok && serial.GetRating(0) == threaded.GetRating(0) && serial.GetRating(1) == threaded.GetRating(1) && serial.GetRating(2) == threaded.GetRating(2);
+	serial.Update();
+
+	double       rating_before = serial.GetRating(50);
+	unsigned int moved         = serial.Demote(2);
+
+	printf("cold = %u of %u, %u bytes\n", serial.GetColdCount(), serial.GetPlayerCount(), (unsigned int)serial.GetColdBytes());
+
+	ok = ok && moved == 98 && serial.IsCold(50) && !serial.IsCold(0) && std::fabs(serial.GetRating(50) - rating_before) <= 1.0 / 64.0;
+
+	serial.AddMatch(50, 0, Glicko2::DRAW);
+	serial.Update();
+
+	ok = ok && !serial.IsCold(50) && serial.GetColdCount() == 97 && serial.GetLastActive(50) == 3;
+
+	// a player who is only an opponent in a pending result stays hot
+	Glicko2_population pending;
+	unsigned int       a = pending.AddPlayer();
+	unsigned int       b = pending.AddPlayer();
+	for ( unsigned int i=0;i<5;i++ )
+	{
+		pending.Update();
+	}
+	pending.AddResult(a, b, 1.0);
+	pending.Demote(2);
+	pending.Update();
+
+	ok = ok && !pending.IsCold(a) && !pending.IsCold(b) && pending.GetRating(a) > 1500.0 && pending.GetRating(b) == 1500.0;
+
+	// a player active in a period ahead of the population's is not idle
+	Glicko2_population ahead;
+	unsigned int       c = ahead.AddPlayer();
+	ahead.SetState(c, ahead.GetState(c), 50);
+	ok = ok && ahead.Demote(8) == 0 && !ahead.IsCold(c) && ahead.GetColdCount() == 0;
+
+	// with a volatility freeze, established players keep their volatility and
+	// the rest solve as before
+	Glicko2_population frozen;
+	frozen.AddPlayer(1500.0, 40.0, 0.06);
+	frozen.AddPlayer(1450.0, 45.0, 0.06);
+	frozen.AddPlayer(1500.0, 350.0, 0.06);
+	frozen.SetVolatilityFreeze(0.0001);
+	frozen.AddMatch(0, 1, Glicko2::WIN);
+	frozen.AddMatch(2, 1, Glicko2::WIN);
+	frozen.Update();
+
+	ok = ok && frozen.GetVolatility(0) == 0.06 && frozen.GetFrozenCount() + frozen.GetSolvedCount() == 3 && frozen.GetFrozenCount() >= 2;
+
+	printf("%s\n", ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
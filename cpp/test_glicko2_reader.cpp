@@ -0,0 +1,48 @@
+#include "glicko2_reader.h"
+
+#include <cstdio>
+#include <vector>
+
+int main()
+{
+	// a file that is not a whole number of chunks
+	std::vector<char> contents(3 * 1024 * 1024 + 12345);
+	unsigned int      seed = 7;
+	for ( unsigned int i=0;i<contents.size();i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		contents[i] = (char)(seed >> 16);
+	}
+
+	std::FILE* file = std::fopen("test_glicko2_reader.bin", "wb");
+	bool       ok   = file && std::fwrite(&contents[0], 1, contents.size(), file) == contents.size();
+	ok = file && std::fclose(file) == 0 && ok;
+
+	// read it back through io_uring if the system allows, and with pread
+	bool async = false;
+	for ( int pass=0;ok && pass<2;pass++ )
+	{
+		Glicko2_reader reader(256 * 1024, 4);
+		ok = reader.Open("test_glicko2_reader.bin", pass == 0);
+		if ( pass == 0 )
+		{
+			async = reader.IsAsync();
+		}
+
+		std::vector<char> copy;
+		const char*       data = 0;
+		std::size_t       size = 0;
+		while ( ok && reader.Next(data, size) )
+		{
+			copy.insert(copy.end(), data, data + size);
+		}
+
+		ok = ok && !reader.IsFailed() && copy == contents;
+	}
+
+	printf("io_uring = %s, %s\n", async ? "yes" : "no", ok ? "ok" : "FAILED");
+
+	std::remove("test_glicko2_reader.bin");
+
+	return ok ? 0 : 1;
+}
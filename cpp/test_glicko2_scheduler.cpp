@@ -0,0 +1,124 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_population.h"
+#include "glicko2_scheduler.h"
+
+#include <cstdio>
+#include <vector>
+
+
+
+namespace
+{
+	// players in each pool: many tiny pools, and two large ones
+	unsigned int PoolSize(unsigned int pool)
+	{
+		return pool < 2 ? 20000 : 10 + pool % 7;
+	}
+
+
+
+	void Play(Glicko2_population& population, unsigned int pool, unsigned int period)
+	{
+		unsigned int size = population.GetPlayerCount();
+		for ( unsigned int i=0;i<size;i++ )
+		{
+			unsigned int opponent = (i * 7 + period * 13 + pool + 1) % size;
+			if ( opponent != i )
+			{
+				population.AddMatch(i, opponent, (i + period + pool) % 3 == 0 ? Glicko2::DRAW : ((i + opponent) % 2 ? Glicko2::WIN : Glicko2::LOSS));
+			}
+		}
+	}
+}
+
+
+
+int main()
+{
+	const unsigned int pools = 200;
+
+	// every pool twice: one updated directly, one through the scheduler
+	std::vector<Glicko2_population*> direct;
+	std::vector<Glicko2_population*> scheduled;
+	Glicko2_scheduler                scheduler(4, 4096);
+	for ( unsigned int p=0;p<pools;p++ )
+	{
+		direct.push_back(new Glicko2_population);
+		scheduled.push_back(new Glicko2_population);
+		for ( unsigned int i=0;i<PoolSize(p);i++ )
+		{
+			direct[p]->AddPlayer(1400.0 + i % 200, 80.0 + i % 50, 0.06);
+			scheduled[p]->AddPlayer(1400.0 + i % 200, 80.0 + i % 50, 0.06);
+		}
+		scheduler.AddPool(*scheduled[p]);
+	}
+
+	for ( unsigned int period=0;period<3;period++ )
+	{
+		for ( unsigned int p=0;p<pools;p++ )
+		{
+			Play(*direct[p], p, period);
+			direct[p]->Update();
+		}
+
+		// the large pools are due last, so the small ones run around them
+		for ( unsigned int p=0;p<pools;p++ )
+		{
+			Play(*scheduled[p], p, period);
+			scheduler.Submit(p, p < 2 ? 1000 + p : p);
+		}
+		scheduler.WaitAll();
+	}
+
+	bool ok = scheduler.GetUpdateCount() == 3 * pools && scheduler.GetSplitCount() == 6 && scheduler.GetBatchedCount() > 0;
+	for ( unsigned int p=0;p<pools;p++ )
+	{
+		ok = ok && !scheduler.IsPending(p) && scheduled[p]->GetPeriod() == 3;
+		for ( unsigned int i=0;ok && i<PoolSize(p);i++ )
+		{
+			ok = direct[p]->GetRating(i) == scheduled[p]->GetRating(i) && direct[p]->GetDeviation(i) == scheduled[p]->GetDeviation(i) && direct[p]->GetVolatility(i) == scheduled[p]->GetVolatility(i);
+		}
+	}
+
+	// a pool submitted again waits for its last update
+	Play(*scheduled[5], 5, 3);
+	scheduler.Submit(5, 0);
+	scheduler.Submit(5, 0);
+	scheduler.Wait(5);
+	ok = ok && scheduled[5]->GetPeriod() == 5;
+
+	printf("%u updates, %u batched, %u split, %s\n", (unsigned int)scheduler.GetUpdateCount(), (unsigned int)scheduler.GetBatchedCount(), (unsigned int)scheduler.GetSplitCount(), ok ? "ok" : "FAILED");
+
+	for ( unsigned int p=0;p<pools;p++ )
+	{
+		delete direct[p];
+		delete scheduled[p];
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+/*
+
+  Copyright (c) 2004 Stephen Waits
+  
+  This software is provided 'as-is', without any express or implied warranty. In
+  no event will the authors be held liable for any damages arising from the use
+  of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it freely,
+  subject to the following restrictions:
+  
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  
+  3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+
+#include "glicko2_population.h"
+#include "glicko2_snapshots.h"
+
+#include <cstdio>
+#include <vector>
+
+
+
+int main()
+{
+	std::remove("test_glicko2_snapshots.log");
+
+	Glicko2_population population;
+	for ( unsigned int i=0;i<2000;i++ )
+	{
+		population.AddPlayer();
+	}
+
+	// a tenth of the players play each period; some join late, some go cold,
+	// and one period is undone and played again
+	Glicko2_snapshots                          snapshots("test_glicko2_snapshots.log", 8);
+	std::vector<std::vector<Glicko2_rating> >  states(41);
+	std::vector<std::vector<unsigned int> >    actives(41);
+	bool                                       ok = true;
+	for ( unsigned int period=0;period<40;period++ )
+	{
+		if ( period == 20 )
+		{
+			for ( unsigned int i=0;i<100;i++ )
+			{
+				population.AddPlayer(1600.0, 200.0, 0.05);
+			}
+		}
+		for ( unsigned int i=0;i<100;i++ )
+		{
+			unsigned int player = (i * 37 + period * 211) % population.GetPlayerCount();
+			population.AddMatch(player, (player + 1 + i % 17) % population.GetPlayerCount(), i % 3 ? Glicko2::WIN : Glicko2::DRAW);
+		}
+		population.Update();
+		if ( period == 30 )
+		{
+			ok = ok && snapshots.Write(population) && population.Rollback();
+			population.AddMatch(0, 1, Glicko2::LOSS);
+			population.Update();
+		}
+		if ( period % 10 == 9 )
+		{
+			population.Demote(5);
+		}
+		ok = ok && snapshots.Write(population);
+
+		std::vector<unsigned int> players(population.GetPlayerCount());
+		for ( unsigned int i=0;i<players.size();i++ )
+		{
+			players[i] = i;
+		}
+		states[population.GetPeriod()].resize(players.size());
+		actives[population.GetPeriod()].resize(players.size());
+		population.GetStates(&players[0], players.size(), &states[population.GetPeriod()][0], &actives[population.GetPeriod()][0]);
+	}
+
+	// deltas are a fraction of the size of a snapshot of everyone each period
+	std::uint64_t full = 0;
+	for ( unsigned int period=1;period<=40;period++ )
+	{
+		full += states[period].size() * 28;
+	}
+	ok = ok && snapshots.GetBytesWritten() * 3 < full;
+
+	std::vector<unsigned int> periods;
+	ok = ok && Glicko2_snapshots::GetPeriods("test_glicko2_snapshots.log", periods) && periods.size() == 41 && periods[30] == 31 && periods[31] == 31;
+
+	// restore a base, a period between bases, the period redone, and the last
+	const unsigned int restore[] = { 1, 9, 14, 31, 40 };
+	for ( unsigned int r=0;ok && r<5;r++ )
+	{
+		unsigned int       period = restore[r];
+		Glicko2_population copy;
+		ok = Glicko2_snapshots::Read("test_glicko2_snapshots.log", period, copy) && copy.GetPeriod() == period && copy.GetPlayerCount() == states[period].size();
+		for ( unsigned int i=0;ok && i<copy.GetPlayerCount();i++ )
+		{
+			Glicko2_rating state = copy.GetState(i);
+			ok = state.rating == states[period][i].rating && state.deviation == states[period][i].deviation && state.volatility == states[period][i].volatility && copy.GetLastActive(i) == actives[period][i];
+		}
+	}
+
+	Glicko2_population none;
+	ok = ok && !Glicko2_snapshots::Read("test_glicko2_snapshots.log", 0, none);
+
+	// a snapshot torn by a crash is cut off when the log is reopened
+	std::remove("test_glicko2_snapshots.torn");
+	Glicko2_population torn;
+	for ( unsigned int i=0;i<100;i++ )
+	{
+		torn.AddPlayer();
+	}
+	{
+		Glicko2_snapshots log("test_glicko2_snapshots.torn", 8);
+		for ( unsigned int period=0;period<3;period++ )
+		{
+			torn.AddMatch(period, period + 1, Glicko2::WIN);
+			torn.Update();
+			ok = ok && log.Write(torn);
+		}
+	}
+
+	std::vector<char> bytes(1 << 16);
+	std::FILE*        file  = std::fopen("test_glicko2_snapshots.torn", "rb");
+	std::size_t       count = file ? std::fread(&bytes[0], 1, bytes.size(), file) : 0;
+	if ( file )
+	{
+		std::fclose(file);
+	}
+	file = std::fopen("test_glicko2_snapshots.torn", "wb");
+	ok = ok && file && count > 5 && std::fwrite(&bytes[0], 1, count - 5, file) == count - 5;
+	if ( file )
+	{
+		std::fclose(file);
+	}
+
+	{
+		Glicko2_snapshots log("test_glicko2_snapshots.torn", 8);
+		for ( unsigned int period=3;period<6;period++ )
+		{
+			torn.AddMatch(period, period + 1, Glicko2::WIN);
+			torn.Update();
+			ok = ok && log.Write(torn);
+		}
+	}
+
+	Glicko2_population restored;
+	ok = ok && Glicko2_snapshots::GetPeriods("test_glicko2_snapshots.torn", periods) && periods.size() == 5 && periods[1] == 2 && periods[2] == 4;
+	ok = ok && Glicko2_snapshots::Read("test_glicko2_snapshots.torn", 6, restored) && restored.GetPeriod() == 6 && restored.GetRating(5) == torn.GetRating(5);
+
+	printf("%u bytes for %u bytes of full snapshots, %s\n", (unsigned int)snapshots.GetBytesWritten(), (unsigned int)full, ok ? "ok" : "FAILED");
+
+	std::remove("test_glicko2_snapshots.log");
+	std::remove("test_glicko2_snapshots.torn");
+
+	return ok ? 0 : 1;
+}
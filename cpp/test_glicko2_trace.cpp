@@ -0,0 +1,37 @@
+#include "glicko2.h"
+#include "glicko2_trace.h"
+
+#include <cstdio>
+
+int main()
+{
+	// record a caller side stage, then a traced update
+	Glicko2_trace::Enable(16);
+
+	{
+		Glicko2_trace_scope scope(Glicko2_trace::INGEST);
+
+		Glicko2 A(1500.0, 200.0, 0.06);
+		Glicko2 B(1400.0,  30.0, 0.06);
+
+		A.AddWin(B);
+		A.Update();
+	}
+
+	Glicko2_trace::Disable();
+
+	// the update adds sums, solver, and finalize spans only when per object
+	// tracing is on too
+	std::size_t expected = 1;
+#if defined(GLICKO2_TRACE) && defined(GLICKO2_TRACE_OBJECTS)
+	expected += 3;
+#endif
+
+	bool ok = Glicko2_trace::GetSpanCount() == expected && Glicko2_trace::WriteChromeJson("test_glicko2_trace.json");
+
+	printf("spans = %u, %s\n", (unsigned int)Glicko2_trace::GetSpanCount(), ok ? "ok" : "FAILED");
+
+	std::remove("test_glicko2_trace.json");
+
+	return ok ? 0 : 1;
+}